@@ -0,0 +1,363 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <thread>
+
+BenchState::BenchState(std::vector<long long> args, std::uint64_t iterations)
+: mArgs(std::move(args)), mIterations(iterations), mRemaining(iterations)
+{}
+
+void BenchState::pauseTiming()
+{
+    if(mStart == std::chrono::steady_clock::time_point())
+        return;
+    mElapsed += std::chrono::steady_clock::now() - mStart;
+    mStart = {};
+}
+
+void BenchState::resumeTiming()
+{
+    mStart = std::chrono::steady_clock::now();
+}
+
+long long BenchState::arg(std::size_t index) const
+{
+    return index < mArgs.size() ? mArgs[index] : 0;
+}
+
+std::uint64_t BenchState::iterations() const
+{
+    return mIterations;
+}
+
+void BenchState::setItemsPerIteration(double items)
+{
+    mItems = items;
+}
+
+double BenchState::getItemsPerIteration() const
+{
+    return mItems;
+}
+
+void BenchState::setPeakMemory(std::size_t bytes)
+{
+    mPeakMemory = bytes;
+}
+
+std::size_t BenchState::getPeakMemory() const
+{
+    return mPeakMemory;
+}
+
+void BenchState::skip(std::string_view reason)
+{
+    mSkipped = reason;
+    mRemaining = 0;
+}
+
+std::string_view BenchState::getSkipped() const
+{
+    return mSkipped;
+}
+
+std::chrono::nanoseconds BenchState::getElapsed() const
+{
+    return mElapsed;
+}
+
+BenchRegistry& BenchRegistry::instance()
+{
+    static BenchRegistry registry;
+    return registry;
+}
+
+void BenchRegistry::add(std::string_view name, std::vector<std::string> argNames, std::vector<std::vector<long long>> argSets, BenchFunc func)
+{
+    if(argSets.empty())
+        argSets.emplace_back();
+    mCases.push_back(BenchCase{std::string(name), std::move(argNames), std::move(argSets), std::move(func)});
+}
+
+int BenchRegistry::run(const BenchOptions& options)
+{
+    std::regex filter;
+    try
+    {
+        filter = std::regex(options.filter.empty() ? std::string(".*") : options.filter);
+    }
+    catch(const std::regex_error& e)
+    {
+        std::fprintf(stderr, "Invalid filter[%s] - %s\n", options.filter.c_str(), e.what());
+        return 2;
+    }
+
+    std::vector<BenchBaseline> baseline;
+    if(!options.baselinePath.empty() && !readBaseline(options.baselinePath, baseline))
+    {
+        std::fprintf(stderr, "Failed to read baseline[%s]\n", options.baselinePath.c_str());
+        return 2;
+    }
+
+#if !defined(__OPTIMIZE__) && !defined(NDEBUG)
+    if(!options.list)
+        std::fprintf(stderr, "Warning: benchmarks built without optimization, results are not representative\n");
+#endif
+
+    if(!options.list)
+    {
+        std::printf("%-48s %12s %12s %14s", "Benchmark", "Iterations", "ns/op", "ops/s");
+        if(!baseline.empty())
+            std::printf(" %12s %9s", "base ns/op", "delta");
+        std::printf("\n");
+    }
+
+    std::vector<BenchResult> results;
+    int regressions = 0;
+    for(const auto& benchCase : mCases)
+    {
+        for(const auto& args : benchCase.argSets)
+        {
+            auto name = variantName(benchCase, args);
+            if(!std::regex_search(name, filter))
+                continue;
+            if(options.list)
+            {
+                std::printf("%s\n", name.c_str());
+                continue;
+            }
+
+            auto result = measure(benchCase, args, options);
+            if(!result.skipped.empty())
+            {
+                std::printf("%-48s skipped - %s\n", result.name.c_str(), result.skipped.c_str());
+                results.push_back(std::move(result));
+                continue;
+            }
+
+            std::printf("%-48s %12llu %12.2f %14.0f", result.name.c_str(), static_cast<unsigned long long>(result.iterations),
+                        result.nsPerOp, 1e9 / result.nsPerOp);
+            auto base = std::find_if(baseline.begin(), baseline.end(), [&](const auto& entry) { return entry.name == result.name; });
+            bool regressed = false;
+            if(base != baseline.end() && base->nsPerOp > 0.0)
+            {
+                double delta = (result.nsPerOp - base->nsPerOp) / base->nsPerOp * 100.0;
+                regressed = delta > options.threshold;
+                std::printf(" %12.2f %+8.1f%%", base->nsPerOp, delta);
+            }
+            if(result.peakMemory > 0)
+            {
+                std::printf("  peak %zu KiB", result.peakMemory / 1024);
+                if(base != baseline.end() && base->peakMemory > 0)
+                {
+                    double growth = (static_cast<double>(result.peakMemory) - static_cast<double>(base->peakMemory)) /
+                                    static_cast<double>(base->peakMemory) * 100.0;
+                    regressed = regressed || growth > options.threshold;
+                    std::printf(" (%+.1f%%)", growth);
+                }
+            }
+            regressions += regressed;
+            std::printf("%s\n", regressed ? "  REGRESSION" : "");
+            std::fflush(stdout);
+            results.push_back(std::move(result));
+        }
+    }
+
+    if(!options.jsonPath.empty() && !options.list && !writeJson(options.jsonPath, results))
+    {
+        std::fprintf(stderr, "Failed to write results[%s]\n", options.jsonPath.c_str());
+        return 2;
+    }
+    if(regressions > 0)
+    {
+        std::printf("%d benchmark(s) slower or using more memory than the baseline by more than %.1f%%\n", regressions, options.threshold);
+        return 1;
+    }
+    return 0;
+}
+
+std::string BenchRegistry::variantName(const BenchCase& benchCase, const std::vector<long long>& args)
+{
+    std::string name = benchCase.name;
+    for(std::size_t i = 0; i < args.size(); i++)
+    {
+        name.append("/");
+        if(i < benchCase.argNames.size())
+            name.append(benchCase.argNames[i]).append(":");
+        name.append(std::to_string(args[i]));
+    }
+    return name;
+}
+
+BenchResult BenchRegistry::measure(const BenchCase& benchCase, const std::vector<long long>& args, const BenchOptions& options)
+{
+    BenchResult result;
+    result.name = variantName(benchCase, args);
+
+    auto runOnce = [&](std::uint64_t iterations) -> BenchState
+    {
+        BenchState state(args, iterations);
+        try
+        {
+            benchCase.func(state);
+        }
+        catch(const std::exception& e)
+        {
+            state.skip(e.what());
+        }
+        return state;
+    };
+
+    // grow the iteration count until a run takes a tenth of the minimum time, then scale it up
+    std::uint64_t iterations = 1;
+    while(true)
+    {
+        auto state = runOnce(iterations);
+        if(!state.getSkipped().empty())
+        {
+            result.skipped = state.getSkipped();
+            return result;
+        }
+        auto elapsed = state.getElapsed();
+        if(elapsed * 10 >= options.minTime || iterations >= 1'000'000'000)
+        {
+            double scale = static_cast<double>(options.minTime.count()) / static_cast<double>(std::max<long long>(elapsed.count(), 1));
+            iterations = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(static_cast<double>(iterations) * std::max(scale, 1.0)));
+            break;
+        }
+        iterations *= 10;
+    }
+
+    std::vector<double> nsPerOp;
+    for(std::size_t i = 0; i < std::max<std::size_t>(options.repetitions, 1); i++)
+    {
+        auto state = runOnce(iterations);
+        if(!state.getSkipped().empty())
+        {
+            result.skipped = state.getSkipped();
+            return result;
+        }
+        result.itemsPerIteration = state.getItemsPerIteration();
+        result.peakMemory = std::max(result.peakMemory, state.getPeakMemory());
+        nsPerOp.push_back(static_cast<double>(state.getElapsed().count()) / (static_cast<double>(iterations) * result.itemsPerIteration));
+    }
+
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    result.iterations = iterations;
+    result.nsPerOp = nsPerOp[nsPerOp.size() / 2];
+    result.minNsPerOp = nsPerOp.front();
+    result.maxNsPerOp = nsPerOp.back();
+    return result;
+}
+
+namespace
+{
+    std::string jsonString(std::string_view str)
+    {
+        std::string out = "\"";
+        for(char c : str)
+        {
+            if(c == '"' || c == '\\')
+                out.push_back('\\');
+            if(static_cast<unsigned char>(c) >= 0x20)
+                out.push_back(c);
+        }
+        out.push_back('"');
+        return out;
+    }
+}
+
+bool BenchRegistry::writeJson(const std::string& path, const std::vector<BenchResult>& results)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if(!file)
+        return false;
+
+    char date[32] = "";
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    file << "{\n  \"context\": {\n";
+    file << "    \"date\": " << jsonString(date) << ",\n";
+#if defined(__VERSION__)
+    file << "    \"compiler\": " << jsonString(__VERSION__) << ",\n";
+#endif
+#if defined(__OPTIMIZE__) || defined(NDEBUG)
+    file << "    \"optimized\": true,\n";
+#else
+    file << "    \"optimized\": false,\n";
+#endif
+    file << "    \"hardware_threads\": " << std::thread::hardware_concurrency() << "\n  },\n";
+    file << "  \"benchmarks\": [";
+    for(std::size_t i = 0; i < results.size(); i++)
+    {
+        const auto& result = results[i];
+        file << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << jsonString(result.name);
+        if(!result.skipped.empty())
+        {
+            file << ", \"skipped\": " << jsonString(result.skipped) << "}";
+            continue;
+        }
+        file << ", \"iterations\": " << result.iterations << ", \"items_per_iteration\": " << result.itemsPerIteration
+             << ", \"ns_per_op\": " << result.nsPerOp << ", \"min_ns_per_op\": " << result.minNsPerOp
+             << ", \"max_ns_per_op\": " << result.maxNsPerOp << ", \"ops_per_sec\": " << 1e9 / result.nsPerOp;
+        if(result.peakMemory > 0)
+            file << ", \"peak_memory_bytes\": " << result.peakMemory;
+        file << "}";
+    }
+    file << "\n  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+bool BenchRegistry::readBaseline(const std::string& path, std::vector<BenchBaseline>& baseline)
+{
+    // reads the files written by writeJson, every result object has its name before its time
+    std::ifstream file(path);
+    if(!file)
+        return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string json = buffer.str();
+
+    std::size_t pos = json.find("\"benchmarks\"");
+    if(pos == std::string::npos)
+        return false;
+    while((pos = json.find("{\"name\": \"", pos)) != std::string::npos)
+    {
+        pos += 10;
+        std::string name;
+        for(; pos < json.size() && json[pos] != '"'; pos++)
+        {
+            if(json[pos] == '\\' && pos + 1 < json.size())
+                pos++;
+            name.push_back(json[pos]);
+        }
+        auto end = json.find('}', pos);
+        auto time = json.find("\"ns_per_op\": ", pos);
+        if(time == std::string::npos || time > end)
+            continue;
+        BenchBaseline entry{std::move(name), std::strtod(json.c_str() + time + 13, nullptr), 0};
+        auto memory = json.find("\"peak_memory_bytes\": ", pos);
+        if(memory != std::string::npos && memory < end)
+            entry.peakMemory = std::strtoull(json.c_str() + memory + 21, nullptr, 10);
+        baseline.push_back(std::move(entry));
+    }
+    return true;
+}
+
+BenchRegistrar::BenchRegistrar(std::string_view name, BenchFunc func)
+{
+    BenchRegistry::instance().add(name, {}, {}, std::move(func));
+}
+
+BenchRegistrar::BenchRegistrar(std::string_view name, std::vector<std::string> argNames, std::vector<std::vector<long long>> argSets, BenchFunc func)
+{
+    BenchRegistry::instance().add(name, std::move(argNames), std::move(argSets), std::move(func));
+}
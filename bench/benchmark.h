@@ -0,0 +1,209 @@
+#ifndef LUA_BENCHMARK_H
+#define LUA_BENCHMARK_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @class BenchState
+ * @brief Drives the timed loop of one benchmark run.
+ *
+ * The benchmark body sets up its data, then runs the measured code inside `while(state.keepRunning())`.
+ * The timer starts with the first call and stops once the requested iterations are done.
+ */
+class BenchState
+{
+private:
+    std::vector<long long> mArgs = {}; /**< Arguments of this variant. */
+    std::uint64_t mIterations = 0; /**< Iterations requested by the runner. */
+    std::uint64_t mRemaining = 0; /**< Iterations left in the loop. */
+    bool mStarted = false; /**< Set once the loop started. */
+    double mItems = 1.0; /**< Operations per iteration. */
+    std::size_t mPeakMemory = 0; /**< Peak memory reported by the benchmark in bytes. */
+    std::string mSkipped = ""; /**< Reason if the benchmark skipped itself. */
+    std::chrono::steady_clock::time_point mStart = {}; /**< Start of the running timer. */
+    std::chrono::nanoseconds mElapsed = {}; /**< Time measured so far. */
+
+public:
+    BenchState(std::vector<long long> args, std::uint64_t iterations);
+
+    /**
+     * @brief Advances the timed loop.
+     * @return True while iterations are left. Starts the timer on the first and stops it on the last call.
+     */
+    bool keepRunning()
+    {
+        if(mRemaining > 0) [[likely]]
+        {
+            if(!mStarted) [[unlikely]]
+            {
+                mStarted = true;
+                resumeTiming();
+            }
+            --mRemaining;
+            return true;
+        }
+        pauseTiming();
+        return false;
+    }
+
+    /**
+     * @brief Stops the timer, e.g. to rebuild input that the measured code consumes.
+     */
+    void pauseTiming();
+
+    /**
+     * @brief Restarts the timer after pauseTiming.
+     */
+    void resumeTiming();
+
+    /**
+     * @brief Retrieves an argument of the variant that is running.
+     * @param index Position in the argument list of the benchmark.
+     */
+    long long arg(std::size_t index) const;
+
+    std::uint64_t iterations() const;
+
+    /**
+     * @brief Sets how many operations one iteration performs. Results are reported per operation.
+     * @param items Operations per iteration, e.g. the number of calls made by one batch.
+     */
+    void setItemsPerIteration(double items);
+    double getItemsPerIteration() const;
+
+    /**
+     * @brief Reports the peak memory of the run. It is recorded next to the time and compared with the baseline.
+     * @param bytes Peak memory in bytes, e.g. the sum of LuaMemoryStats::peak over the states used.
+     */
+    void setPeakMemory(std::size_t bytes);
+    std::size_t getPeakMemory() const;
+
+    /**
+     * @brief Marks the run as skipped, e.g. when its setup failed. The loop must not be entered afterwards.
+     * @param reason Reason printed in the results.
+     */
+    void skip(std::string_view reason);
+    std::string_view getSkipped() const;
+
+    std::chrono::nanoseconds getElapsed() const;
+};
+
+/**
+ * @brief Keeps the compiler from removing a computation whose result is otherwise unused.
+ * @param value Result to keep.
+ */
+template<typename T>
+inline void benchKeep(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+using BenchFunc = std::function<void(BenchState&)>;
+
+/**
+ * @brief A registered benchmark with the argument sets it runs with.
+ */
+struct BenchCase
+{
+    std::string name = ""; /**< Name, e.g. "doFunc/name". */
+    std::vector<std::string> argNames = {}; /**< Names of the arguments, used to build the variant names. */
+    std::vector<std::vector<long long>> argSets = {}; /**< One run per argument set. */
+    BenchFunc func = nullptr; /**< Benchmark body. */
+};
+
+/**
+ * @brief Result of one benchmark variant.
+ */
+struct BenchResult
+{
+    std::string name = ""; /**< Name of the variant, e.g. "doFunc/name/args:4". */
+    std::uint64_t iterations = 0; /**< Iterations of every repetition. */
+    double itemsPerIteration = 1.0; /**< Operations per iteration. */
+    double nsPerOp = 0.0; /**< Median time per operation over the repetitions. */
+    double minNsPerOp = 0.0; /**< Fastest repetition. */
+    double maxNsPerOp = 0.0; /**< Slowest repetition. */
+    std::size_t peakMemory = 0; /**< Highest peak memory of the repetitions in bytes. 0 if not reported. */
+    std::string skipped = ""; /**< Reason if the variant was skipped. */
+};
+
+/**
+ * @brief Result of an earlier run read from its JSON file.
+ */
+struct BenchBaseline
+{
+    std::string name = ""; /**< Name of the variant. */
+    double nsPerOp = 0.0; /**< Time per operation. */
+    std::size_t peakMemory = 0; /**< Peak memory in bytes. 0 if not reported. */
+};
+
+/**
+ * @brief Options of a benchmark run, set from the command line.
+ */
+struct BenchOptions
+{
+    std::string filter = ""; /**< Regular expression the variant names must match. Empty for all. */
+    std::chrono::nanoseconds minTime = std::chrono::milliseconds(200); /**< Measured time per repetition. */
+    std::size_t repetitions = 3; /**< Repetitions of every variant, the median is reported. */
+    std::string jsonPath = ""; /**< File the results are written to as JSON. Empty for none. */
+    std::string baselinePath = ""; /**< JSON file of an earlier run to compare with. Empty for none. */
+    double threshold = 10.0; /**< Slowdown or memory growth in percent reported as a regression. */
+    bool list = false; /**< Only prints the variant names. */
+};
+
+/**
+ * @class BenchRegistry
+ * @brief Collects the benchmarks of all translation units and runs them.
+ */
+class BenchRegistry
+{
+private:
+    std::vector<BenchCase> mCases = {}; /**< Registered benchmarks. */
+
+public:
+    static BenchRegistry& instance();
+
+    /**
+     * @brief Registers a benchmark.
+     * @param name Name of the benchmark.
+     * @param argNames Names of the arguments.
+     * @param argSets Argument sets, one variant per set. Empty for a single variant without arguments.
+     * @param func Benchmark body.
+     */
+    void add(std::string_view name, std::vector<std::string> argNames, std::vector<std::vector<long long>> argSets, BenchFunc func);
+
+    /**
+     * @brief Runs the matching variants, prints them and writes and compares the results as requested.
+     * @param options Options of the run.
+     * @return 0 on success, 1 if a variant regressed against the baseline, 2 on usage or file errors.
+     */
+    int run(const BenchOptions& options);
+
+private:
+    static std::string variantName(const BenchCase& benchCase, const std::vector<long long>& args);
+    static BenchResult measure(const BenchCase& benchCase, const std::vector<long long>& args, const BenchOptions& options);
+    static bool writeJson(const std::string& path, const std::vector<BenchResult>& results);
+    static bool readBaseline(const std::string& path, std::vector<BenchBaseline>& baseline);
+};
+
+/**
+ * @brief Registers a benchmark from a static initializer.
+ */
+struct BenchRegistrar
+{
+    BenchRegistrar(std::string_view name, BenchFunc func);
+    BenchRegistrar(std::string_view name, std::vector<std::string> argNames, std::vector<std::vector<long long>> argSets, BenchFunc func);
+};
+
+#endif // LUA_BENCHMARK_H
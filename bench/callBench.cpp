@@ -0,0 +1,206 @@
+#include "benchmark.h"
+
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "luaScript.h"
+
+namespace
+{
+    constexpr long long nativeCallsPerIteration = 1000; /**< Calls of the native function per doFunc. */
+
+    /**
+     * Generates a Lua function with the given number of parameters that returns their sum.
+     */
+    std::string makeSum(std::string_view name, long long args)
+    {
+        std::string params;
+        std::string sum = "0";
+        for(long long i = 0; i < args; i++)
+        {
+            auto param = "a" + std::to_string(i);
+            params.append(i == 0 ? "" : ", ").append(param);
+            sum.append(" + ").append(param);
+        }
+        return std::string("function ").append(name).append("(").append(params).append(") return ").append(sum).append(" end\n");
+    }
+
+    /**
+     * Sets up a script with the function "sum" described with the given number of arguments and one return value.
+     */
+    bool setupSum(LuaScript& lua, FuncDescription& desc, long long& ret, long long args)
+    {
+        for(long long i = 0; i < args; i++)
+            desc.addArg<long long>(i);
+        desc.addRetVal<long long>(ret);
+        return lua.regFunc("sum", desc) && lua.compileString(makeSum("sum", args));
+    }
+
+    BenchRegistrar doFuncName("doFunc/name", {"args"}, {{0}, {1}, {4}, {8}}, [](BenchState& state)
+    {
+        LuaScript lua;
+        FuncDescription desc;
+        long long ret = 0;
+        if(!setupSum(lua, desc, ret, state.arg(0)))
+            return state.skip("failed to set up the script");
+        while(state.keepRunning())
+        {
+            auto info = lua.doFunc("sum");
+            benchKeep(info);
+        }
+    });
+
+    BenchRegistrar doFuncRef("doFunc/ref", {"args"}, {{0}, {1}, {4}, {8}}, [](BenchState& state)
+    {
+        LuaScript lua;
+        FuncDescription desc;
+        long long ret = 0;
+        if(!setupSum(lua, desc, ret, state.arg(0)))
+            return state.skip("failed to set up the script");
+        auto ref = lua.prepare("sum");
+        while(state.keepRunning())
+        {
+            auto info = lua.doFunc(ref);
+            benchKeep(info);
+        }
+    });
+
+    BenchRegistrar callTyped("call/typed", {"args"}, {{0}, {1}, {4}, {8}}, [](BenchState& state)
+    {
+        LuaScript lua;
+        FuncDescription desc;
+        long long ret = 0;
+        if(!setupSum(lua, desc, ret, state.arg(0)))
+            return state.skip("failed to set up the script");
+        auto ref = lua.prepare("sum");
+        while(state.keepRunning())
+        {
+            switch(state.arg(0))
+            {
+            case 0:
+                benchKeep(lua.call<long long>(ref));
+                break;
+            case 1:
+                benchKeep(lua.call<long long>(ref, 1LL));
+                break;
+            case 4:
+                benchKeep(lua.call<long long>(ref, 1LL, 2LL, 3LL, 4LL));
+                break;
+            default:
+                benchKeep(lua.call<long long>(ref, 1LL, 2LL, 3LL, 4LL, 5LL, 6LL, 7LL, 8LL));
+                break;
+            }
+        }
+    });
+
+    BenchRegistrar callBatch("callBatch", {"items"}, {{16}, {1024}}, [](BenchState& state)
+    {
+        LuaScript lua;
+        FuncDescription desc;
+        long long ret = 0;
+        if(!setupSum(lua, desc, ret, 2))
+            return state.skip("failed to set up the script");
+        auto ref = lua.prepare("sum");
+        std::vector<std::tuple<long long, long long>> args(static_cast<std::size_t>(state.arg(0)), {1, 2});
+        std::vector<long long> results(args.size());
+        state.setItemsPerIteration(static_cast<double>(args.size()));
+        while(state.keepRunning())
+        {
+            auto info = lua.callBatch(ref, std::span(args), std::span(results));
+            benchKeep(info);
+        }
+    });
+
+    BenchRegistrar nativeBound("native/bound", {"args"}, {{0}, {1}, {4}, {8}}, [](BenchState& state)
+    {
+        LuaScript lua;
+        auto args = state.arg(0);
+        FuncInfo info;
+        if(args == 0)
+            info = lua.regFunc([]() -> long long { return 1; }, "native");
+        else if(args == 1)
+            info = lua.regFunc([](long long a) { return a; }, "native");
+        else if(args == 4)
+            info = lua.regFunc([](long long a, long long b, long long c, long long d) { return a + b + c + d; }, "native");
+        else
+            info = lua.regFunc([](long long a, long long b, long long c, long long d, long long e, long long f, long long g, long long h)
+                               { return a + b + c + d + e + f + g + h; }, "native");
+
+        std::string callArgs;
+        for(long long i = 0; i < args; i++)
+            callArgs.append(i == 0 ? "" : ", ").append(std::to_string(i));
+        std::string code = "function loop() local s = 0 for i = 1, " + std::to_string(nativeCallsPerIteration) +
+                           " do s = s + native(" + callArgs + ") end return s end";
+        if(!info || !lua.regFunc("loop") || !lua.compileString(code))
+            return state.skip("failed to set up the script");
+
+        auto ref = lua.prepare("loop");
+        state.setItemsPerIteration(static_cast<double>(nativeCallsPerIteration));
+        while(state.keepRunning())
+        {
+            auto result = lua.doFunc(ref);
+            benchKeep(result);
+        }
+    });
+
+    BenchRegistrar nativeScript("native/luaScriptFunc", [](BenchState& state)
+    {
+        LuaScript lua;
+        std::string code = "function loop() for i = 1, " + std::to_string(nativeCallsPerIteration) + " do native() end end";
+        if(!lua.regFunc([](LuaScript&) { return 0; }, "native") || !lua.regFunc("loop") || !lua.compileString(code))
+            return state.skip("failed to set up the script");
+
+        auto ref = lua.prepare("loop");
+        state.setItemsPerIteration(static_cast<double>(nativeCallsPerIteration));
+        while(state.keepRunning())
+        {
+            auto result = lua.doFunc(ref);
+            benchKeep(result);
+        }
+    });
+
+    /**
+     * Calls a bound native from a Lua loop with the call statistics off (0) or on (1).
+     */
+    BenchRegistrar nativeCallStats("native/callStats", {"enabled"}, {{0}, {1}}, [](BenchState& state)
+    {
+        LuaScript lua;
+        std::string code = "function loop() local s = 0 for i = 1, " + std::to_string(nativeCallsPerIteration) + " do s = s + native(i) end return s end";
+        if(!lua.regFunc([](long long a) { return a; }, "native") || !lua.regFunc("loop") || !lua.compileString(code))
+            return state.skip("failed to set up the script");
+
+        lua.setCallStatsEnabled(state.arg(0) != 0);
+        auto ref = lua.prepare("loop");
+        state.setItemsPerIteration(static_cast<double>(nativeCallsPerIteration));
+        while(state.keepRunning())
+        {
+            auto result = lua.doFunc(ref);
+            benchKeep(result);
+        }
+    });
+
+    /**
+     * Calls a bound native from a Lua loop with the tracer off (0) or recording every call (1).
+     */
+    BenchRegistrar nativeTrace("native/trace", {"enabled"}, {{0}, {1}}, [](BenchState& state)
+    {
+        LuaScript lua;
+        std::string code = "function loop() local s = 0 for i = 1, " + std::to_string(nativeCallsPerIteration) + " do s = s + native(i) end return s end";
+        if(!lua.regFunc([](long long a) { return a; }, "native") || !lua.regFunc("loop") || !lua.compileString(code))
+            return state.skip("failed to set up the script");
+
+        if(state.arg(0) != 0)
+            LuaTracer::start();
+        auto ref = lua.prepare("loop");
+        state.setItemsPerIteration(static_cast<double>(nativeCallsPerIteration));
+        while(state.keepRunning())
+        {
+            auto result = lua.doFunc(ref);
+            benchKeep(result);
+        }
+        LuaTracer::stop();
+        LuaTracer::clear();
+    });
+}
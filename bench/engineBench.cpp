@@ -0,0 +1,46 @@
+#include "benchmark.h"
+
+#include <future>
+#include <vector>
+
+#include "luaScriptEngine.h"
+
+namespace
+{
+    constexpr long long jobsPerIteration = 256; /**< Jobs submitted and awaited per iteration. */
+
+    BenchRegistrar engineDoFunc("engine/doFunc", {"threads"}, {{1}, {2}, {4}}, [](BenchState& state)
+    {
+        LuaScriptEngine engine(Lua_lib_all, "", [](LuaScript& lua)
+        {
+            auto info = lua.regFunc("work");
+            if(!info)
+                return info;
+            return lua.compileString("function work() local s = 0 for i = 1, 1000 do s = s + i end return s end");
+        }, false);
+        if(!engine.start(static_cast<std::size_t>(state.arg(0))))
+            return state.skip("failed to start the engine");
+
+        std::vector<std::future<FuncInfo>> results;
+        results.reserve(jobsPerIteration);
+        state.setItemsPerIteration(static_cast<double>(jobsPerIteration));
+        while(state.keepRunning())
+        {
+            for(long long i = 0; i < jobsPerIteration; i++)
+                results.push_back(engine.doFunc("work"));
+            for(auto& result : results)
+                benchKeep(result.get());
+            results.clear();
+        }
+    });
+
+    BenchRegistrar engineStart("engine/start", {"threads"}, {{1}, {4}}, [](BenchState& state)
+    {
+        while(state.keepRunning())
+        {
+            LuaScriptEngine engine(Lua_lib_all, "", nullptr, false);
+            auto info = engine.start(static_cast<std::size_t>(state.arg(0)));
+            benchKeep(info);
+        }
+    });
+}
@@ -0,0 +1,53 @@
+-- Calls (ldo.c, lvm.c): recursion, varargs, method calls through metatables, tail calls and pcall.
+
+local N = 10000
+
+local function fib(n)
+    if n < 2 then
+        return n
+    end
+    return fib(n - 1) + fib(n - 2)
+end
+
+local function sum(...)
+    local total = 0
+    for i = 1, select("#", ...) do
+        total = total + select(i, ...)
+    end
+    return total
+end
+
+local Point = {}
+Point.__index = Point
+function Point.new(x, y)
+    return setmetatable({x = x, y = y}, Point)
+end
+function Point:length2()
+    return self.x * self.x + self.y * self.y
+end
+
+local function countdown(n)
+    if n == 0 then
+        return 0
+    end
+    return countdown(n - 1)
+end
+
+local function add(a, b)
+    return a + b
+end
+
+function run()
+    local total = fib(20) -- 21891 calls
+    local point = Point.new(3, 4)
+    for i = 1, N do
+        total = total + sum(i, 1, 2, 3)
+        total = total + point:length2()
+        local _, value = pcall(add, i, 1)
+        total = total + value
+    end
+    for _ = 1, N // 100 do
+        total = total + countdown(100)
+    end
+    return 21891 + 3 * N + N
+end
@@ -0,0 +1,38 @@
+-- Closures (lfunc.c, lvm.c): creation of closures with open and closed upvalues and calls of them.
+
+local N = 10000
+
+local function counter(start)
+    local value = start
+    return function(step)
+        value = value + step
+        return value
+    end
+end
+
+local function compose(f, g)
+    return function(x)
+        return f(g(x))
+    end
+end
+
+local function double(x) return x * 2 end
+local function increment(x) return x + 1 end
+
+function run()
+    local sum = 0
+    for i = 1, N do
+        local next = counter(i)
+        sum = sum + next(1) + next(2)
+    end
+    local f = compose(double, increment)
+    for i = 1, N do
+        sum = sum + f(i)
+    end
+    for i = 1, N do
+        local captured = i
+        local get = function() return captured end
+        sum = sum + get()
+    end
+    return 3 * N
+end
@@ -0,0 +1,21 @@
+-- Garbage collection under allocation pressure (lgc.c): short lived tables, strings and closures
+-- while a ring of objects stays alive long enough to be traversed and promoted.
+
+local N = 10000
+local RING = 1024
+local ring = {}
+for i = 1, RING do
+    ring[i] = {}
+end
+
+function run()
+    for i = 1, N do
+        local slot = i % RING + 1
+        ring[slot] = {i, "value" .. i, {x = i, y = -i}}
+        local temporary = {i, i + 1, i + 2}
+        local name = "temp" .. (temporary[1] + temporary[3])
+        local closure = function() return name end
+        ring[(slot * 31) % RING + 1][4] = closure
+    end
+    return N
+end
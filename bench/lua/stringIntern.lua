@@ -0,0 +1,24 @@
+-- String creation (lstring.c): new short strings that are hashed and interned, short strings
+-- that are already in the string table, and long strings that are not interned.
+
+local N = 10000
+local long = string.rep("x", 64)
+
+function run()
+    local length = 0
+    for i = 1, N do
+        local fresh = "item" .. i
+        local existing = "item" .. (i % 64)
+        length = length + #fresh + #existing
+    end
+    for i = 1, N do
+        length = length + #tostring(i * 0.25)
+    end
+    for i = 1, N // 10 do
+        length = length + #(long .. i)
+    end
+    for i = 1, N do
+        length = length + #string.sub(long, 1, i % 40)
+    end
+    return 4 * N + N // 10
+end
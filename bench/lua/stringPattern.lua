@@ -0,0 +1,27 @@
+-- Pattern matching (lstrlib.c): find, match, gmatch and gsub over a generated log text.
+
+local lines = {}
+for i = 1, 200 do
+    lines[i] = string.format("2024-01-%02d 12:%02d:%02d level=%s id=%d msg=\"request %d done\"",
+        i % 28 + 1, i % 60, (i * 7) % 60, i % 3 == 0 and "warn" or "info", i * 13, i)
+end
+local text = table.concat(lines, "\n")
+
+function run()
+    local count = 0
+    for _, line in ipairs(lines) do
+        if string.find(line, "level=warn", 1, true) then
+            count = count + 1
+        end
+        local id = string.match(line, "id=(%d+)")
+        count = count + #id
+        local date = string.match(line, "^(%d+)%-(%d+)%-(%d+)")
+        count = count + #date
+    end
+    for key, value in string.gmatch(text, "(%a+)=(%w+)") do
+        count = count + #key + #value
+    end
+    local replaced, replacements = string.gsub(text, "%d+", "#")
+    count = count + #replaced + replacements
+    return 3 * #lines + 3
+end
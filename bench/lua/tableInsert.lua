@@ -0,0 +1,36 @@
+-- Table inserts (ltable.c): array part growth and rehashing of the hash part with
+-- string, sparse integer and float keys. Every round fills fresh tables.
+
+local N = 10000
+local keys = {}
+for i = 1, N do
+    keys[i] = "key" .. i
+end
+
+function run()
+    local array = {}
+    for i = 1, N do
+        array[i] = i
+    end
+
+    local strings = {}
+    for i = 1, N do
+        strings[keys[i]] = i
+    end
+
+    local sparse = {}
+    for i = 1, N do
+        sparse[i * 7919] = i
+    end
+
+    local floats = {}
+    for i = 1, N do
+        floats[i + 0.5] = i
+    end
+
+    local appended = {}
+    for i = 1, N do
+        appended[#appended + 1] = i
+    end
+    return 5 * N
+end
@@ -0,0 +1,35 @@
+-- Table lookups (ltable.c): reads from the array part, string keys, sparse integer keys
+-- and missing keys in tables that are built once.
+
+local N = 4096
+local array, strings, sparse = {}, {}, {}
+local keys, missing = {}, {}
+for i = 1, N do
+    array[i] = i
+    keys[i] = "key" .. i
+    missing[i] = "missing" .. i
+    strings[keys[i]] = i
+    sparse[i * 7919] = i
+end
+
+function run()
+    local sum = 0
+    for i = 1, N do
+        sum = sum + array[i]
+    end
+    for i = 1, N do
+        sum = sum + strings[keys[i]]
+    end
+    for i = 1, N do
+        sum = sum + sparse[i * 7919]
+    end
+    for i = 1, N do
+        if strings[missing[i]] == nil then
+            sum = sum + 1
+        end
+    end
+    for i = 1, N do
+        sum = sum + (array.n or 0) + #array
+    end
+    return 5 * N
+end
@@ -0,0 +1,101 @@
+#include "benchmark.h"
+#include "scriptBench.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    void printUsage(const char* program)
+    {
+        std::printf("Usage: %s [options]\n"
+                    "  --filter=<regex>      Runs the benchmarks whose name matches\n"
+                    "  --min-time=<seconds>  Measured time per repetition (default 0.2)\n"
+                    "  --repetitions=<n>     Repetitions per benchmark, the median is reported (default 3)\n"
+                    "  --json=<file>         Writes the results as JSON\n"
+                    "  --baseline=<file>     Compares with the JSON results of an earlier run\n"
+                    "  --threshold=<percent> Slowdown reported as a regression (default 10)\n"
+                    "  --list                Prints the benchmark names\n"
+                    "  --scripts=<dir>       Lua script corpus run by the script/ benchmarks (default bench/lua)\n"
+                    "  --states=<n,...>      State counts every script runs across (default 1,4)\n", program);
+    }
+
+    std::vector<long long> parseCounts(const std::string& value)
+    {
+        std::vector<long long> counts;
+        for(const char* pos = value.c_str(); *pos != '\0';)
+        {
+            char* end = nullptr;
+            long long count = std::strtoll(pos, &end, 10);
+            if(end == pos || count <= 0)
+                return {};
+            counts.push_back(count);
+            pos = *end == ',' ? end + 1 : end;
+        }
+        return counts;
+    }
+
+    bool option(std::string_view arg, std::string_view name, std::string& value)
+    {
+        if(arg.size() <= name.size() || arg.substr(0, name.size()) != name || arg[name.size()] != '=')
+            return false;
+        value = arg.substr(name.size() + 1);
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    std::string scriptDir = LUACPP_BENCH_SCRIPT_DIR;
+    bool customScriptDir = false;
+    std::vector<long long> states = {1, 4};
+    for(int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        std::string value;
+        if(option(arg, "--filter", value))
+            options.filter = value;
+        else if(option(arg, "--min-time", value))
+            options.minTime = std::chrono::nanoseconds(static_cast<long long>(std::strtod(value.c_str(), nullptr) * 1e9));
+        else if(option(arg, "--repetitions", value))
+            options.repetitions = std::strtoull(value.c_str(), nullptr, 10);
+        else if(option(arg, "--json", value))
+            options.jsonPath = value;
+        else if(option(arg, "--baseline", value))
+            options.baselinePath = value;
+        else if(option(arg, "--threshold", value))
+            options.threshold = std::strtod(value.c_str(), nullptr);
+        else if(option(arg, "--scripts", value))
+        {
+            scriptDir = value;
+            customScriptDir = true;
+        }
+        else if(option(arg, "--states", value))
+        {
+            states = parseCounts(value);
+            if(states.empty())
+            {
+                printUsage(argv[0]);
+                return 2;
+            }
+        }
+        else if(arg == "--list")
+            options.list = true;
+        else
+        {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 2;
+        }
+    }
+
+    if(registerScriptBenchmarks(scriptDir, states) == 0 && customScriptDir)
+    {
+        std::fprintf(stderr, "No Lua scripts found in[%s]\n", scriptDir.c_str());
+        return 2;
+    }
+    return BenchRegistry::instance().run(options);
+}
@@ -0,0 +1,38 @@
+#include "benchmark.h"
+
+#include <string>
+
+#include "luaScript.h"
+
+namespace
+{
+    constexpr long long loopCalls = 1000; /**< Lua function calls per doFunc. */
+
+    /**
+     * Runs a call heavy Lua loop with the profiler off (0), sampled by the thread timer (1) or
+     * sampled by the count hook (2), both every millisecond.
+     */
+    BenchRegistrar profilerLoop("profiler/loop", {"mode"}, {{0}, {1}, {2}}, [](BenchState& state)
+    {
+        LuaScript lua;
+        std::string code = "local function fib(n) if n < 2 then return n end return fib(n - 1) + fib(n - 2) end\n"
+                           "function loop() local s = 0 for i = 1, " + std::to_string(loopCalls) + " do s = s + fib(5) end return s end";
+        if(!lua.regFunc("loop") || !lua.compileString(code))
+            return state.skip("failed to set up the script");
+
+        if(state.arg(0) != 0)
+        {
+            LuaProfilerConfig config;
+            if(state.arg(0) == 2)
+                config.mode = LuaProfilerMode::HOOK;
+            lua.startProfiler(config);
+        }
+        auto ref = lua.prepare("loop");
+        state.setItemsPerIteration(static_cast<double>(loopCalls));
+        while(state.keepRunning())
+        {
+            auto info = lua.doFunc(ref);
+            benchKeep(info);
+        }
+    });
+}
@@ -0,0 +1,25 @@
+# Runs the Lua script benchmarks of luaCPP_bench.
+# BENCH     path of luaCPP_bench
+# BASELINE  baseline file, written with RECORD and compared with otherwise if it exists
+# RESULT    results file of a comparing run
+# RECORD    writes the baseline instead of comparing with it
+
+set(ARGS "--filter=^script/")
+if(RECORD)
+    list(APPEND ARGS "--json=${BASELINE}")
+else()
+    list(APPEND ARGS "--json=${RESULT}")
+    if(EXISTS "${BASELINE}")
+        list(APPEND ARGS "--baseline=${BASELINE}")
+    else()
+        message(STATUS "No baseline at ${BASELINE}, build luaCPP_bench_scripts_baseline to record one")
+    endif()
+endif()
+
+execute_process(COMMAND "${BENCH}" ${ARGS} RESULT_VARIABLE STATUS)
+if(NOT STATUS EQUAL 0)
+    message(FATAL_ERROR "Lua script benchmarks failed or regressed (exit code ${STATUS})")
+endif()
+if(RECORD)
+    message(STATUS "Baseline written to ${BASELINE}")
+endif()
@@ -0,0 +1,79 @@
+#include "scriptBench.h"
+#include "benchmark.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <system_error>
+
+#include "luaScript.h"
+
+namespace
+{
+    /**
+     * Runs a corpus script round robin across state.arg(0) states on the calling thread.
+     */
+    void runScript(BenchState& state, const std::filesystem::path& path)
+    {
+        auto count = static_cast<std::size_t>(std::max<long long>(state.arg(0), 1));
+        std::vector<std::unique_ptr<LuaScript>> scripts;
+        std::vector<LuaFunctionRef> refs;
+        long long ops = 0;
+        for(std::size_t i = 0; i < count; i++)
+        {
+            auto& lua = *scripts.emplace_back(std::make_unique<LuaScript>(path, Lua_lib_all));
+            if(!lua.regFunc("run"))
+                return state.skip("failed to register run");
+            if(auto info = lua.compile(); !info)
+                return state.skip(info.getDesc());
+            auto ref = lua.prepare("run");
+            if(!ref)
+                return state.skip("the script does not define run");
+
+            // the first round warms up the state and reports the operations of a round
+            auto [performed] = lua.call<long long>(ref);
+            if(performed <= 0)
+                return state.skip("run returned no operation count");
+            ops = performed;
+            lua.collectGarbage();
+            lua.resetPeakMemory();
+            refs.push_back(std::move(ref));
+        }
+
+        state.setItemsPerIteration(static_cast<double>(ops) * static_cast<double>(count));
+        while(state.keepRunning())
+        {
+            for(std::size_t i = 0; i < count; i++)
+                benchKeep(scripts[i]->call<long long>(refs[i]));
+        }
+
+        std::size_t peak = 0;
+        for(const auto& lua : scripts)
+            peak += lua->getMemoryStats().peak;
+        state.setPeakMemory(peak);
+    }
+}
+
+std::size_t registerScriptBenchmarks(const std::filesystem::path& dir, const std::vector<long long>& states)
+{
+    std::vector<std::filesystem::path> paths;
+    std::error_code error;
+    for(const auto& entry : std::filesystem::directory_iterator(dir, error))
+    {
+        if(entry.is_regular_file() && entry.path().extension() == ".lua")
+            paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<std::vector<long long>> argSets;
+    for(auto count : states)
+        argSets.push_back({count});
+    for(const auto& path : paths)
+    {
+        BenchRegistry::instance().add("script/" + path.stem().string(), {"states"}, argSets, [path](BenchState& state)
+        {
+            runScript(state, path);
+        });
+    }
+    return paths.size();
+}
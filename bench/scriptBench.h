@@ -0,0 +1,20 @@
+#ifndef LUA_SCRIPTBENCH_H
+#define LUA_SCRIPTBENCH_H
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+/**
+ * @brief Registers one benchmark per Lua script of a corpus directory, named "script/<file name>/states:<n>".
+ *
+ * Every script defines a global function `run` that performs one round of its workload and returns
+ * the number of operations it performed. The benchmark compiles the script in n states, calls `run`
+ * once per state and iteration and reports the time per operation and the summed peak memory of the states.
+ * @param dir Directory with the *.lua scripts. Scripts are registered in the order of their file names.
+ * @param states State counts every script runs across, one variant per count.
+ * @return Number of registered scripts.
+ */
+std::size_t registerScriptBenchmarks(const std::filesystem::path& dir, const std::vector<long long>& states);
+
+#endif // LUA_SCRIPTBENCH_H
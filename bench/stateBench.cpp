@@ -0,0 +1,87 @@
+#include "benchmark.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "luaScript.h"
+
+namespace
+{
+    constexpr std::size_t baseLibOnly = 0; /**< The base library is always opened. */
+
+    /**
+     * Generates a chunk that defines the given number of small functions.
+     */
+    std::string makeChunk(long long functions)
+    {
+        std::string code;
+        for(long long i = 0; i < functions; i++)
+        {
+            auto id = std::to_string(i);
+            code.append("function f").append(id).append("(a, b)\n")
+                .append("    local t = {a, b, ").append(id).append("}\n")
+                .append("    return t[1] + t[2] * t[3]\n")
+                .append("end\n");
+        }
+        return code;
+    }
+
+    std::filesystem::path writeChunk(long long functions)
+    {
+        auto path = std::filesystem::temp_directory_path() / ("luaCPP_bench_" + std::to_string(functions) + ".lua");
+        std::ofstream(path, std::ios::trunc) << makeChunk(functions);
+        return path;
+    }
+
+    BenchRegistrar stateConstruct("state/construct", {"libs"}, {{0}, {1}}, [](BenchState& state)
+    {
+        std::size_t libs = state.arg(0) ? Lua_lib_all : baseLibOnly;
+        while(state.keepRunning())
+        {
+            LuaScript lua(libs);
+            benchKeep(lua.getLuaState());
+        }
+    });
+
+    BenchRegistrar stateConstructPool("state/construct/pool", [](BenchState& state)
+    {
+        auto allocator = std::make_shared<LuaPoolAllocator>();
+        while(state.keepRunning())
+        {
+            LuaScript lua(allocator, Lua_lib_all);
+            benchKeep(lua.getLuaState());
+        }
+    });
+
+    BenchRegistrar compileString("compileString", {"functions"}, {{1}, {100}, {1000}}, [](BenchState& state)
+    {
+        auto code = makeChunk(state.arg(0));
+        LuaScript lua(baseLibOnly);
+        while(state.keepRunning())
+        {
+            auto info = lua.compileString(code);
+            benchKeep(info);
+        }
+    });
+
+    BenchRegistrar compileFile("compile/file", {"functions", "cache"}, {{100, 0}, {100, 1}, {1000, 0}, {1000, 1}}, [](BenchState& state)
+    {
+        auto path = writeChunk(state.arg(0));
+        LuaScript lua(path, baseLibOnly);
+        auto cacheDir = std::filesystem::temp_directory_path() / "luaCPP_bench_cache";
+        if(state.arg(1))
+            lua.setBytecodeCache(cacheDir);
+        if(!lua.compile())
+        {
+            state.skip("failed to compile the generated script");
+            return;
+        }
+        while(state.keepRunning())
+        {
+            auto info = lua.compile();
+            benchKeep(info);
+        }
+        std::filesystem::remove(path);
+    });
+}
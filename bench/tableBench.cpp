@@ -0,0 +1,134 @@
+#include "benchmark.h"
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include "luaScript.h"
+
+namespace
+{
+    constexpr long long valuesPerLevel = 8; /**< Values of every level of a nested table. */
+
+    /**
+     * Builds a table with the given number of string keyed integers.
+     */
+    LuaTable makeFlat(long long size)
+    {
+        LuaTable table("data");
+        for(long long i = 0; i < size; i++)
+            table.addValue("k" + std::to_string(i), i);
+        return table;
+    }
+
+    LuaTable makeLevel(long long level)
+    {
+        LuaTable table(level == 0 ? "data" : "child");
+        for(long long i = 0; i < valuesPerLevel; i++)
+            table.addValue("v" + std::to_string(i), static_cast<double>(i));
+        return table;
+    }
+
+    /**
+     * Builds a chain of nested tables, every level holds valuesPerLevel values and the next level.
+     */
+    LuaTable makeChain(long long depth, long long level = 0)
+    {
+        LuaTable table = makeLevel(level);
+        if(level + 1 < depth)
+            table.addValue("child", makeChain(depth, level + 1));
+        return table;
+    }
+
+    std::string flatCode(long long size)
+    {
+        return "data = {} for i = 0, " + std::to_string(size - 1) + " do data['k' .. i] = i end";
+    }
+
+    std::string chainCode(long long depth)
+    {
+        return "local function level(d) local t = {} for i = 0, " + std::to_string(valuesPerLevel - 1) +
+               " do t['v' .. i] = i + 0.5 end if d > 1 then t.child = level(d - 1) end return t end data = level(" +
+               std::to_string(depth) + ")";
+    }
+
+    /**
+     * pushTable consumes the values of the table it converts, so every iteration pushes a fresh copy.
+     */
+    void runPushTable(BenchState& state, const LuaTable& table)
+    {
+        LuaScript lua;
+        while(state.keepRunning())
+        {
+            state.pauseTiming();
+            LuaTable copy = table;
+            state.resumeTiming();
+            lua.pushTable(copy);
+        }
+    }
+
+    void runGetTable(BenchState& state, const std::string& code)
+    {
+        LuaScript lua;
+        if(!lua.compileString(code))
+            return state.skip("failed to create the table");
+        while(state.keepRunning())
+        {
+            auto table = lua.getTable("data");
+            benchKeep(table);
+        }
+    }
+
+    BenchRegistrar pushTableSize("pushTable/flat", {"size"}, {{16}, {1024}, {65536}}, [](BenchState& state)
+    {
+        runPushTable(state, makeFlat(state.arg(0)));
+    });
+
+    BenchRegistrar pushTableDepth("pushTable/nested", {"depth"}, {{1}, {4}, {8}}, [](BenchState& state)
+    {
+        runPushTable(state, makeChain(state.arg(0)));
+    });
+
+    BenchRegistrar getTableSize("getTable/flat", {"size"}, {{16}, {1024}, {65536}}, [](BenchState& state)
+    {
+        runGetTable(state, flatCode(state.arg(0)));
+    });
+
+    BenchRegistrar getTableDepth("getTable/nested", {"depth"}, {{1}, {4}, {8}}, [](BenchState& state)
+    {
+        runGetTable(state, chainCode(state.arg(0)));
+    });
+
+    BenchRegistrar getFlatTable("getFlatTable/flat", {"size"}, {{16}, {1024}, {65536}}, [](BenchState& state)
+    {
+        LuaScript lua;
+        if(!lua.compileString(flatCode(state.arg(0))))
+            return state.skip("failed to create the table");
+        LuaFlatTable table;
+        while(state.keepRunning())
+        {
+            auto info = lua.getFlatTable("data", table);
+            benchKeep(info);
+        }
+    });
+
+    BenchRegistrar pushArray("pushArray", {"size"}, {{16}, {1024}, {65536}}, [](BenchState& state)
+    {
+        LuaScript lua;
+        std::vector<double> values(static_cast<std::size_t>(state.arg(0)), 0.5);
+        while(state.keepRunning())
+            lua.pushArray("data", std::span<const double>(values));
+    });
+
+    BenchRegistrar readArray("readArray", {"size"}, {{16}, {1024}, {65536}}, [](BenchState& state)
+    {
+        LuaScript lua;
+        std::vector<double> values(static_cast<std::size_t>(state.arg(0)), 0.5);
+        lua.pushArray("data", std::span<const double>(values));
+        while(state.keepRunning())
+        {
+            auto count = lua.readArray("data", std::span<double>(values));
+            benchKeep(count);
+        }
+    });
+}
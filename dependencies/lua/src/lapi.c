@@ -911,6 +911,49 @@ LUA_API void lua_rawset (lua_State *L, int idx) {
 }
 
 
+/*
+** Bulk transfer of numeric arrays (luaCPP extension)
+*/
+LUA_API void lua_rawsetnumbers (lua_State *L, int idx, const lua_Number *v,
+                                                       unsigned int n) {
+  Table *t;
+  lua_lock(L);
+  t = gettable(L, idx);
+  luaH_setnumbers(L, t, v, n);
+  lua_unlock(L);
+}
+
+
+LUA_API void lua_rawsetintegers (lua_State *L, int idx, const lua_Integer *v,
+                                                        unsigned int n) {
+  Table *t;
+  lua_lock(L);
+  t = gettable(L, idx);
+  luaH_setintegers(L, t, v, n);
+  lua_unlock(L);
+}
+
+
+LUA_API unsigned int lua_rawgetnumbers (lua_State *L, int idx, lua_Number *v,
+                                                               unsigned int n) {
+  unsigned int res;
+  lua_lock(L);
+  res = luaH_getnumbers(gettable(L, idx), v, n);
+  lua_unlock(L);
+  return res;
+}
+
+
+LUA_API unsigned int lua_rawgetintegers (lua_State *L, int idx, lua_Integer *v,
+                                                                unsigned int n) {
+  unsigned int res;
+  lua_lock(L);
+  res = luaH_getintegers(gettable(L, idx), v, n);
+  lua_unlock(L);
+  return res;
+}
+
+
 LUA_API void lua_rawsetp (lua_State *L, int idx, const void *p) {
   TValue k;
   setpvalue(&k, cast_voidp(p));
@@ -1332,6 +1375,14 @@ void lua_setwarnf (lua_State *L, lua_WarnFunction f, void *ud) {
 }
 
 
+LUA_API void lua_setgchook (lua_State *L, lua_GCHook f, void *ud) {
+  lua_lock(L);
+  G(L)->ud_gchook = ud;
+  G(L)->gchook = f;
+  lua_unlock(L);
+}
+
+
 void lua_warning (lua_State *L, const char *msg, int tocont) {
   lua_lock(L);
   luaE_warning(L, msg, tocont);
@@ -142,6 +142,11 @@ LUA_API void lua_sethook (lua_State *L, lua_Hook func, int mask, int count) {
 }
 
 
+LUA_API void lua_sethookinherit (lua_State *L, lua_Hook f) {
+  G(L)->hookinherit = f;
+}
+
+
 LUA_API lua_Hook lua_gethook (lua_State *L) {
   return L->hook;
 }
@@ -828,6 +828,23 @@ static int precover (lua_State *L, int status) {
 }
 
 
+/*
+** (luaCPP extension) Passes the inheritable hook of 'from' on to the
+** resumed coroutine 'L', also when 'from' has no hook, so a coroutine
+** created before the hook was set is covered and one created while it
+** was set does not keep it afterwards.
+*/
+static void inherithook (lua_State *L, lua_State *from) {
+  lua_Hook f = G(L)->hookinherit;
+  if ((L->hook != NULL && L->hook != f) ||
+      (from->hook != NULL && from->hook != f))
+    return;  /* a hook of its own is left alone */
+  if (L->hook != from->hook || L->hookmask != from->hookmask ||
+      L->basehookcount != from->basehookcount)
+    lua_sethook(L, from->hook, from->hookmask, from->basehookcount);
+}
+
+
 LUA_API int lua_resume (lua_State *L, lua_State *from, int nargs,
                                       int *nresults) {
   int status;
@@ -841,6 +858,8 @@ LUA_API int lua_resume (lua_State *L, lua_State *from, int nargs,
   else if (L->status != LUA_YIELD)  /* ended with errors? */
     return resume_error(L, "cannot resume dead coroutine", nargs);
   L->nCcalls = (from) ? getCcalls(from) : 0;
+  if (from != NULL && G(L)->hookinherit != NULL)
+    inherithook(L, from);
   if (getCcalls(L) >= LUAI_MAXCCALLS)
     return resume_error(L, "C stack overflow", nargs);
   L->nCcalls++;
@@ -300,6 +300,9 @@ typedef struct global_State {
   TString *strcache[STRCACHE_N][STRCACHE_M];  /* cache for strings in API */
   lua_WarnFunction warnf;  /* warning function */
   void *ud_warn;         /* auxiliary data to 'warnf' */
+  lua_GCHook gchook;  /* collector hook (luaCPP extension) */
+  void *ud_gchook;       /* auxiliary data to 'gchook' */
+  lua_Hook hookinherit;  /* hook passed on by 'lua_resume' (luaCPP extension) */
 } global_State;
 
 
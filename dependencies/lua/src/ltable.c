@@ -77,9 +77,62 @@
 /*
 ** for other types, it is better to avoid modulo by power of 2, as
 ** they can have many 2 factors.
+** (luaCPP extension) The remainder by the odd modulus is computed
+** without a hardware divide: 'hashinv[lsizenode]' holds floor(2^64 / m),
+** so the high half of 'n * hashinv' is the quotient or one less and a
+** single correction yields the exact remainder. Positions are the same
+** as with '%', which keeps arithmetic sequences of keys (sequential and
+** strided ids) free of collisions and next to each other in memory.
+** Compilers without a 64x64->128 bit multiplication keep using '%'.
 */
+#if defined(__SIZEOF_INT128__)
+#define hashmulhi(a,b) \
+	cast(unsigned long long, (cast(unsigned __int128, (a)) * (b)) >> 64)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#define hashmulhi(a,b)	__umulh((a), (b))
+#endif
+
+#if defined(hashmulhi)
+
+/* floor(2^64 / ((2^i - 1) | 1)), all ones where the modulus is 1 */
+static const unsigned long long hashinv[] = {
+  0xffffffffffffffffull, 0xffffffffffffffffull,
+  0x5555555555555555ull, 0x2492492492492492ull,
+  0x1111111111111111ull, 0x0842108421084210ull,
+  0x0410410410410410ull, 0x0204081020408102ull,
+  0x0101010101010101ull, 0x0080402010080402ull,
+  0x0040100401004010ull, 0x0020040080100200ull,
+  0x0010010010010010ull, 0x0008004002001000ull,
+  0x0004001000400100ull, 0x0002000400080010ull,
+  0x0001000100010001ull, 0x0000800040002000ull,
+  0x0000400010000400ull, 0x0000200004000080ull,
+  0x0000100001000010ull, 0x0000080000400002ull,
+  0x0000040000100000ull, 0x0000020000040000ull,
+  0x0000010000010000ull, 0x0000008000004000ull,
+  0x0000004000001000ull, 0x0000002000000400ull,
+  0x0000001000000100ull, 0x0000000800000040ull,
+  0x0000000400000010ull, 0x0000000200000004ull
+};
+
+l_sinline Node *hashmodn (const Table *t, unsigned long long n) {
+  unsigned long long m = cast(unsigned long long, (sizenode(t)-1)|1);
+  unsigned long long r;
+  lua_assert(t->lsizenode < sizeof(hashinv) / sizeof(hashinv[0]));
+  r = n - hashmulhi(n, hashinv[t->lsizenode]) * m;
+  if (r >= m)
+    r -= m;
+  return gnode(t, r);
+}
+
+#define hashmod(t,n)	hashmodn(t, cast(unsigned long long, (n)))
+
+#else
+
 #define hashmod(t,n)	(gnode(t, ((n) % ((sizenode(t)-1)|1))))
 
+#endif
+
 
 #define hashstr(t,str)		hashpow2(t, (str)->hash)
 #define hashboolean(t,p)	hashpow2(t, p)
@@ -104,12 +157,15 @@ static const TValue absentkey = {ABSTKEYCONSTANT};
 ** ('%'). If integer fits as a non-negative int, compute an int
 ** remainder, which is faster. Otherwise, use an unsigned-integer
 ** remainder, which uses all bits and ensures a non-negative result.
+** (luaCPP extension) Without a divide both cases cost the same.
 */
 static Node *hashint (const Table *t, lua_Integer i) {
   lua_Unsigned ui = l_castS2U(i);
+#if !defined(hashmulhi)
   if (ui <= cast_uint(INT_MAX))
     return hashmod(t, cast_int(ui));
   else
+#endif
     return hashmod(t, ui);
 }
 
@@ -592,6 +648,77 @@ void luaH_resizearray (lua_State *L, Table *t, unsigned int nasize) {
   luaH_resize(L, t, nasize, nsize);
 }
 
+
+/*
+** {======================================================
+** Bulk transfer of numeric arrays (luaCPP extension)
+** =======================================================
+*/
+
+/*
+** Stores 'n' numbers into t[1..n], growing the array part to at least
+** 'n' slots first so every value goes straight into 't->array'. Numbers
+** are not collectable, so no GC barrier is needed.
+*/
+void luaH_setnumbers (lua_State *L, Table *t, const lua_Number *v,
+                                              unsigned int n) {
+  unsigned int i;
+  if (luaH_realasize(t) < n)
+    luaH_resizearray(L, t, n);
+  for (i = 0; i < n; i++)
+    setfltvalue(&t->array[i], v[i]);
+}
+
+
+void luaH_setintegers (lua_State *L, Table *t, const lua_Integer *v,
+                                               unsigned int n) {
+  unsigned int i;
+  if (luaH_realasize(t) < n)
+    luaH_resizearray(L, t, n);
+  for (i = 0; i < n; i++)
+    setivalue(&t->array[i], v[i]);
+}
+
+
+/*
+** Reads t[1..n] into 'v' and returns how many leading values were
+** numbers. Reading stops at the first value that is not a number.
+*/
+unsigned int luaH_getnumbers (Table *t, lua_Number *v, unsigned int n) {
+  unsigned int asize = luaH_realasize(t);
+  unsigned int i;
+  for (i = 0; i < n; i++) {
+    const TValue *o = (i < asize) ? &t->array[i] : luaH_getint(t, i + 1);
+    if (ttisfloat(o))
+      v[i] = fltvalue(o);
+    else if (ttisinteger(o))
+      v[i] = cast_num(ivalue(o));
+    else
+      break;
+  }
+  return i;
+}
+
+
+/*
+** Same as 'luaH_getnumbers' for integers. Floats with an exact integer
+** representation are converted, other values stop the reading.
+*/
+unsigned int luaH_getintegers (Table *t, lua_Integer *v, unsigned int n) {
+  unsigned int asize = luaH_realasize(t);
+  unsigned int i;
+  for (i = 0; i < n; i++) {
+    const TValue *o = (i < asize) ? &t->array[i] : luaH_getint(t, i + 1);
+    if (ttisinteger(o))
+      v[i] = ivalue(o);
+    else if (!ttisfloat(o) || !luaV_tointegerns(o, &v[i], F2Ieq))
+      break;
+  }
+  return i;
+}
+
+/* }====================================================== */
+
 /*
 ** nums[i] = number of keys 'k' where 2^(i - 1) < k <= 2^i
 */
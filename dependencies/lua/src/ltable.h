@@ -51,6 +51,13 @@ LUAI_FUNC Table *luaH_new (lua_State *L);
 LUAI_FUNC void luaH_resize (lua_State *L, Table *t, unsigned int nasize,
                                                     unsigned int nhsize);
 LUAI_FUNC void luaH_resizearray (lua_State *L, Table *t, unsigned int nasize);
+LUAI_FUNC void luaH_setnumbers (lua_State *L, Table *t, const lua_Number *v,
+                                                        unsigned int n);
+LUAI_FUNC void luaH_setintegers (lua_State *L, Table *t, const lua_Integer *v,
+                                                         unsigned int n);
+LUAI_FUNC unsigned int luaH_getnumbers (Table *t, lua_Number *v, unsigned int n);
+LUAI_FUNC unsigned int luaH_getintegers (Table *t, lua_Integer *v,
+                                                   unsigned int n);
 LUAI_FUNC void luaH_free (lua_State *L, Table *t);
 LUAI_FUNC int luaH_next (lua_State *L, Table *t, StkId key);
 LUAI_FUNC lua_Unsigned luaH_getn (Table *t);
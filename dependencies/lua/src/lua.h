@@ -285,6 +285,18 @@ LUA_API void  (lua_rawsetp) (lua_State *L, int idx, const void *p);
 LUA_API int   (lua_setmetatable) (lua_State *L, int objindex);
 LUA_API int   (lua_setiuservalue) (lua_State *L, int idx, int n);
 
+/*
+** bulk transfer of numeric arrays (luaCPP extension)
+*/
+LUA_API void  (lua_rawsetnumbers) (lua_State *L, int idx, const lua_Number *v,
+                                                        unsigned int n);
+LUA_API void  (lua_rawsetintegers) (lua_State *L, int idx,
+                                    const lua_Integer *v, unsigned int n);
+LUA_API unsigned int (lua_rawgetnumbers) (lua_State *L, int idx,
+                                          lua_Number *v, unsigned int n);
+LUA_API unsigned int (lua_rawgetintegers) (lua_State *L, int idx,
+                                           lua_Integer *v, unsigned int n);
+
 
 /*
 ** 'load' and 'call' functions (load and run Lua code)
@@ -341,6 +353,18 @@ LUA_API void (lua_warning)  (lua_State *L, const char *msg, int tocont);
 
 LUA_API int (lua_gc) (lua_State *L, int what, ...);
 
+/*
+** garbage-collection hook (luaCPP extension)
+** Called before ('done' == 0) and after ('done' == 1) every collector step
+** and full collection. The hook must not raise errors nor allocate memory.
+*/
+#define LUA_GCHOOKSTEP		0
+#define LUA_GCHOOKFULL		1
+
+typedef void (*lua_GCHook) (void *ud, int event, int done);
+
+LUA_API void (lua_setgchook) (lua_State *L, lua_GCHook f, void *ud);
+
 
 /*
 ** miscellaneous functions
@@ -470,6 +494,13 @@ LUA_API lua_Hook (lua_gethook) (lua_State *L);
 LUA_API int (lua_gethookmask) (lua_State *L);
 LUA_API int (lua_gethookcount) (lua_State *L);
 
+/*
+** inherited hook (luaCPP extension)
+** A coroutine resumed by a thread whose hook is 'f' or none takes over
+** that hook, mask and count, unless it has a different hook of its own.
+*/
+LUA_API void (lua_sethookinherit) (lua_State *L, lua_Hook f);
+
 LUA_API int (lua_setcstacklimit) (lua_State *L, unsigned int limit);
 
 struct lua_Debug {
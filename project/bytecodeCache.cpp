@@ -0,0 +1,162 @@
+#include "bytecodeCache.h"
+#include "luaStack.h"
+
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    constexpr char BYTECODE_MAGIC[8] = {'L', 'U', 'A', 'C', 'P', 'P', 'B', 'C'};
+
+    struct BytecodeHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t headerSize;
+        std::int64_t mtime;
+        std::uint64_t contentHash;
+        std::uint64_t bytecodeSize;
+    };
+
+    int writeChunk(lua_State*, const void* data, std::size_t size, void* userData)
+    {
+        static_cast<std::string*>(userData)->append(static_cast<const char*>(data), size);
+        return 0;
+    }
+
+    bool readFile(const std::filesystem::path& path, std::string& content)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if(!file)
+            return false;
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return !file.bad();
+    }
+}
+
+BytecodeCache::BytecodeCache(const std::filesystem::path& cacheDir)
+: mCacheDir(cacheDir)
+{}
+
+FuncInfo BytecodeCache::load(lua_State* L, const std::filesystem::path& scriptPath) const
+{
+    using enum FuncInfoType;
+    std::string source;
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(scriptPath, ec);
+    if(ec || !readFile(scriptPath, source))
+    {
+        std::string errmsg;
+        errmsg.append("Failed to load lua script with path[").append(scriptPath.string()).append("] - ").append(ec ? ec.message() : "unreadable file");
+        return FuncInfo(errmsg, LOAD);
+    }
+
+    std::string chunkName = "@" + scriptPath.string();
+    auto mtimeCount = static_cast<std::int64_t>(mtime.time_since_epoch().count());
+    auto contentHash = hash(source);
+    auto cachePath = getCachePath(scriptPath);
+
+    if(loadCached(L, cachePath, chunkName, mtimeCount, contentHash))
+        return FuncInfo(OK);
+
+    if(int status = ::luaL_loadbufferx(L, source.data(), source.size(), chunkName.c_str(), "t"); status != LUA_OK)
+    {
+        std::string errmsg;
+        errmsg.append("Failed to compile lua script with path[").append(scriptPath.string()).append("] - ").append(LuaStack::errorMessage(L, -1));
+        lua_pop(L, 1);
+        return FuncInfo(errmsg, status == LUA_ERRMEM ? MEMORY : COMPILE);
+    }
+
+    std::string bytecode;
+    if(::lua_dump(L, writeChunk, &bytecode, 0) == 0)
+        store(cachePath, bytecode, mtimeCount, contentHash);
+    return FuncInfo(OK);
+}
+
+const std::filesystem::path& BytecodeCache::getCacheDir() const
+{
+    return mCacheDir;
+}
+
+std::filesystem::path BytecodeCache::getCachePath(const std::filesystem::path& scriptPath) const
+{
+    std::error_code ec;
+    auto absolute = std::filesystem::absolute(scriptPath, ec);
+    std::ostringstream name;
+    name << std::hex << hash((ec ? scriptPath : absolute).lexically_normal().string()) << ".luac";
+    return mCacheDir / name.str();
+}
+
+std::uint64_t BytecodeCache::hash(std::string_view data)
+{
+    std::uint64_t h = 14695981039346656037ull;
+    for(unsigned char c : data)
+    {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+bool BytecodeCache::loadCached(lua_State* L, const std::filesystem::path& cachePath, std::string_view chunkName,
+                               std::int64_t mtime, std::uint64_t contentHash) const
+{
+    std::string cached;
+    if(!readFile(cachePath, cached) || cached.size() < sizeof(BytecodeHeader))
+        return false;
+
+    BytecodeHeader header;
+    std::memcpy(&header, cached.data(), sizeof(BytecodeHeader));
+    if(std::memcmp(header.magic, BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC)) != 0 ||
+       header.version != LUA_VERSION_NUM || header.headerSize != sizeof(BytecodeHeader) ||
+       header.mtime != mtime || header.contentHash != contentHash ||
+       header.bytecodeSize != cached.size() - sizeof(BytecodeHeader))
+        return false;
+
+    const char* bytecode = cached.data() + sizeof(BytecodeHeader);
+    if(::luaL_loadbufferx(L, bytecode, header.bytecodeSize, std::string(chunkName).c_str(), "b") != LUA_OK)
+    {
+        lua_pop(L, 1);
+        return false;
+    }
+    return true;
+}
+
+void BytecodeCache::store(const std::filesystem::path& cachePath, std::string_view bytecode,
+                          std::int64_t mtime, std::uint64_t contentHash) const
+{
+    std::error_code ec;
+    std::filesystem::create_directories(mCacheDir, ec);
+    if(ec)
+        return;
+
+    BytecodeHeader header{};
+    std::memcpy(header.magic, BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC));
+    header.version = LUA_VERSION_NUM;
+    header.headerSize = sizeof(BytecodeHeader);
+    header.mtime = mtime;
+    header.contentHash = contentHash;
+    header.bytecodeSize = bytecode.size();
+
+    auto tmpPath = cachePath;
+    tmpPath += "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if(!file)
+            return;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(BytecodeHeader));
+        file.write(bytecode.data(), static_cast<std::streamsize>(bytecode.size()));
+        if(!file)
+        {
+            file.close();
+            std::filesystem::remove(tmpPath, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tmpPath, cachePath, ec);
+    if(ec)
+        std::filesystem::remove(tmpPath, ec);
+}
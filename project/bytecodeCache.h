@@ -0,0 +1,67 @@
+#ifndef BYTECODE_CACHE_H
+#define BYTECODE_CACHE_H
+
+#include <lua.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include "funcInfo.h"
+
+/**
+ * @class BytecodeCache
+ * @brief Persists precompiled Lua chunks so scripts skip the parser on later loads.
+ *
+ * Cache entries are keyed by the script path and validated against the modification time and a
+ * hash of the script content. Stale or unreadable entries fall back to compiling the source,
+ * which then refreshes the entry.
+ */
+class BytecodeCache
+{
+private:
+    std::filesystem::path mCacheDir = ""; /**< Directory that holds the cached chunks. */
+
+public:
+    /**
+     * @brief Constructor with the directory that holds the cached chunks.
+     * @param cacheDir Cache directory. It is created on the first store.
+     */
+    explicit BytecodeCache(const std::filesystem::path& cacheDir);
+
+    /**
+     * @brief Loads the script as a chunk onto the Lua stack, from the cache when it is up to date.
+     * @param L Lua state to load the chunk into.
+     * @param scriptPath Path to the Lua script file.
+     * @return OK with the chunk on top of the stack, otherwise LOAD or COMPILE with nothing pushed.
+     */
+    FuncInfo load(lua_State* L, const std::filesystem::path& scriptPath) const;
+
+    /**
+     * @brief Retrieves the cache directory.
+     * @return Cache directory.
+     */
+    const std::filesystem::path& getCacheDir() const;
+
+    /**
+     * @brief Retrieves the cache file used for the given script.
+     * @param scriptPath Path to the Lua script file.
+     * @return Path of the cache file.
+     */
+    std::filesystem::path getCachePath(const std::filesystem::path& scriptPath) const;
+
+    /**
+     * @brief Hashes the given data with 64 bit FNV-1a.
+     * @param data Data to hash.
+     * @return Hash of the data.
+     */
+    static std::uint64_t hash(std::string_view data);
+
+private:
+    bool loadCached(lua_State* L, const std::filesystem::path& cachePath, std::string_view chunkName,
+                    std::int64_t mtime, std::uint64_t contentHash) const;
+    void store(const std::filesystem::path& cachePath, std::string_view bytecode,
+               std::int64_t mtime, std::uint64_t contentHash) const;
+};
+
+#endif // BYTECODE_CACHE_H
@@ -11,6 +11,8 @@ enum class FuncInfoType : int
     LOAD = -1,
     COMPILE = -2,
     RUN = -3,
+    MEMORY = -4,
+    TIMEOUT = -5,
 };
 
 class FuncInfo
@@ -0,0 +1,224 @@
+#include "luaAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace
+{
+    constexpr std::size_t Alignment = alignof(std::max_align_t);
+
+    constexpr std::size_t alignUp(std::size_t size)
+    {
+        return (size + Alignment - 1) & ~(Alignment - 1);
+    }
+}
+
+LuaPoolAllocator::LuaPoolAllocator(std::size_t chunkSize)
+: mChunkSize(std::max(chunkSize, MaxSmallSize + sizeof(ChunkLink)))
+{
+}
+
+LuaPoolAllocator::~LuaPoolAllocator()
+{
+    reset();
+}
+
+void* LuaPoolAllocator::reallocate(void* ptr, std::size_t osize, std::size_t nsize)
+{
+    if(nsize == 0)
+    {
+        if(ptr == nullptr)
+            return nullptr;
+        if(osize <= MaxSmallSize)
+            freeSmall(ptr, sizeClass(osize));
+        else
+            std::free(ptr);
+        return nullptr;
+    }
+
+    if(ptr == nullptr)
+    {
+        if(nsize <= MaxSmallSize)
+            return allocateSmall(sizeClass(nsize));
+        return std::malloc(nsize + sizeof(ChunkLink));
+    }
+
+    bool oldSmall = osize <= MaxSmallSize;
+    bool newSmall = nsize <= MaxSmallSize;
+    if(!oldSmall && !newSmall)
+        return std::realloc(ptr, nsize + sizeof(ChunkLink));
+    if(oldSmall && newSmall && sizeClass(osize) == sizeClass(nsize))
+        return ptr;
+
+    void* block = newSmall ? allocateSmall(sizeClass(nsize)) : std::malloc(nsize + sizeof(ChunkLink));
+    if(block == nullptr)
+    {
+        // Lua expects shrinking to succeed
+        if(oldSmall)
+            return nsize <= osize ? ptr : nullptr;
+        // the big block would later be freed as a small one, so it becomes a chunk that starts with the small
+        // block and whose remainder serves further small blocks
+        addChunk(ptr, osize + sizeof(ChunkLink), (sizeClass(nsize) + 1) * Granularity);
+        return ptr;
+    }
+    std::memcpy(block, ptr, std::min(osize, nsize));
+    if(oldSmall)
+        freeSmall(ptr, sizeClass(osize));
+    else
+        std::free(ptr);
+    return block;
+}
+
+void LuaPoolAllocator::reset()
+{
+    while(mChunks != nullptr)
+    {
+        ChunkLink* link = mChunks;
+        mChunks = link->next;
+        std::free(link->chunk);
+    }
+    mFreeLists.fill(nullptr);
+    mCursor = nullptr;
+    mEnd = nullptr;
+}
+
+void* LuaPoolAllocator::allocateSmall(std::size_t sizeClass)
+{
+    FreeBlock* block = mFreeLists[sizeClass];
+    if(block != nullptr)
+    {
+        mFreeLists[sizeClass] = block->next;
+        return block;
+    }
+
+    std::size_t blockSize = (sizeClass + 1) * Granularity;
+    if(static_cast<std::size_t>(mEnd - mCursor) < blockSize)
+    {
+        void* chunk = std::malloc(mChunkSize);
+        if(chunk == nullptr)
+            return nullptr;
+        addChunk(chunk, mChunkSize, 0);
+    }
+    void* result = mCursor;
+    mCursor += blockSize;
+    return result;
+}
+
+void LuaPoolAllocator::addChunk(void* chunk, std::size_t size, std::size_t used)
+{
+    // the link takes the last aligned slot, the remainder of the current chunk is given up
+    char* begin = static_cast<char*>(chunk);
+    char* end = begin + (size - sizeof(ChunkLink)) / alignof(ChunkLink) * alignof(ChunkLink);
+    mChunks = new (end) ChunkLink{mChunks, chunk};
+    mCursor = begin + used;
+    mEnd = end;
+}
+
+void LuaPoolAllocator::freeSmall(void* ptr, std::size_t sizeClass)
+{
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = mFreeLists[sizeClass];
+    mFreeLists[sizeClass] = block;
+}
+
+std::size_t LuaPoolAllocator::sizeClass(std::size_t size)
+{
+    return (size + Granularity - 1) / Granularity - 1;
+}
+
+LuaArenaAllocator::LuaArenaAllocator(std::size_t chunkSize)
+: mChunkSize(alignUp(std::max<std::size_t>(chunkSize, 4096)))
+{
+}
+
+LuaArenaAllocator::~LuaArenaAllocator()
+{
+    reset();
+}
+
+void* LuaArenaAllocator::reallocate(void* ptr, std::size_t osize, std::size_t nsize)
+{
+    if(nsize == 0)
+    {
+        if(ptr != nullptr && ptr == mLast)
+        {
+            mCursor = mLast;
+            mLast = nullptr;
+        }
+        return nullptr;
+    }
+
+    if(ptr == nullptr)
+        return allocate(nsize);
+
+    if(ptr == mLast && static_cast<std::size_t>(mEnd - mLast) >= alignUp(nsize))
+    {
+        mCursor = mLast + alignUp(nsize);
+        return ptr;
+    }
+    if(nsize <= osize)
+        return ptr;
+
+    void* block = allocate(nsize);
+    if(block != nullptr)
+        std::memcpy(block, ptr, osize);
+    return block;
+}
+
+void LuaArenaAllocator::reset()
+{
+    for(void* chunk : mChunks)
+        std::free(chunk);
+    mChunks.clear();
+    mCursor = nullptr;
+    mEnd = nullptr;
+    mLast = nullptr;
+    mReserved = 0;
+}
+
+std::size_t LuaArenaAllocator::reserved() const
+{
+    return mReserved;
+}
+
+void* LuaArenaAllocator::allocate(std::size_t size)
+{
+    size = alignUp(size);
+    if(static_cast<std::size_t>(mEnd - mCursor) < size)
+    {
+        // Big blocks get a chunk of their own so the current chunk keeps serving small ones.
+        if(size > mChunkSize / 4)
+        {
+            if(!newChunk(size))
+                return nullptr;
+            return mChunks.back();
+        }
+        if(!newChunk(mChunkSize))
+            return nullptr;
+        mCursor = static_cast<char*>(mChunks.back());
+        mEnd = mCursor + mChunkSize;
+    }
+    mLast = mCursor;
+    mCursor += size;
+    return mLast;
+}
+
+bool LuaArenaAllocator::newChunk(std::size_t size)
+{
+    void* chunk = std::malloc(size);
+    if(chunk == nullptr)
+        return false;
+    try
+    {
+        mChunks.push_back(chunk);
+    }
+    catch(const std::bad_alloc&)
+    {
+        std::free(chunk);
+        return false;
+    }
+    mReserved += size;
+    return true;
+}
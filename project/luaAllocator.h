@@ -0,0 +1,154 @@
+#ifndef LUA_ALLOCATOR_H
+#define LUA_ALLOCATOR_H
+
+#include <lua.hpp>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @struct LuaMemoryStats
+ * @brief Memory accounting of a Lua state.
+ */
+struct LuaMemoryStats
+{
+    std::size_t current = 0; /**< Bytes currently allocated. */
+    std::size_t peak = 0; /**< Highest value of current since creation or the last peak reset. */
+    std::size_t limit = 0; /**< Hard cap in bytes, zero for no limit. */
+    std::size_t allocations = 0; /**< Number of new blocks. */
+    std::size_t reallocations = 0; /**< Number of resized blocks. */
+    std::size_t frees = 0; /**< Number of freed blocks. */
+    std::size_t failures = 0; /**< Number of requests refused by the limit or the allocator. */
+};
+
+/**
+ * @class LuaAllocator
+ * @brief Allocation policy for the memory of a Lua state.
+ *
+ * The allocator follows the contract of `lua_Alloc`: a `nsize` of zero frees the block and the
+ * `osize` of an existing block is always the size it was allocated with. An allocator is not
+ * thread safe and must outlive every state that uses it.
+ */
+class LuaAllocator
+{
+public:
+    virtual ~LuaAllocator() = default;
+
+    /**
+     * @brief Allocates, resizes or frees a block.
+     * @param ptr Block to resize or free, nullptr for a new block.
+     * @param osize Current size of the block. Only meaningful when ptr is not nullptr.
+     * @param nsize Requested size. Zero frees the block.
+     * @return The new block, or nullptr when the block was freed or the request failed.
+     */
+    virtual void* reallocate(void* ptr, std::size_t osize, std::size_t nsize) = 0;
+
+    /**
+     * @brief Releases all memory held by the allocator. Only valid when no state uses it anymore.
+     */
+    virtual void reset() {}
+};
+
+/**
+ * @class LuaPoolAllocator
+ * @brief Allocator with free lists for small size classes.
+ *
+ * Blocks up to `MaxSmallSize` bytes are carved from large chunks and recycled through one free list
+ * per size class, which suits the many small strings, tables and closures of a Lua state. Bigger
+ * blocks go straight to the system allocator. When a big block is shrunk to a small size while no
+ * small block can be allocated, the big block becomes a chunk of the pool, so it is still released.
+ */
+class LuaPoolAllocator : public LuaAllocator
+{
+public:
+    static constexpr std::size_t Granularity = 16; /**< Step between two size classes. */
+    static constexpr std::size_t MaxSmallSize = 512; /**< Largest block served from the pool. */
+    static constexpr std::size_t ClassCount = MaxSmallSize / Granularity;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    /**
+     * Link stored at the end of every chunk, so recording a chunk never allocates.
+     * Big blocks are allocated with room for one, which lets them become a chunk.
+     */
+    struct alignas(Granularity) ChunkLink
+    {
+        ChunkLink* next;
+        void* chunk;
+    };
+
+    std::array<FreeBlock*, ClassCount> mFreeLists = {}; /**< Free blocks per size class. */
+    ChunkLink* mChunks = nullptr; /**< Chunks the small blocks are carved from. */
+    std::size_t mChunkSize = 0; /**< Size of a chunk in bytes. */
+    char* mCursor = nullptr; /**< Next unused byte of the current chunk. */
+    char* mEnd = nullptr; /**< End of the current chunk. */
+
+public:
+    /**
+     * @brief Constructor with the size of the chunks small blocks are carved from.
+     * @param chunkSize Size of a chunk in bytes.
+     */
+    explicit LuaPoolAllocator(std::size_t chunkSize = 64 * 1024);
+    ~LuaPoolAllocator() override;
+
+    LuaPoolAllocator(const LuaPoolAllocator&) = delete;
+    LuaPoolAllocator& operator=(const LuaPoolAllocator&) = delete;
+
+    void* reallocate(void* ptr, std::size_t osize, std::size_t nsize) override;
+    void reset() override;
+
+private:
+    void* allocateSmall(std::size_t sizeClass);
+    void freeSmall(void* ptr, std::size_t sizeClass);
+    void addChunk(void* chunk, std::size_t size, std::size_t used);
+    static std::size_t sizeClass(std::size_t size);
+};
+
+/**
+ * @class LuaArenaAllocator
+ * @brief Bump allocator that releases its memory all at once.
+ *
+ * Blocks are handed out sequentially from large chunks and individual frees only reclaim the most
+ * recent block. All memory is returned on `reset` or destruction, which makes it a good fit for
+ * short lived states that run one script and are closed afterwards.
+ */
+class LuaArenaAllocator : public LuaAllocator
+{
+private:
+    std::vector<void*> mChunks = {}; /**< Chunks owned by the arena. */
+    std::size_t mChunkSize = 0; /**< Default size of a chunk in bytes. */
+    char* mCursor = nullptr; /**< Next unused byte of the current chunk. */
+    char* mEnd = nullptr; /**< End of the current chunk. */
+    char* mLast = nullptr; /**< Most recent block, the only one that can be resized in place. */
+    std::size_t mReserved = 0; /**< Bytes reserved from the system. */
+
+public:
+    /**
+     * @brief Constructor with the default size of the chunks.
+     * @param chunkSize Size of a chunk in bytes. Bigger blocks get a chunk of their own.
+     */
+    explicit LuaArenaAllocator(std::size_t chunkSize = 256 * 1024);
+    ~LuaArenaAllocator() override;
+
+    LuaArenaAllocator(const LuaArenaAllocator&) = delete;
+    LuaArenaAllocator& operator=(const LuaArenaAllocator&) = delete;
+
+    void* reallocate(void* ptr, std::size_t osize, std::size_t nsize) override;
+    void reset() override;
+
+    /**
+     * @brief Gets the number of bytes reserved from the system.
+     * @return Reserved bytes.
+     */
+    std::size_t reserved() const;
+
+private:
+    void* allocate(std::size_t size);
+    bool newChunk(std::size_t size);
+};
+
+#endif // LUA_ALLOCATOR_H
@@ -0,0 +1,61 @@
+#include "luaAsync.h"
+
+LuaAsyncCompletion::LuaAsyncCompletion(std::shared_ptr<LuaAsyncState> state)
+: mState(std::move(state))
+{}
+
+bool LuaAsyncCompletion::isValid() const
+{
+    return mState != nullptr;
+}
+
+LuaAsyncCompletion::operator bool() const
+{
+    return isValid();
+}
+
+void LuaAsyncCompletion::deliver(const std::shared_ptr<LuaAsyncState>& state)
+{
+    // a completion from inside the async function is picked up once the task yielded
+    if(!state->running && !state->finished)
+        state->owner->step(state);
+}
+
+LuaAsync::LuaAsync(LuaScript& script)
+: mScript(script)
+{}
+
+void LuaAsync::step(const std::shared_ptr<LuaAsyncState>& state)
+{
+    state->running = true;
+    while(true)
+    {
+        if(state->results)
+        {
+            state->task.clearResults();
+            state->nargs = state->results(state->task.getThread());
+            state->results = nullptr;
+        }
+        state->pending = false;
+
+        auto caller = std::exchange(mCurrent, state);
+        state->info = mScript.resumeTask(state->task, state->nargs);
+        mCurrent = std::move(caller);
+        state->nargs = 0;
+
+        if(state->task.getStatus() != LuaTaskStatus::YIELDED)
+        {
+            state->finished = true;
+            break;
+        }
+        // a plain coroutine.yield continues right away, an async function continues on completion
+        if(state->pending && !state->results)
+            break;
+        if(!state->pending)
+            state->task.clearResults();
+    }
+    state->running = false;
+
+    if(state->finished && state->waiter)
+        std::exchange(state->waiter, nullptr).resume();
+}
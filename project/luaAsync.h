@@ -0,0 +1,268 @@
+#ifndef LUA_ASYNC_H
+#define LUA_ASYNC_H
+
+#include <lua.hpp>
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "luaScript.h"
+#include "luaTask.h"
+#include "luaStack.h"
+#include "funcInfo.h"
+
+class LuaAsync;
+
+/**
+ * @struct LuaAsyncState
+ * @brief Shared state of an asynchronous call, owned by the awaiter and the pending completion.
+ */
+struct LuaAsyncState
+{
+    LuaAsync* owner = nullptr; /**< Bridge that drives the task. */
+    LuaTask task = {}; /**< Task running the Lua function. */
+    int nargs = 0; /**< Values pushed for the next resume. */
+    std::function<int(lua_State*)> results = nullptr; /**< Pushes the values of a completed async function. */
+    FuncInfo info = FuncInfo(); /**< Outcome of the last resume. */
+    std::coroutine_handle<> waiter = nullptr; /**< C++ coroutine awaiting the call. */
+    bool running = false; /**< Set while the task is resumed. */
+    bool pending = false; /**< Set when the task yielded to an async function. */
+    bool finished = false; /**< Set once the task returned or failed. */
+};
+
+/**
+ * @class LuaAsyncCompletion
+ * @brief Handle given to an async function to deliver its results.
+ *
+ * Completing resumes the Lua task, so it has to be called on the thread that owns the LuaScript,
+ * e.g. from the event loop. Only the first completion is delivered.
+ */
+class LuaAsyncCompletion
+{
+private:
+    std::shared_ptr<LuaAsyncState> mState = nullptr; /**< Call to complete. */
+
+public:
+    LuaAsyncCompletion() = default;
+    explicit LuaAsyncCompletion(std::shared_ptr<LuaAsyncState> state);
+
+    /**
+     * @brief Delivers the results of the async function and continues the Lua task.
+     * @tparam Args Types of the results.
+     * @param args Results returned to the script by the async function.
+     */
+    template<typename... Args>
+    void complete(const Args&... args)
+    {
+        auto state = std::exchange(mState, nullptr);
+        if(!state)
+            return;
+        state->results = [args...](lua_State* L) -> int
+        {
+            (LuaStack::push(L, args), ...);
+            return static_cast<int>(sizeof...(Args));
+        };
+        deliver(state);
+    }
+
+    bool isValid() const;
+    explicit operator bool() const;
+
+private:
+    static void deliver(const std::shared_ptr<LuaAsyncState>& state);
+};
+
+/**
+ * @class LuaCallAwaiter
+ * @brief Awaiter of a Lua function call started with LuaAsync::call.
+ *
+ * The function runs when the awaiter is awaited. It suspends the awaiting coroutine while the
+ * script waits on an async function and resumes it once the Lua function returned.
+ * @tparam R Types of the return values.
+ */
+template<typename... R>
+class LuaCallAwaiter
+{
+    static_assert((!std::is_same_v<LuaStack::Plain<R>, std::string_view> && ...), "Return values are popped, use std::string instead of std::string_view");
+
+private:
+    std::shared_ptr<LuaAsyncState> mState = nullptr; /**< Call to await. */
+
+public:
+    explicit LuaCallAwaiter(std::shared_ptr<LuaAsyncState> state)
+    : mState(std::move(state))
+    {}
+
+    LuaCallAwaiter(const LuaCallAwaiter&) = delete;
+    LuaCallAwaiter& operator=(const LuaCallAwaiter&) = delete;
+    LuaCallAwaiter(LuaCallAwaiter&&) noexcept = default;
+    LuaCallAwaiter& operator=(LuaCallAwaiter&&) noexcept = default;
+
+    /**
+     * @brief Destructor. A call that is still pending no longer resumes the destroyed coroutine.
+     */
+    ~LuaCallAwaiter()
+    {
+        if(mState)
+            mState->waiter = nullptr;
+    }
+
+    /**
+     * @brief Starts the call. Runs the Lua function until it returns or waits on an async function.
+     * @return True if the call already finished.
+     */
+    bool await_ready();
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        mState->waiter = handle;
+    }
+
+    /**
+     * @brief Reads the return values of the finished call.
+     * @return The return values.
+     * @throws std::runtime_error if the Lua function failed.
+     * @throws std::invalid_argument if the returned values do not match R.
+     */
+    std::tuple<R...> await_resume()
+    {
+        if(!mState->info)
+            throw std::runtime_error(std::string(mState->info.getDesc()));
+        return readRets(std::index_sequence_for<R...>{});
+    }
+
+private:
+    template<std::size_t... I>
+    std::tuple<R...> readRets(std::index_sequence<I...>)
+    {
+        constexpr int count = static_cast<int>(sizeof...(R));
+        LuaTask& task = mState->task;
+        lua_State* thread = task.getThread();
+        ::lua_settop(thread, ::lua_gettop(thread) - task.getResultCount() + count);
+        task.setStatus(task.getStatus(), count);
+        std::tuple<LuaStack::Value<R>...> values{};
+        if(!(LuaStack::tryRead<R>(thread, static_cast<int>(I) - count, std::get<I>(values)) && ...))
+            throw std::invalid_argument("Failed to get return value. Returned values do not match the expected types");
+        return std::tuple<R...>{std::move(std::get<I>(values))...};
+    }
+};
+
+/**
+ * @class LuaAsync
+ * @brief Bridge that lets C++20 coroutines await Lua functions.
+ *
+ * `co_await async.call<R...>("name", args...)` runs the Lua function in a LuaTask. When the script
+ * calls a function registered with regAsync, the task yields and the awaiting coroutine is suspended
+ * until the async function completes, so event loop threads never block on a script. The bridge is
+ * bound to the thread that owns the LuaScript.
+ */
+class LuaAsync
+{
+private:
+    LuaScript& mScript; /**< Script the calls run in. */
+    std::shared_ptr<LuaAsyncState> mCurrent = nullptr; /**< Call whose task is running. */
+
+public:
+    /**
+     * @brief Constructor with the script the calls run in.
+     * @param script Script the calls run in. It must outlive the bridge and every pending call.
+     */
+    explicit LuaAsync(LuaScript& script);
+
+    LuaAsync(const LuaAsync&) = delete;
+    LuaAsync& operator=(const LuaAsync&) = delete;
+
+    /**
+     * @brief Creates an awaitable call of a global Lua function.
+     * @tparam R Types of the return values.
+     * @tparam Args Types of the arguments.
+     * @param funcName Name of the global Lua function.
+     * @param args Arguments.
+     * @return Awaiter that yields the return values as a tuple.
+     */
+    template<typename... R, typename... Args>
+    LuaCallAwaiter<R...> call(std::string_view funcName, const Args&... args)
+    {
+        return LuaCallAwaiter<R...>(makeState(mScript.createTask(funcName), funcName, args...));
+    }
+
+    /**
+     * @brief Creates an awaitable call of a prepared Lua function.
+     * @tparam R Types of the return values.
+     * @tparam Args Types of the arguments.
+     * @param funcRef Handle returned by LuaScript::prepare.
+     * @param args Arguments.
+     * @return Awaiter that yields the return values as a tuple.
+     */
+    template<typename... R, typename... Args>
+    LuaCallAwaiter<R...> call(const LuaFunctionRef& funcRef, const Args&... args)
+    {
+        return LuaCallAwaiter<R...>(makeState(mScript.createTask(funcRef), funcRef.getName(), args...));
+    }
+
+    /**
+     * @brief Registers an async function. The script waits for its results without blocking the thread.
+     * The function receives the script, with its arguments on the stack, and a completion handle. It starts
+     * the operation and completes the handle later, or right away. Calling it outside of LuaAsync::call
+     * raises a Lua error.
+     * @tparam Func Callable with the signature void(LuaScript&, LuaAsyncCompletion).
+     * @param func Async function.
+     * @param funcName Name of the Lua function.
+     * @return Result of the registration.
+     */
+    template<typename Func>
+        requires std::is_invocable_v<std::decay_t<Func>&, LuaScript&, LuaAsyncCompletion>
+    FuncInfo regAsync(Func&& func, std::string_view funcName)
+    {
+        return mScript.regFunc([this, func = std::forward<Func>(func)](LuaScript& lua) mutable -> int
+        {
+            if(!mCurrent)
+                throw std::runtime_error("async function called outside of an async call");
+            mCurrent->pending = true;
+            func(lua, LuaAsyncCompletion(mCurrent));
+            return lua.yield(0);
+        }, funcName);
+    }
+
+    /**
+     * @brief Resumes the task of a call until it returns or waits on an async function.
+     * @param state Call to continue.
+     */
+    void step(const std::shared_ptr<LuaAsyncState>& state);
+
+private:
+    template<typename... Args>
+    std::shared_ptr<LuaAsyncState> makeState(LuaTask&& task, std::string_view funcName, const Args&... args)
+    {
+        auto state = std::make_shared<LuaAsyncState>();
+        state->owner = this;
+        if(!task)
+        {
+            std::string errmsg;
+            errmsg.append("Failed to run function[").append(funcName).append("] - global is not a function");
+            state->info = FuncInfo(errmsg, FuncInfoType::RUN);
+            state->finished = true;
+            return state;
+        }
+        (LuaStack::push(task.getThread(), args), ...);
+        state->nargs = static_cast<int>(sizeof...(Args));
+        state->task = std::move(task);
+        return state;
+    }
+};
+
+template<typename... R>
+bool LuaCallAwaiter<R...>::await_ready()
+{
+    if(!mState->finished && !mState->running)
+        mState->owner->step(mState);
+    return mState->finished;
+}
+
+#endif // LUA_ASYNC_H
@@ -0,0 +1,247 @@
+#ifndef LUA_BIND_H
+#define LUA_BIND_H
+
+#include <lua.hpp>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "luaStack.h"
+
+/**
+ * @brief Deduces the return and argument types of a callable.
+ * Supports function pointers, member function pointers and class types with a non template operator().
+ */
+template<typename T>
+struct FuncTraits : FuncTraits<decltype(&T::operator())> {};
+
+template<typename R, typename... A>
+struct FuncTraits<R(*)(A...)>
+{
+    using Ret = R;
+    using Args = std::tuple<A...>;
+};
+
+template<typename R, typename... A>
+struct FuncTraits<R(*)(A...) noexcept> : FuncTraits<R(*)(A...)> {};
+
+template<typename R, typename C, typename... A>
+struct FuncTraits<R(C::*)(A...)> : FuncTraits<R(*)(A...)> {};
+
+template<typename R, typename C, typename... A>
+struct FuncTraits<R(C::*)(A...) const> : FuncTraits<R(*)(A...)> {};
+
+template<typename R, typename C, typename... A>
+struct FuncTraits<R(C::*)(A...) noexcept> : FuncTraits<R(*)(A...)> {};
+
+template<typename R, typename C, typename... A>
+struct FuncTraits<R(C::*)(A...) const noexcept> : FuncTraits<R(*)(A...)> {};
+
+/**
+ * @brief Binds C++ callables as Lua C closures.
+ *
+ * The callable is moved into a full userdata that becomes an upvalue of the closure. Arguments are read from
+ * the Lua stack and results are pushed back by compile time dispatch through LuaStack.
+ */
+struct LuaBind
+{
+    /**
+     * @brief Moves a callable into a new full userdata on top of the stack.
+     * A __gc metatable shared by all callables of the same type destroys it together with the userdata.
+     * @tparam Func Type of the callable.
+     * @param L Lua state.
+     * @param func Callable to store.
+     */
+    template<typename Func>
+    static void pushCallable(lua_State* L, Func&& func)
+    {
+        using Closure = std::decay_t<Func>;
+        static_assert(alignof(Closure) <= alignof(std::max_align_t) && alignof(Closure) <= 8, "Callable is over aligned for a lua userdata");
+
+        void* mem = ::lua_newuserdatauv(L, sizeof(Closure), 0);
+        new (mem) Closure(std::forward<Func>(func));
+        if constexpr (!std::is_trivially_destructible_v<Closure>)
+        {
+            if(::lua_rawgetp(L, LUA_REGISTRYINDEX, &sClosureMeta<Closure>) == LUA_TNIL)
+            {
+                lua_pop(L, 1);
+                ::lua_createtable(L, 0, 1);
+                ::lua_pushcfunction(L, &destroyCallable<Closure>);
+                ::lua_setfield(L, -2, "__gc");
+                ::lua_pushvalue(L, -1);
+                ::lua_rawsetp(L, LUA_REGISTRYINDEX, &sClosureMeta<Closure>);
+            }
+            ::lua_setmetatable(L, -2);
+        }
+    }
+
+    /**
+     * @brief Pushes a C closure that reads its arguments from the Lua stack, calls the callable and pushes its results.
+     * @tparam Func Type of the callable. Its signature must not be overloaded or templated.
+     * @param L Lua state.
+     * @param func Callable to bind.
+     */
+    template<typename Func>
+    static void pushFunction(lua_State* L, Func&& func)
+    {
+        pushCallable(L, std::forward<Func>(func));
+        ::lua_pushcclosure(L, &invoke<std::decay_t<Func>>, 1);
+    }
+
+    /**
+     * @brief Lua entry point of a bound callable.
+     * Only trivially destructible locals live in this frame, so raising a Lua error here is safe.
+     */
+    template<typename Closure>
+    static int invoke(lua_State* L)
+    {
+        int badArg = 0;
+        const char* expected = nullptr;
+        int ret = call<Closure>(L, *static_cast<Closure*>(::lua_touserdata(L, lua_upvalueindex(1))), badArg, expected);
+        if(badArg)
+            return ::luaL_typeerror(L, badArg, expected);
+        if(ret < 0)
+            return ::lua_error(L);
+        return ret;
+    }
+
+    /**
+     * @brief Reads the arguments, calls the callable and pushes its results without raising a Lua error,
+     * so closures with further upvalues can do their own bookkeeping before they raise it. Results that need
+     * memory are pushed in a protected call, a memory error is returned like a C++ exception.
+     * @param L Lua state.
+     * @param func Callable to call.
+     * @param badArg Set to the index of the first argument of the wrong type.
+     * @param expected Set to the type name the bad argument should have.
+     * @return Number of results, 0 if badArg was set, or -1 with the error message of a C++ exception on top of the stack.
+     */
+    template<typename Closure>
+    static int call(lua_State* L, Closure& func, int& badArg, const char*& expected)
+    {
+        using Args = typename FuncTraits<Closure>::Args;
+        try
+        {
+            return callWith<Closure>(L, func, badArg, expected, std::make_index_sequence<std::tuple_size_v<Args>>{});
+        }
+        catch(const std::exception& e)
+        {
+            pushError(L, e.what());
+        }
+        catch(...)
+        {
+            pushError(L, "Unknown C++ exception in registered function");
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Pushes an error message without raising a Lua error, so it can be called from a catch block.
+     * If the message can not be allocated, the memory error message is pushed instead.
+     * @param L Lua state.
+     * @param message Error message to push.
+     */
+    static void pushError(lua_State* L, const char* message)
+    {
+        ::lua_pushcfunction(L, &pushMessage);
+        ::lua_pushlightuserdata(L, const_cast<char*>(message));
+        ::lua_pcall(L, 1, 1, 0);
+    }
+
+private:
+    static int pushMessage(lua_State* L)
+    {
+        ::lua_pushstring(L, static_cast<const char*>(::lua_touserdata(L, 1)));
+        return 1;
+    }
+
+    template<typename Closure, std::size_t... I>
+    static int callWith(lua_State* L, Closure& func, int& badArg, const char*& expected, std::index_sequence<I...>)
+    {
+        using Ret = typename FuncTraits<Closure>::Ret;
+        using Args = typename FuncTraits<Closure>::Args;
+
+        std::tuple<LuaStack::Value<std::tuple_element_t<I, Args>>...> values{};
+        bool valid = ((LuaStack::tryRead<std::tuple_element_t<I, Args>>(L, static_cast<int>(I) + 1, std::get<I>(values)) ||
+                      (badArg = static_cast<int>(I) + 1, expected = LuaStack::typeName<std::tuple_element_t<I, Args>>(), false)) && ...);
+        if(!valid)
+            return 0;
+
+        if constexpr (std::is_void_v<Ret>)
+        {
+            std::invoke(func, forwardArg<std::tuple_element_t<I, Args>>(std::get<I>(values))...);
+            return 0;
+        }
+        else
+        {
+            decltype(auto) result = std::invoke(func, forwardArg<std::tuple_element_t<I, Args>>(std::get<I>(values))...);
+            if(!pushResult<LuaStack::Plain<Ret>>(L, result))
+                return -1;
+            return LuaStack::count<Ret>();
+        }
+    }
+
+    template<typename T>
+    static constexpr bool allocates()
+    {
+        if constexpr (LuaStack::Traits<T>::isOptional)
+            return allocates<LuaStack::Plain<typename LuaStack::Traits<T>::Element>>();
+        else if constexpr (LuaStack::Traits<T>::isTuple)
+            return []<typename... E>(std::type_identity<std::tuple<E...>>) { return (allocates<LuaStack::Plain<E>>() || ...); }(std::type_identity<T>{});
+        else
+            return LuaStack::Traits<T>::isArray || LuaStack::isString<T>;
+    }
+
+    /**
+     * Pushes a result that needs memory or more than the LUA_MINSTACK slots a C function is guaranteed in a
+     * protected call, so a memory or stack error can not unwind the frames that own the arguments and the result.
+     * Returns false with the error on top of the stack.
+     */
+    template<typename T>
+    static bool pushResult(lua_State* L, const T& value)
+    {
+        if constexpr (!allocates<T>() && LuaStack::count<T>() < LUA_MINSTACK)
+        {
+            LuaStack::push(L, value);
+            return true;
+        }
+        else
+        {
+            ::lua_pushcfunction(L, &pushValue<T>);
+            ::lua_pushlightuserdata(L, const_cast<T*>(&value));
+            return ::lua_pcall(L, 1, LuaStack::count<T>(), 0) == LUA_OK;
+        }
+    }
+
+    template<typename T>
+    static int pushValue(lua_State* L)
+    {
+        ::luaL_checkstack(L, LuaStack::count<T>(), nullptr);
+        LuaStack::push(L, *static_cast<const T*>(::lua_touserdata(L, 1)));
+        return LuaStack::count<T>();
+    }
+
+    template<typename Arg>
+    static decltype(auto) forwardArg(LuaStack::Value<Arg>& value)
+    {
+        if constexpr (std::is_same_v<Arg, LuaStack::Value<Arg>>)
+            return std::move(value);
+        else
+            return static_cast<Arg>(value);
+    }
+
+    template<typename Closure>
+    static int destroyCallable(lua_State* L)
+    {
+        static_cast<Closure*>(::lua_touserdata(L, 1))->~Closure();
+        return 0;
+    }
+
+    template<typename Closure>
+    static inline const char sClosureMeta = 0; /**< Registry key of the metatable that destroys callables of this type. */
+};
+
+#endif // LUA_BIND_H
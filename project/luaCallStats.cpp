@@ -0,0 +1,236 @@
+#include "luaCallStats.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <new>
+
+namespace
+{
+    /**
+     * Adds to a counter that only the thread running the state writes.
+     */
+    void addRelaxed(std::atomic<std::uint64_t>& counter, std::uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+}
+
+std::size_t LuaLatencyHistogram::bucketOf(std::uint64_t nanoseconds)
+{
+    // latencies below 2 * subBuckets are exact, above the top subBucketBits + 1 bits select the bucket
+    if(nanoseconds < 2 * subBuckets)
+        return static_cast<std::size_t>(nanoseconds);
+    int shift = static_cast<int>(std::bit_width(nanoseconds)) - (subBucketBits + 1);
+    std::size_t bucket = static_cast<std::size_t>(shift) * subBuckets + static_cast<std::size_t>(nanoseconds >> shift);
+    return std::min(bucket, bucketCount - 1);
+}
+
+std::uint64_t LuaLatencyHistogram::bucketLow(std::size_t bucket)
+{
+    if(bucket < 2 * subBuckets)
+        return bucket;
+    std::size_t shift = bucket / subBuckets - 1;
+    return static_cast<std::uint64_t>(bucket - shift * subBuckets) << shift;
+}
+
+std::uint64_t LuaLatencyHistogram::bucketHigh(std::size_t bucket)
+{
+    if(bucket < 2 * subBuckets)
+        return bucket;
+    std::size_t shift = bucket / subBuckets - 1;
+    return (static_cast<std::uint64_t>(bucket - shift * subBuckets + 1) << shift) - 1;
+}
+
+void LuaLatencyHistogram::add(std::size_t bucket, std::uint64_t count)
+{
+    if(count == 0 || bucket >= bucketCount)
+        return;
+    if(mBuckets.empty())
+        mBuckets.resize(bucketCount);
+    mBuckets[bucket] += count;
+    mCount += count;
+}
+
+void LuaLatencyHistogram::record(std::chrono::nanoseconds latency, std::uint64_t count)
+{
+    add(bucketOf(static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0))), count);
+}
+
+void LuaLatencyHistogram::merge(const LuaLatencyHistogram& other)
+{
+    for(std::size_t i = 0; i < other.mBuckets.size(); i++)
+        add(i, other.mBuckets[i]);
+}
+
+std::chrono::nanoseconds LuaLatencyHistogram::percentile(double percentile) const
+{
+    if(mCount == 0)
+        return std::chrono::nanoseconds::zero();
+    double share = std::clamp(percentile, 0.0, 100.0) / 100.0;
+    auto rank = std::max<std::uint64_t>(static_cast<std::uint64_t>(std::ceil(share * static_cast<double>(mCount))), 1);
+    std::uint64_t seen = 0;
+    for(std::size_t i = 0; i < mBuckets.size(); i++)
+    {
+        seen += mBuckets[i];
+        if(seen >= rank)
+            return std::chrono::nanoseconds(static_cast<std::int64_t>(bucketHigh(i)));
+    }
+    return std::chrono::nanoseconds(static_cast<std::int64_t>(bucketHigh(bucketCount - 1)));
+}
+
+std::uint64_t LuaLatencyHistogram::getCount() const
+{
+    return mCount;
+}
+
+const std::vector<std::uint64_t>& LuaLatencyHistogram::getBuckets() const
+{
+    return mBuckets;
+}
+
+std::chrono::nanoseconds LuaFunctionStatsSnapshot::mean() const
+{
+    if(calls == 0)
+        return std::chrono::nanoseconds::zero();
+    return total / static_cast<std::int64_t>(calls);
+}
+
+void LuaFunctionStatsSnapshot::merge(const LuaFunctionStatsSnapshot& other)
+{
+    if(other.calls == 0)
+        return;
+    min = calls == 0 ? other.min : std::min(min, other.min);
+    max = std::max(max, other.max);
+    calls += other.calls;
+    errors += other.errors;
+    total += other.total;
+    latency.merge(other.latency);
+}
+
+LuaFunctionStats::LuaFunctionStats(std::string_view name, LuaFunctionKind kind, const std::atomic<bool>& enabled)
+: mName(name), mKind(kind), mEnabled(&enabled)
+{}
+
+LuaFunctionStats::~LuaFunctionStats()
+{
+    delete[] mBuckets.load(std::memory_order_relaxed);
+}
+
+void LuaFunctionStats::record(std::chrono::nanoseconds latency, bool failed) noexcept
+{
+    auto nanoseconds = static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0));
+    std::atomic<std::uint64_t>* buckets = mBuckets.load(std::memory_order_relaxed);
+    if(buckets == nullptr)
+    {
+        // runs inside lua frames, so a failed allocation leaves the call out of the histogram instead of throwing;
+        // published with release, so a snapshot never reads the counters before they are initialized
+        buckets = new (std::nothrow) std::atomic<std::uint64_t>[LuaLatencyHistogram::bucketCount]();
+        mBuckets.store(buckets, std::memory_order_release);
+    }
+
+    if(buckets != nullptr)
+        addRelaxed(buckets[LuaLatencyHistogram::bucketOf(nanoseconds)], 1);
+    addRelaxed(mTotal, nanoseconds);
+    if(nanoseconds < mMin.load(std::memory_order_relaxed))
+        mMin.store(nanoseconds, std::memory_order_relaxed);
+    if(nanoseconds > mMax.load(std::memory_order_relaxed))
+        mMax.store(nanoseconds, std::memory_order_relaxed);
+    if(failed)
+        addRelaxed(mErrors, 1);
+    addRelaxed(mCalls, 1);
+}
+
+void LuaFunctionStats::reset()
+{
+    mCalls.store(0, std::memory_order_relaxed);
+    mErrors.store(0, std::memory_order_relaxed);
+    mTotal.store(0, std::memory_order_relaxed);
+    mMin.store(UINT64_MAX, std::memory_order_relaxed);
+    mMax.store(0, std::memory_order_relaxed);
+    if(std::atomic<std::uint64_t>* buckets = mBuckets.load(std::memory_order_relaxed))
+    {
+        for(std::size_t i = 0; i < LuaLatencyHistogram::bucketCount; i++)
+            buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+LuaFunctionStatsSnapshot LuaFunctionStats::snapshot() const
+{
+    LuaFunctionStatsSnapshot snapshot;
+    snapshot.name = mName;
+    snapshot.kind = mKind;
+    // the counters are read one by one while the state may record, so they can be off by the running call
+    snapshot.calls = mCalls.load(std::memory_order_relaxed);
+    snapshot.errors = mErrors.load(std::memory_order_relaxed);
+    snapshot.total = std::chrono::nanoseconds(static_cast<std::int64_t>(mTotal.load(std::memory_order_relaxed)));
+    std::uint64_t min = mMin.load(std::memory_order_relaxed);
+    snapshot.min = std::chrono::nanoseconds(min == UINT64_MAX ? 0 : static_cast<std::int64_t>(min));
+    snapshot.max = std::chrono::nanoseconds(static_cast<std::int64_t>(mMax.load(std::memory_order_relaxed)));
+    if(const std::atomic<std::uint64_t>* buckets = mBuckets.load(std::memory_order_acquire))
+    {
+        for(std::size_t i = 0; i < LuaLatencyHistogram::bucketCount; i++)
+            snapshot.latency.add(i, buckets[i].load(std::memory_order_relaxed));
+    }
+    return snapshot;
+}
+
+const std::string& LuaFunctionStats::getName() const
+{
+    return mName;
+}
+
+LuaFunctionKind LuaFunctionStats::getKind() const
+{
+    return mKind;
+}
+
+LuaFunctionStats* LuaCallStats::add(std::string_view name, LuaFunctionKind kind)
+{
+    std::lock_guard lock(mMutex);
+    // closures of an unregistered function may still be reachable and record into its entry, so entries are never removed
+    for(auto& function : mFunctions)
+    {
+        if(function.getKind() == kind && function.getName() == name)
+            return &function;
+    }
+    return &mFunctions.emplace_back(name, kind, mEnabled);
+}
+
+void LuaCallStats::setEnabled(bool enabled)
+{
+    mEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool LuaCallStats::isEnabled() const
+{
+    return mEnabled.load(std::memory_order_relaxed);
+}
+
+void LuaCallStats::reset()
+{
+    std::lock_guard lock(mMutex);
+    for(auto& function : mFunctions)
+        function.reset();
+}
+
+std::vector<LuaFunctionStatsSnapshot> LuaCallStats::snapshot() const
+{
+    std::lock_guard lock(mMutex);
+    std::vector<LuaFunctionStatsSnapshot> snapshots;
+    snapshots.reserve(mFunctions.size());
+    for(const auto& function : mFunctions)
+        snapshots.push_back(function.snapshot());
+    return snapshots;
+}
+
+std::optional<LuaFunctionStatsSnapshot> LuaCallStats::snapshot(std::string_view name) const
+{
+    std::lock_guard lock(mMutex);
+    for(const auto& function : mFunctions)
+    {
+        if(function.getName() == name)
+            return function.snapshot();
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,254 @@
+#ifndef LUA_CALL_STATS_H
+#define LUA_CALL_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @enum LuaFunctionKind
+ * @brief Where a function with call statistics is implemented.
+ */
+enum class LuaFunctionKind
+{
+    SCRIPT, /**< Lua function defined by the script and called from C++. */
+    NATIVE /**< C++ function registered with regFunc and called from Lua. */
+};
+
+/**
+ * @class LuaLatencyHistogram
+ * @brief Log-linear latency histogram in the style of HdrHistogram.
+ *
+ * Every power of two range of nanoseconds is split into 2^subBucketBits equal buckets, so a recorded
+ * latency is reported with a relative error below 2^-subBucketBits (about 3%) from one nanosecond up to
+ * 2^maxBits nanoseconds (about 18 minutes); longer latencies land in the last bucket.
+ */
+class LuaLatencyHistogram
+{
+public:
+    static constexpr int subBucketBits = 5; /**< Buckets per power of two are 2^subBucketBits. */
+    static constexpr int maxBits = 40; /**< Latencies up to 2^maxBits nanoseconds are resolved. */
+    static constexpr std::size_t subBuckets = std::size_t{1} << subBucketBits;
+    static constexpr std::size_t bucketCount = (maxBits - subBucketBits + 1) * subBuckets;
+
+private:
+    std::vector<std::uint64_t> mBuckets = {}; /**< Calls per bucket, empty until the first record. */
+    std::uint64_t mCount = 0; /**< Calls of all buckets. */
+
+public:
+    /**
+     * @brief Gets the bucket of a latency.
+     * @param nanoseconds Latency in nanoseconds.
+     * @return Index below bucketCount.
+     */
+    static std::size_t bucketOf(std::uint64_t nanoseconds);
+
+    /**
+     * @brief Gets the smallest latency of a bucket in nanoseconds.
+     */
+    static std::uint64_t bucketLow(std::size_t bucket);
+
+    /**
+     * @brief Gets the largest latency of a bucket in nanoseconds.
+     */
+    static std::uint64_t bucketHigh(std::size_t bucket);
+
+    /**
+     * @brief Adds calls to a bucket.
+     * @param bucket Bucket of the latency, see bucketOf.
+     * @param count Calls to add.
+     */
+    void add(std::size_t bucket, std::uint64_t count);
+
+    /**
+     * @brief Records calls with the same latency.
+     * @param latency Latency of the calls.
+     * @param count Calls to record.
+     */
+    void record(std::chrono::nanoseconds latency, std::uint64_t count = 1);
+
+    /**
+     * @brief Adds all calls of another histogram, e.g. of the same function in another state.
+     */
+    void merge(const LuaLatencyHistogram& other);
+
+    /**
+     * @brief Gets the latency at or below which the given share of the calls completed.
+     * @param percentile Share in percent, e.g. 99.9.
+     * @return The largest latency of the bucket that holds the percentile, zero without calls.
+     */
+    std::chrono::nanoseconds percentile(double percentile) const;
+
+    std::uint64_t getCount() const;
+
+    /**
+     * @brief Gets the calls per bucket.
+     * @return bucketCount entries or an empty vector if nothing was recorded.
+     */
+    const std::vector<std::uint64_t>& getBuckets() const;
+};
+
+/**
+ * @struct LuaFunctionStatsSnapshot
+ * @brief Call statistics of one function at the time of LuaCallStats::snapshot.
+ */
+struct LuaFunctionStatsSnapshot
+{
+    std::string name = ""; /**< Registered name of the function. */
+    LuaFunctionKind kind = LuaFunctionKind::SCRIPT; /**< Where the function is implemented. */
+    std::uint64_t calls = 0; /**< Completed calls, failed ones included. */
+    std::uint64_t errors = 0; /**< Calls that raised an error. */
+    std::chrono::nanoseconds total = {}; /**< Summed latency of all calls. */
+    std::chrono::nanoseconds min = {}; /**< Shortest call, zero without calls. */
+    std::chrono::nanoseconds max = {}; /**< Longest call. */
+    LuaLatencyHistogram latency = {}; /**< Latency distribution of all calls. */
+
+    /**
+     * @brief Gets the mean latency.
+     * @return Zero without calls.
+     */
+    std::chrono::nanoseconds mean() const;
+
+    /**
+     * @brief Adds the statistics of another snapshot, e.g. of the same function in another state.
+     */
+    void merge(const LuaFunctionStatsSnapshot& other);
+};
+
+/**
+ * @class LuaFunctionStats
+ * @brief Live call statistics of one registered function.
+ *
+ * Only the thread running the state records, so every counter is updated with a relaxed load and store
+ * instead of a read-modify-write; any thread may read them while they change. The histogram is allocated
+ * on the first recorded call.
+ */
+class LuaFunctionStats
+{
+private:
+    std::string mName = ""; /**< Registered name of the function. */
+    LuaFunctionKind mKind = LuaFunctionKind::SCRIPT; /**< Where the function is implemented. */
+    const std::atomic<bool>* mEnabled = nullptr; /**< Enabled flag of the owning LuaCallStats. */
+    std::atomic<std::uint64_t> mCalls = 0; /**< Completed calls. */
+    std::atomic<std::uint64_t> mErrors = 0; /**< Failed calls. */
+    std::atomic<std::uint64_t> mTotal = 0; /**< Summed latency in nanoseconds. */
+    std::atomic<std::uint64_t> mMin = UINT64_MAX; /**< Shortest call in nanoseconds. */
+    std::atomic<std::uint64_t> mMax = 0; /**< Longest call in nanoseconds. */
+    std::atomic<std::atomic<std::uint64_t>*> mBuckets = nullptr; /**< LuaLatencyHistogram::bucketCount counters, nullptr before the first call. */
+
+public:
+    /**
+     * @brief Constructor.
+     * @param name Registered name of the function.
+     * @param kind Where the function is implemented.
+     * @param enabled Enabled flag of the owning LuaCallStats.
+     */
+    LuaFunctionStats(std::string_view name, LuaFunctionKind kind, const std::atomic<bool>& enabled);
+    ~LuaFunctionStats();
+
+    LuaFunctionStats(const LuaFunctionStats&) = delete;
+    LuaFunctionStats& operator=(const LuaFunctionStats&) = delete;
+
+    /**
+     * @brief Checks if calls are recorded. Checked before the call is timed.
+     */
+    bool isEnabled() const
+    {
+        return mEnabled->load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Records a completed call. Must only be called by the thread running the state.
+     * @param start Time the call started.
+     * @param failed Set if the call raised an error.
+     */
+    void record(std::chrono::steady_clock::time_point start, bool failed) noexcept
+    {
+        record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start), failed);
+    }
+
+    /**
+     * @brief Records a completed call. Must only be called by the thread running the state.
+     * Never throws, it is called inside lua frames. The call is left out of the histogram if its buckets can not
+     * be allocated.
+     * @param latency Duration of the call.
+     * @param failed Set if the call raised an error.
+     */
+    void record(std::chrono::nanoseconds latency, bool failed) noexcept;
+
+    /**
+     * @brief Discards all recorded calls. Must only be called while the state is idle.
+     */
+    void reset();
+
+    /**
+     * @brief Copies the statistics. Callable from any thread.
+     */
+    LuaFunctionStatsSnapshot snapshot() const;
+
+    const std::string& getName() const;
+    LuaFunctionKind getKind() const;
+};
+
+/**
+ * @class LuaCallStats
+ * @brief Call statistics of all functions registered in a state, keyed by their name.
+ *
+ * Recording is off until setEnabled(true); disabled, a call costs a relaxed load of the flag. snapshot
+ * may be called from any thread while the state is running, the mutex only guards adding functions.
+ */
+class LuaCallStats
+{
+private:
+    std::deque<LuaFunctionStats> mFunctions = {}; /**< Statistics in registration order, addresses are stable. */
+    mutable std::mutex mMutex = {}; /**< Guards mFunctions against snapshots while a function is added. */
+    std::atomic<bool> mEnabled = false; /**< Set while calls are recorded. */
+
+public:
+    LuaCallStats() = default;
+    LuaCallStats(const LuaCallStats&) = delete;
+    LuaCallStats& operator=(const LuaCallStats&) = delete;
+
+    /**
+     * @brief Adds the statistics of a newly registered function. A function registered again under the same
+     * name and kind, e.g. after LuaScript::resetToSnapshot, gets its earlier statistics back.
+     * @param name Registered name of the function.
+     * @param kind Where the function is implemented.
+     * @return The statistics, valid as long as this object.
+     */
+    LuaFunctionStats* add(std::string_view name, LuaFunctionKind kind);
+
+    /**
+     * @brief Starts or stops recording. Callable from any thread, calls that are running keep their decision.
+     */
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const;
+
+    /**
+     * @brief Discards all recorded calls. Must only be called while the state is idle.
+     */
+    void reset();
+
+    /**
+     * @brief Copies the statistics of every registered function. Callable from any thread.
+     * @return One snapshot per function in registration order.
+     */
+    std::vector<LuaFunctionStatsSnapshot> snapshot() const;
+
+    /**
+     * @brief Copies the statistics of one function. Callable from any thread.
+     * @param name Registered name of the function.
+     * @return The snapshot or std::nullopt if no function with this name is registered.
+     */
+    std::optional<LuaFunctionStatsSnapshot> snapshot(std::string_view name) const;
+};
+
+#endif // LUA_CALL_STATS_H
@@ -0,0 +1,32 @@
+#ifndef LUA_EXECUTION_LIMIT_H
+#define LUA_EXECUTION_LIMIT_H
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @struct LuaExecutionLimit
+ * @brief Budget of a single call into a Lua state.
+ *
+ * The budget is checked by a count hook every `checkInterval` VM instructions, so an unlimited
+ * budget costs nothing and a limited one costs a hook call per interval. Calls that exceed the
+ * budget fail with FuncInfoType::TIMEOUT. Coroutines resumed during the call share its budget,
+ * the hook is passed on by lua_resume, so also coroutines created before the call are checked.
+ */
+struct LuaExecutionLimit
+{
+    std::uint64_t instructions = 0; /**< VM instructions per call, zero for no limit. */
+    std::chrono::nanoseconds timeout = std::chrono::nanoseconds::zero(); /**< Wall clock time per call, zero for no limit. */
+    int checkInterval = 1000; /**< VM instructions between two budget checks. */
+
+    /**
+     * @brief Checks if any budget is set.
+     * @return True if the instructions or the time are limited.
+     */
+    bool isLimited() const
+    {
+        return instructions != 0 || timeout != std::chrono::nanoseconds::zero();
+    }
+};
+
+#endif // LUA_EXECUTION_LIMIT_H
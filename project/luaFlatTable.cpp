@@ -0,0 +1,220 @@
+#include "luaFlatTable.h"
+
+#include <algorithm>
+#include <limits>
+
+void LuaFlatTable::clear()
+{
+    mTables.clear();
+    mArray.clear();
+    mHash.clear();
+    mStringData.clear();
+    mStrings.clear();
+    std::fill(mStringSlots.begin(), mStringSlots.end(), 0);
+}
+
+void LuaFlatTable::reserve(std::size_t tables, std::size_t arrayValues, std::size_t hashEntries, std::size_t stringBytes)
+{
+    mTables.reserve(tables);
+    mArray.reserve(arrayValues);
+    mHash.reserve(hashEntries);
+    mStringData.reserve(stringBytes);
+}
+
+bool LuaFlatTable::empty() const
+{
+    return mTables.empty();
+}
+
+std::size_t LuaFlatTable::tableCount() const
+{
+    return mTables.size();
+}
+
+std::size_t LuaFlatTable::stringCount() const
+{
+    return mStrings.size();
+}
+
+std::span<const LuaFlatValue> LuaFlatTable::array(std::uint32_t table) const
+{
+    if(table >= mTables.size())
+        return {};
+    auto const& node = mTables[table];
+    return std::span<const LuaFlatValue>(mArray.data() + node.arrayBegin, node.arraySize);
+}
+
+std::span<const LuaFlatEntry> LuaFlatTable::hash(std::uint32_t table) const
+{
+    if(table >= mTables.size())
+        return {};
+    auto const& node = mTables[table];
+    return std::span<const LuaFlatEntry>(mHash.data() + node.hashBegin, node.hashSize);
+}
+
+std::string_view LuaFlatTable::string(std::uint32_t id) const
+{
+    if(id >= mStrings.size())
+        return {};
+    auto offset = static_cast<std::size_t>(mStrings[id] >> 32);
+    auto len = static_cast<std::size_t>(mStrings[id] & 0xFFFFFFFFu);
+    return std::string_view(mStringData.data() + offset, len);
+}
+
+const LuaFlatValue* LuaFlatTable::find(std::string_view key, std::uint32_t table) const
+{
+    auto id = findString(key);
+    if(id == std::numeric_limits<std::uint32_t>::max())
+        return nullptr;
+
+    LuaFlatValue flatKey;
+    flatKey.type = LuaFlatType::STRING;
+    flatKey.index = id;
+
+    auto entries = hash(table);
+    auto iter = std::lower_bound(entries.begin(), entries.end(), flatKey,
+                                 [](const LuaFlatEntry& entry, const LuaFlatValue& k) { return keyLess(entry.key, k); });
+    if(iter == entries.end() || keyLess(flatKey, iter->key))
+        return nullptr;
+    return &iter->value;
+}
+
+const LuaFlatValue* LuaFlatTable::find(long long key, std::uint32_t table) const
+{
+    auto values = array(table);
+    if(key >= 1 && static_cast<unsigned long long>(key) <= values.size())
+        return &values[static_cast<std::size_t>(key - 1)];
+
+    LuaFlatValue flatKey;
+    flatKey.type = LuaFlatType::INTEGER;
+    flatKey.integer = key;
+
+    auto entries = hash(table);
+    auto iter = std::lower_bound(entries.begin(), entries.end(), flatKey,
+                                 [](const LuaFlatEntry& entry, const LuaFlatValue& k) { return keyLess(entry.key, k); });
+    if(iter == entries.end() || keyLess(flatKey, iter->key))
+        return nullptr;
+    return &iter->value;
+}
+
+std::uint32_t LuaFlatTable::findString(std::string_view str) const
+{
+    if(mStringSlots.empty())
+        return std::numeric_limits<std::uint32_t>::max();
+
+    auto mask = mStringSlots.size() - 1;
+    for(auto slot = static_cast<std::size_t>(hashString(str)) & mask; mStringSlots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        auto id = mStringSlots[slot] - 1;
+        if(string(id) == str)
+            return id;
+    }
+    return std::numeric_limits<std::uint32_t>::max();
+}
+
+std::uint32_t LuaFlatTable::addTable(std::uint32_t arraySize, std::uint32_t hashSize)
+{
+    LuaFlatNode node;
+    node.arrayBegin = static_cast<std::uint32_t>(mArray.size());
+    node.arraySize = arraySize;
+    node.hashBegin = static_cast<std::uint32_t>(mHash.size());
+    node.hashSize = hashSize;
+    mArray.resize(mArray.size() + arraySize);
+    mHash.resize(mHash.size() + hashSize);
+    mTables.push_back(node);
+    return static_cast<std::uint32_t>(mTables.size() - 1);
+}
+
+std::uint32_t LuaFlatTable::intern(std::string_view str)
+{
+    if((mStrings.size() + 1) * 2 > mStringSlots.size())
+        growStringSlots();
+
+    auto mask = mStringSlots.size() - 1;
+    auto slot = static_cast<std::size_t>(hashString(str)) & mask;
+    for(; mStringSlots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        auto id = mStringSlots[slot] - 1;
+        if(string(id) == str)
+            return id;
+    }
+
+    auto id = static_cast<std::uint32_t>(mStrings.size());
+    mStrings.push_back((static_cast<std::uint64_t>(mStringData.size()) << 32) | static_cast<std::uint32_t>(str.size()));
+    mStringData.append(str);
+    mStringSlots[slot] = id + 1;
+    return id;
+}
+
+void LuaFlatTable::setArrayValue(std::uint32_t table, std::uint32_t i, const LuaFlatValue& value)
+{
+    mArray[mTables[table].arrayBegin + i] = value;
+}
+
+void LuaFlatTable::setHashEntry(std::uint32_t table, std::uint32_t i, const LuaFlatEntry& entry)
+{
+    mHash[mTables[table].hashBegin + i] = entry;
+}
+
+void LuaFlatTable::sortHash(std::uint32_t table)
+{
+    auto const& node = mTables[table];
+    auto begin = mHash.begin() + node.hashBegin;
+    std::sort(begin, begin + node.hashSize, [](const LuaFlatEntry& lhs, const LuaFlatEntry& rhs) { return keyLess(lhs.key, rhs.key); });
+}
+
+void LuaFlatTable::shrinkHash(std::uint32_t table, std::uint32_t hashSize)
+{
+    auto& node = mTables[table];
+    if(hashSize < node.hashSize)
+    {
+        // the unused entries stay in the arena, only the range of the table shrinks
+        node.hashSize = hashSize;
+    }
+}
+
+bool LuaFlatTable::keyLess(const LuaFlatValue& lhs, const LuaFlatValue& rhs)
+{
+    if(lhs.type != rhs.type)
+        return lhs.type < rhs.type;
+
+    switch(lhs.type)
+    {
+    case LuaFlatType::INTEGER:
+        return lhs.integer < rhs.integer;
+    case LuaFlatType::NUMBER:
+        return lhs.number < rhs.number;
+    case LuaFlatType::BOOLEAN:
+        return lhs.boolean < rhs.boolean;
+    case LuaFlatType::STRING:
+    case LuaFlatType::TABLE:
+        return lhs.index < rhs.index;
+    default:
+        return false;
+    }
+}
+
+std::uint64_t LuaFlatTable::hashString(std::string_view str)
+{
+    std::uint64_t h = 14695981039346656037ull;
+    for(unsigned char c : str)
+    {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h ^ (h >> 32);
+}
+
+void LuaFlatTable::growStringSlots()
+{
+    auto size = std::max<std::size_t>(64, mStringSlots.size() * 2);
+    mStringSlots.assign(size, 0);
+    auto mask = size - 1;
+    for(std::uint32_t id = 0; id < mStrings.size(); id++)
+    {
+        auto slot = static_cast<std::size_t>(hashString(string(id))) & mask;
+        while(mStringSlots[slot] != 0)
+            slot = (slot + 1) & mask;
+        mStringSlots[slot] = id + 1;
+    }
+}
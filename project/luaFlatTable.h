@@ -0,0 +1,179 @@
+#ifndef LUA_FLAT_TABLE_H
+#define LUA_FLAT_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Type tag of a LuaFlatValue.
+ */
+enum class LuaFlatType : std::uint8_t
+{
+    NIL = 0,
+    INTEGER,
+    NUMBER,
+    BOOLEAN,
+    STRING,
+    TABLE,
+};
+
+/**
+ * @brief A tagged scalar of a LuaFlatTable. Strings and nested tables are stored as indices.
+ */
+struct LuaFlatValue
+{
+    LuaFlatType type = LuaFlatType::NIL; /**< Type of the value. */
+    union
+    {
+        long long integer; /**< Value of INTEGER. */
+        double number; /**< Value of NUMBER. */
+        bool boolean; /**< Value of BOOLEAN. */
+        std::uint32_t index = 0; /**< Interned string id of STRING or table id of TABLE. */
+    };
+};
+
+/**
+ * @brief A key value pair of the hash part of a LuaFlatTable.
+ */
+struct LuaFlatEntry
+{
+    LuaFlatValue key; /**< Key of the entry. Either a STRING, INTEGER, NUMBER or BOOLEAN. */
+    LuaFlatValue value; /**< Value of the entry. */
+};
+
+/**
+ * @brief Location of one table inside the arena of a LuaFlatTable.
+ */
+struct LuaFlatNode
+{
+    std::uint32_t arrayBegin = 0; /**< First element of the array part. */
+    std::uint32_t arraySize = 0; /**< Number of elements of the array part. */
+    std::uint32_t hashBegin = 0; /**< First entry of the hash part. */
+    std::uint32_t hashSize = 0; /**< Number of entries of the hash part. */
+};
+
+/**
+ * @class LuaFlatTable
+ * @brief A compact, cache friendly copy of a Lua table and all its nested tables.
+ *
+ * All tables live in one arena. Every table owns a contiguous range of array values (keys 1..n) and a
+ * contiguous range of hash entries sorted by key. Strings are interned once into a single buffer, so keys
+ * compare by id. Table 0 is the root table. Clearing keeps the capacity, so a reused LuaFlatTable converts
+ * further tables without allocating.
+ */
+class LuaFlatTable
+{
+private:
+    std::vector<LuaFlatNode> mTables = {}; /**< Arena of all tables. */
+    std::vector<LuaFlatValue> mArray = {}; /**< Array parts of all tables. */
+    std::vector<LuaFlatEntry> mHash = {}; /**< Hash parts of all tables. */
+    std::string mStringData = ""; /**< Characters of all interned strings. */
+    std::vector<std::uint64_t> mStrings = {}; /**< Offset (high 32 bit) and length (low 32 bit) of every interned string. */
+    std::vector<std::uint32_t> mStringSlots = {}; /**< Open addressing index of the interned strings, string id + 1 or 0. */
+
+public:
+    LuaFlatTable() = default;
+
+    /**
+     * @brief Removes all tables and strings but keeps the allocated capacity.
+     */
+    void clear();
+
+    /**
+     * @brief Reserves capacity for the given amount of data.
+     */
+    void reserve(std::size_t tables, std::size_t arrayValues, std::size_t hashEntries, std::size_t stringBytes);
+
+    bool empty() const;
+    std::size_t tableCount() const;
+    std::size_t stringCount() const;
+
+    /**
+     * @brief Retrieves the array part (keys 1..n) of a table.
+     * @param table Table id. 0 is the root table.
+     */
+    std::span<const LuaFlatValue> array(std::uint32_t table = 0) const;
+
+    /**
+     * @brief Retrieves the hash part of a table, sorted by key.
+     * @param table Table id. 0 is the root table.
+     */
+    std::span<const LuaFlatEntry> hash(std::uint32_t table = 0) const;
+
+    /**
+     * @brief Retrieves an interned string.
+     * @param id String id of a STRING value.
+     */
+    std::string_view string(std::uint32_t id) const;
+
+    /**
+     * @brief Looks up a string key in the hash part of a table.
+     * @param key Key to look up.
+     * @param table Table id. 0 is the root table.
+     * @return Pointer to the value or nullptr if the key does not exist.
+     */
+    const LuaFlatValue* find(std::string_view key, std::uint32_t table = 0) const;
+
+    /**
+     * @brief Looks up an integer key in the array or hash part of a table.
+     * @param key Key to look up.
+     * @param table Table id. 0 is the root table.
+     * @return Pointer to the value or nullptr if the key does not exist.
+     */
+    const LuaFlatValue* find(long long key, std::uint32_t table = 0) const;
+
+    /**
+     * @brief Looks up the id of an interned string.
+     * @param str String to look up.
+     * @return String id or UINT32_MAX if the string is not interned.
+     */
+    std::uint32_t findString(std::string_view str) const;
+
+    /**
+     * @brief Adds a table with uninitialized array and hash ranges of the given sizes.
+     * @return Id of the new table.
+     */
+    std::uint32_t addTable(std::uint32_t arraySize, std::uint32_t hashSize);
+
+    /**
+     * @brief Interns a string.
+     * @return Id of the string.
+     */
+    std::uint32_t intern(std::string_view str);
+
+    /**
+     * @brief Sets the value of the array part of a table.
+     * @param table Table id.
+     * @param i Zero based position in the array part.
+     */
+    void setArrayValue(std::uint32_t table, std::uint32_t i, const LuaFlatValue& value);
+
+    /**
+     * @brief Sets an entry of the hash part of a table.
+     * @param table Table id.
+     * @param i Zero based position in the hash part.
+     */
+    void setHashEntry(std::uint32_t table, std::uint32_t i, const LuaFlatEntry& entry);
+
+    /**
+     * @brief Sorts the hash part of a table by key. Needed once the hash part is filled.
+     * @param table Table id.
+     */
+    void sortHash(std::uint32_t table);
+
+    /**
+     * @brief Shrinks the hash part of a table, e.g. when fewer entries were converted than counted.
+     */
+    void shrinkHash(std::uint32_t table, std::uint32_t hashSize);
+
+private:
+    static bool keyLess(const LuaFlatValue& lhs, const LuaFlatValue& rhs);
+    static std::uint64_t hashString(std::string_view str);
+    void growStringSlots();
+};
+
+#endif // LUA_FLAT_TABLE_H
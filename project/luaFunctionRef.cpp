@@ -0,0 +1,77 @@
+#include "luaFunctionRef.h"
+
+#include <utility>
+
+LuaFunctionRef::LuaFunctionRef(lua_State* state, int ref, FuncDescription* funcDesc, std::string_view name, LuaFunctionStats* stats)
+: L(state), mRef(ref), mFuncDesc(funcDesc), mName(name), mStats(stats)
+{}
+
+LuaFunctionRef::LuaFunctionRef(LuaFunctionRef&& other) noexcept
+: L(std::exchange(other.L, nullptr)), mRef(std::exchange(other.mRef, LUA_NOREF)),
+  mFuncDesc(std::exchange(other.mFuncDesc, nullptr)), mName(std::move(other.mName)),
+  mStats(std::exchange(other.mStats, nullptr))
+{}
+
+LuaFunctionRef& LuaFunctionRef::operator=(LuaFunctionRef&& other) noexcept
+{
+    if(this != &other)
+    {
+        release();
+        L = std::exchange(other.L, nullptr);
+        mRef = std::exchange(other.mRef, LUA_NOREF);
+        mFuncDesc = std::exchange(other.mFuncDesc, nullptr);
+        mName = std::move(other.mName);
+        mStats = std::exchange(other.mStats, nullptr);
+    }
+    return *this;
+}
+
+LuaFunctionRef::~LuaFunctionRef()
+{
+    release();
+}
+
+void LuaFunctionRef::push(lua_State* state) const
+{
+    ::lua_rawgeti(state, LUA_REGISTRYINDEX, mRef);
+}
+
+bool LuaFunctionRef::isValid() const
+{
+    return L && mRef != LUA_NOREF && mRef != LUA_REFNIL && mFuncDesc;
+}
+
+int LuaFunctionRef::getRef() const
+{
+    return mRef;
+}
+
+FuncDescription* LuaFunctionRef::getFuncDesc() const
+{
+    return mFuncDesc;
+}
+
+std::string_view LuaFunctionRef::getName() const
+{
+    return mName;
+}
+
+LuaFunctionStats* LuaFunctionRef::getStats() const
+{
+    return mStats;
+}
+
+LuaFunctionRef::operator bool() const
+{
+    return isValid();
+}
+
+void LuaFunctionRef::release()
+{
+    if(L && mRef != LUA_NOREF)
+        ::luaL_unref(L, LUA_REGISTRYINDEX, mRef);
+    L = nullptr;
+    mRef = LUA_NOREF;
+    mFuncDesc = nullptr;
+    mStats = nullptr;
+}
@@ -0,0 +1,73 @@
+#ifndef LUA_FUNCTION_REF_H
+#define LUA_FUNCTION_REF_H
+
+#include <lua.hpp>
+#include <string>
+#include <string_view>
+
+#include "funcDesc.h"
+
+class LuaFunctionStats;
+
+/**
+ * @class LuaFunctionRef
+ * @brief A prepared handle to a registered Lua function.
+ *
+ * Holds a registry reference to the Lua function and the bound function description, so calls
+ * through the handle skip the global lookup and the description search. The handle must not
+ * outlive the LuaScript it was prepared from.
+ */
+class LuaFunctionRef
+{
+private:
+    lua_State* L = nullptr; /**< Lua state the reference belongs to. */
+    int mRef = LUA_NOREF; /**< Registry reference of the Lua function. */
+    FuncDescription* mFuncDesc = nullptr; /**< Bound function description. */
+    std::string mName = ""; /**< Name of the Lua function. */
+    LuaFunctionStats* mStats = nullptr; /**< Call statistics of the Lua function, nullptr if calls are not recorded. */
+
+public:
+    /**
+     * @brief Default constructor. Creates an invalid reference.
+     */
+    LuaFunctionRef() = default;
+
+    /**
+     * @brief Constructor with an existing registry reference.
+     * @param state Lua state the reference belongs to.
+     * @param ref Registry reference of the Lua function.
+     * @param funcDesc Bound function description.
+     * @param name Name of the Lua function.
+     * @param stats Call statistics of the Lua function (optional).
+     */
+    LuaFunctionRef(lua_State* state, int ref, FuncDescription* funcDesc, std::string_view name, LuaFunctionStats* stats = nullptr);
+
+    LuaFunctionRef(const LuaFunctionRef&) = delete;
+    LuaFunctionRef& operator=(const LuaFunctionRef&) = delete;
+    LuaFunctionRef(LuaFunctionRef&& other) noexcept;
+    LuaFunctionRef& operator=(LuaFunctionRef&& other) noexcept;
+
+    /**
+     * @brief Destructor. Releases the registry reference.
+     */
+    ~LuaFunctionRef();
+
+    /**
+     * @brief Pushes the referenced Lua function onto the stack of the given state.
+     * @param state Lua state to push the function onto.
+     */
+    void push(lua_State* state) const;
+
+    bool isValid() const;
+    int getRef() const;
+    FuncDescription* getFuncDesc() const;
+    std::string_view getName() const;
+    LuaFunctionStats* getStats() const;
+
+    explicit operator bool() const;
+
+private:
+    void release();
+};
+
+#endif // LUA_FUNCTION_REF_H
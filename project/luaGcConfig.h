@@ -0,0 +1,50 @@
+#ifndef LUA_GC_CONFIG_H
+#define LUA_GC_CONFIG_H
+
+#include <chrono>
+#include <cstddef>
+
+/**
+ * @enum LuaGcMode
+ * @brief Operating mode of the Lua garbage collector.
+ */
+enum class LuaGcMode : int
+{
+    INCREMENTAL = 0, /**< Interleaves mark and sweep phases with the program. */
+    GENERATIONAL = 1, /**< Collects young objects often and the whole heap rarely. */
+};
+
+/**
+ * @struct LuaGcConfig
+ * @brief Garbage collector settings of a Lua state.
+ *
+ * The defaults match the defaults of Lua 5.4. Only the parameters of the selected mode are applied.
+ */
+struct LuaGcConfig
+{
+    LuaGcMode mode = LuaGcMode::INCREMENTAL; /**< Collector mode. */
+    int pause = 200; /**< Incremental: percentage the heap grows before a new cycle starts. */
+    int stepMul = 100; /**< Incremental: work done per step relative to allocation. */
+    int stepSize = 13; /**< Incremental: log2 of the bytes allocated between steps. */
+    int minorMul = 20; /**< Generational: percentage the heap grows before a minor collection. */
+    int majorMul = 100; /**< Generational: percentage the heap grows before a major collection. */
+    bool automatic = true; /**< False stops the collector, memory is then only reclaimed by explicit steps. */
+    int stepBudget = 0; /**< Kilobytes of collector work done after every doFunc, zero to disable. */
+};
+
+/**
+ * @struct LuaGcStats
+ * @brief Time spent in the garbage collector of a Lua state.
+ *
+ * Covers steps triggered by allocations, explicit steps and full collections, including emergency
+ * collections on memory pressure.
+ */
+struct LuaGcStats
+{
+    std::size_t steps = 0; /**< Number of collector steps. */
+    std::size_t fullCollections = 0; /**< Number of full collections. */
+    std::chrono::nanoseconds time = std::chrono::nanoseconds::zero(); /**< Total time spent collecting. */
+    std::chrono::nanoseconds maxPause = std::chrono::nanoseconds::zero(); /**< Longest single step or collection. */
+};
+
+#endif // LUA_GC_CONFIG_H
@@ -0,0 +1,67 @@
+#include "luaPinnedString.h"
+
+#include <utility>
+
+LuaPinnedString::LuaPinnedString(lua_State* state, int ref, std::string_view view)
+: L(state), mRef(ref), mView(view)
+{}
+
+LuaPinnedString::LuaPinnedString(LuaPinnedString&& other) noexcept
+: L(std::exchange(other.L, nullptr)), mRef(std::exchange(other.mRef, LUA_NOREF)), mView(std::exchange(other.mView, ""))
+{}
+
+LuaPinnedString& LuaPinnedString::operator=(LuaPinnedString&& other) noexcept
+{
+    if(this != &other)
+    {
+        release();
+        L = std::exchange(other.L, nullptr);
+        mRef = std::exchange(other.mRef, LUA_NOREF);
+        mView = std::exchange(other.mView, "");
+    }
+    return *this;
+}
+
+LuaPinnedString::~LuaPinnedString()
+{
+    release();
+}
+
+std::string_view LuaPinnedString::view() const
+{
+    return mView;
+}
+
+const char* LuaPinnedString::data() const
+{
+    return mView.data();
+}
+
+std::size_t LuaPinnedString::size() const
+{
+    return mView.size();
+}
+
+bool LuaPinnedString::isValid() const
+{
+    return L && mRef != LUA_NOREF;
+}
+
+LuaPinnedString::operator std::string_view() const
+{
+    return mView;
+}
+
+LuaPinnedString::operator bool() const
+{
+    return isValid();
+}
+
+void LuaPinnedString::release()
+{
+    if(L && mRef != LUA_NOREF)
+        ::luaL_unref(L, LUA_REGISTRYINDEX, mRef);
+    L = nullptr;
+    mRef = LUA_NOREF;
+    mView = "";
+}
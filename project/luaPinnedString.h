@@ -0,0 +1,57 @@
+#ifndef LUA_PINNED_STRING_H
+#define LUA_PINNED_STRING_H
+
+#include <lua.hpp>
+#include <string_view>
+
+/**
+ * @class LuaPinnedString
+ * @brief A view of a Lua string that keeps the string alive.
+ *
+ * Lua strings never move in memory, so holding a registry reference to the string is enough to keep
+ * the view valid without copying the characters. The guard must not outlive the Lua state.
+ */
+class LuaPinnedString
+{
+private:
+    lua_State* L = nullptr; /**< Lua state the string belongs to. */
+    int mRef = LUA_NOREF; /**< Registry reference that pins the string. */
+    std::string_view mView = ""; /**< View of the pinned string. */
+
+public:
+    /**
+     * @brief Default constructor. Creates an empty guard.
+     */
+    LuaPinnedString() = default;
+
+    /**
+     * @brief Constructor with an existing registry reference to a string.
+     * @param state Lua state the string belongs to.
+     * @param ref Registry reference of the string.
+     * @param view View of the string.
+     */
+    LuaPinnedString(lua_State* state, int ref, std::string_view view);
+
+    LuaPinnedString(const LuaPinnedString&) = delete;
+    LuaPinnedString& operator=(const LuaPinnedString&) = delete;
+    LuaPinnedString(LuaPinnedString&& other) noexcept;
+    LuaPinnedString& operator=(LuaPinnedString&& other) noexcept;
+
+    /**
+     * @brief Destructor. Releases the registry reference.
+     */
+    ~LuaPinnedString();
+
+    std::string_view view() const;
+    const char* data() const;
+    std::size_t size() const;
+    bool isValid() const;
+
+    operator std::string_view() const;
+    explicit operator bool() const;
+
+private:
+    void release();
+};
+
+#endif // LUA_PINNED_STRING_H
@@ -0,0 +1,364 @@
+#include "luaProfiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <limits>
+#include <sstream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <mutex>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr std::uint32_t noFunction = std::numeric_limits<std::uint32_t>::max(); /**< Returned when the function table is full. */
+    constexpr std::uint32_t truncatedFunction = 0; /**< Id of the "[truncated]" frame, added first. */
+    constexpr std::uint64_t fnvOffset = 0xcbf29ce484222325ULL;
+    constexpr std::uint64_t fnvPrime = 0x100000001b3ULL;
+
+    std::size_t slotCount(std::size_t entries)
+    {
+        return std::bit_ceil(std::max<std::size_t>(entries, 1) * 2);
+    }
+
+#ifdef __linux__
+    /**
+     * Sample timer of a thread. It is only touched by its thread and the SIGPROF handler running on it.
+     */
+    struct ThreadTimer
+    {
+        timer_t timer = {}; /**< Timer on the CPU time of the thread. */
+        bool created = false; /**< Set once the timer exists. */
+        std::chrono::nanoseconds period = {}; /**< Period the timer is armed with, zero while disarmed. */
+        std::atomic<void*> owner = nullptr; /**< State running a profiled call, nullptr between calls. */
+        std::atomic<void (*)(void*)> request = nullptr; /**< Sample request of the owner. */
+        std::atomic<bool> entered = false; /**< Set if a profiled call started since the last signal. */
+
+        ~ThreadTimer()
+        {
+            if(created)
+                ::timer_delete(timer);
+        }
+
+        void arm(std::chrono::nanoseconds interval)
+        {
+            itimerspec spec = {};
+            spec.it_value.tv_sec = static_cast<time_t>(interval.count() / 1'000'000'000);
+            spec.it_value.tv_nsec = static_cast<long>(interval.count() % 1'000'000'000);
+            spec.it_interval = spec.it_value;
+            ::timer_settime(timer, 0, &spec, nullptr);
+            period = interval;
+        }
+    };
+
+    thread_local ThreadTimer threadTimer;
+
+    void onTimerSignal(int)
+    {
+        int error = errno;
+        ThreadTimer& timer = threadTimer;
+        if(void* owner = timer.owner.load(std::memory_order_relaxed))
+            timer.request.load(std::memory_order_relaxed)(owner);
+        else if(!timer.entered.exchange(false, std::memory_order_relaxed) && timer.period != std::chrono::nanoseconds::zero())
+            timer.arm(std::chrono::nanoseconds::zero()); // the thread stopped running profiled states, timer_settime is async signal safe
+        errno = error;
+    }
+#endif
+}
+
+LuaProfiler::LuaProfiler(const LuaProfilerConfig& config)
+: mConfig(config)
+{
+    mConfig.checkInterval = std::max(mConfig.checkInterval, 1);
+    mConfig.maxDepth = std::max<std::size_t>(mConfig.maxDepth, 2);
+    mConfig.maxFunctions = std::max<std::size_t>(mConfig.maxFunctions, 2);
+    mConfig.maxStacks = std::max<std::size_t>(mConfig.maxStacks, 1);
+    mConfig.maxStackFrames = std::max(mConfig.maxStackFrames, mConfig.maxDepth);
+
+    mFunctions.resize(mConfig.maxFunctions);
+    mFunctionSlots.resize(slotCount(mConfig.maxFunctions));
+    mStacks.resize(mConfig.maxStacks);
+    mStackSlots.resize(slotCount(mConfig.maxStacks));
+    mStackFrames.resize(mConfig.maxStackFrames);
+    mScratch.resize(mConfig.maxDepth);
+#ifdef __linux__
+    mTimer = mConfig.mode == LuaProfilerMode::TIMER && mConfig.period > std::chrono::nanoseconds::zero();
+#endif
+    reset();
+}
+
+void LuaProfiler::check(lua_State* L)
+{
+    if(mConfig.period > std::chrono::nanoseconds::zero())
+    {
+        auto now = std::chrono::steady_clock::now();
+        if(now < mNextSample)
+            return;
+        mNextSample = now + mConfig.period;
+    }
+    sample(L);
+}
+
+bool LuaProfiler::sample(lua_State* L)
+{
+    lua_Debug ar;
+    std::size_t depth = 0;
+    for(int level = 0; ::lua_getstack(L, level, &ar) != 0; level++)
+    {
+        if(depth == mScratch.size())
+        {
+            // keep the innermost frames, the outermost one marks the cut
+            mScratch[depth - 1] = truncatedFunction;
+            break;
+        }
+        ::lua_getinfo(L, "Sn", &ar);
+        std::uint32_t id = functionId(ar);
+        if(id == noFunction)
+        {
+            mDropped++;
+            return false;
+        }
+        mScratch[depth++] = id;
+    }
+    if(depth == 0)
+        return false;
+    if(!addStack(depth))
+    {
+        mDropped++;
+        return false;
+    }
+    mSamples++;
+    return true;
+}
+
+void LuaProfiler::resume()
+{
+    mNextSample = std::chrono::steady_clock::now() + mUntilSample;
+}
+
+void LuaProfiler::pause()
+{
+    mUntilSample = std::max(std::chrono::duration_cast<std::chrono::nanoseconds>(mNextSample - std::chrono::steady_clock::now()),
+                            std::chrono::nanoseconds::zero());
+}
+
+void LuaProfiler::reset()
+{
+    std::fill(mFunctionSlots.begin(), mFunctionSlots.end(), 0);
+    std::fill(mStackSlots.begin(), mStackSlots.end(), 0);
+    mFunctionCount = 0;
+    mStackCount = 0;
+    mStackFrameCount = 0;
+    mSamples = 0;
+    mDropped = 0;
+    mUntilSample = {};
+    mNextSample = {};
+
+    mLabel.length = 0;
+    appendLabel("[truncated]");
+    findFunction();
+}
+
+const LuaProfilerConfig& LuaProfiler::getConfig() const
+{
+    return mConfig;
+}
+
+bool LuaProfiler::usesTimer() const
+{
+    return mTimer;
+}
+
+void* LuaProfiler::enterThread(void* owner, void (*request)(void*)) const
+{
+#ifdef __linux__
+    ThreadTimer& timer = threadTimer;
+    void* previous = timer.owner.load(std::memory_order_relaxed);
+    timer.request.store(request, std::memory_order_relaxed);
+    timer.entered.store(true, std::memory_order_relaxed);
+    timer.owner.store(owner, std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    if(timer.period == mConfig.period)
+        return previous;
+
+    static std::once_flag handlerInstalled;
+    std::call_once(handlerInstalled, []()
+    {
+        struct sigaction action = {};
+        action.sa_handler = &onTimerSignal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(SIGPROF, &action, nullptr);
+    });
+    if(!timer.created)
+    {
+        sigevent event = {};
+        event.sigev_notify = SIGEV_THREAD_ID;
+        event.sigev_signo = SIGPROF;
+        event._sigev_un._tid = static_cast<pid_t>(::syscall(SYS_gettid));
+        if(::timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer.timer) != 0)
+            return previous;
+        timer.created = true;
+    }
+    timer.arm(mConfig.period);
+    return previous;
+#else
+    (void)owner;
+    (void)request;
+    return nullptr;
+#endif
+}
+
+void LuaProfiler::leaveThread(void* previous)
+{
+#ifdef __linux__
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    threadTimer.owner.store(previous, std::memory_order_relaxed);
+#else
+    (void)previous;
+#endif
+}
+
+std::uint64_t LuaProfiler::getSamples() const
+{
+    return mSamples;
+}
+
+std::uint64_t LuaProfiler::getDropped() const
+{
+    return mDropped;
+}
+
+void LuaProfiler::writeFolded(std::ostream& out) const
+{
+    for(std::size_t i = 0; i < mStackCount; i++)
+    {
+        const Stack& stack = mStacks[i];
+        for(std::uint32_t frame = 0; frame < stack.depth; frame++)
+        {
+            const Function& function = mFunctions[mStackFrames[stack.offset + frame]];
+            if(frame != 0)
+                out << ';';
+            out.write(function.label, function.length);
+        }
+        out << ' ' << stack.count << '\n';
+    }
+}
+
+std::string LuaProfiler::getFolded() const
+{
+    std::ostringstream out;
+    writeFolded(out);
+    return out.str();
+}
+
+std::uint32_t LuaProfiler::functionId(const lua_Debug& ar)
+{
+    // the label is the identity of a function, so closures of one prototype share it and a collected
+    // prototype can not be confused with a new one at the same address
+    mLabel.length = 0;
+    if(ar.what != nullptr && ar.what[0] == 'm')
+        appendLabel("main chunk");
+    else
+        appendLabel(ar.name != nullptr ? ar.name : "?");
+    if(ar.what != nullptr && ar.what[0] == 'C')
+        appendLabel(" [C]");
+    else
+    {
+        appendLabel(" (");
+        appendLabel(ar.short_src);
+        if(ar.linedefined > 0)
+        {
+            char line[16];
+            auto end = std::to_chars(line, line + sizeof(line), ar.linedefined).ptr;
+            appendLabel(":");
+            appendLabel(std::string_view(line, static_cast<std::size_t>(end - line)));
+        }
+        appendLabel(")");
+    }
+
+    return findFunction();
+}
+
+std::uint32_t LuaProfiler::findFunction()
+{
+    std::uint64_t hash = fnvOffset;
+    for(std::uint32_t i = 0; i < mLabel.length; i++)
+        hash = (hash ^ static_cast<unsigned char>(mLabel.label[i])) * fnvPrime;
+    mLabel.hash = hash;
+
+    std::size_t mask = mFunctionSlots.size() - 1;
+    std::size_t slot = hash & mask;
+    for(; mFunctionSlots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        std::uint32_t id = mFunctionSlots[slot] - 1;
+        const Function& function = mFunctions[id];
+        if(function.hash == hash && function.length == mLabel.length &&
+           std::equal(function.label, function.label + function.length, mLabel.label))
+            return id;
+    }
+
+    if(mFunctionCount == mFunctions.size())
+        return noFunction;
+    auto id = static_cast<std::uint32_t>(mFunctionCount++);
+    mFunctions[id] = mLabel;
+    mFunctionSlots[slot] = id + 1;
+    return id;
+}
+
+bool LuaProfiler::addStack(std::size_t depth)
+{
+    // mScratch holds the innermost frame first, stacks are stored and hashed from the outermost frame
+    std::uint64_t hash = fnvOffset;
+    for(std::size_t i = depth; i-- > 0;)
+        hash = (hash ^ mScratch[i]) * fnvPrime;
+
+    std::size_t mask = mStackSlots.size() - 1;
+    std::size_t slot = hash & mask;
+    for(; mStackSlots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        Stack& stack = mStacks[mStackSlots[slot] - 1];
+        if(stack.hash != hash || stack.depth != depth)
+            continue;
+        const std::uint32_t* frames = mStackFrames.data() + stack.offset;
+        if(std::equal(frames, frames + depth, mScratch.rbegin() + static_cast<std::ptrdiff_t>(mScratch.size() - depth)))
+        {
+            stack.count++;
+            return true;
+        }
+    }
+
+    if(mStackCount == mStacks.size() || mStackFrameCount + depth > mStackFrames.size())
+        return false;
+    Stack& stack = mStacks[mStackCount];
+    stack.hash = hash;
+    stack.offset = static_cast<std::uint32_t>(mStackFrameCount);
+    stack.depth = static_cast<std::uint32_t>(depth);
+    stack.count = 1;
+    std::reverse_copy(mScratch.begin(), mScratch.begin() + static_cast<std::ptrdiff_t>(depth), mStackFrames.begin() + stack.offset);
+    mStackFrameCount += depth;
+    mStackSlots[slot] = static_cast<std::uint32_t>(++mStackCount);
+    return true;
+}
+
+void LuaProfiler::appendLabel(std::string_view text)
+{
+    for(char c : text)
+    {
+        if(mLabel.length == labelSize)
+            return;
+        // ';' separates the frames and a line break ends the stack in the folded format
+        if(c == ';')
+            c = ':';
+        else if(c == '\n' || c == '\r')
+            c = ' ';
+        mLabel.label[mLabel.length++] = c;
+    }
+}
@@ -0,0 +1,187 @@
+#ifndef LUA_PROFILER_H
+#define LUA_PROFILER_H
+
+#include <lua.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @enum LuaProfilerMode
+ * @brief How the profiler decides when to take a sample.
+ */
+enum class LuaProfilerMode
+{
+    TIMER, /**< A timer on the CPU time of the running thread requests samples with SIGPROF. Linux only, HOOK elsewhere. */
+    HOOK /**< The count hook checks the wall clock every `checkInterval` VM instructions. */
+};
+
+/**
+ * @struct LuaProfilerConfig
+ * @brief Sampling rate and table sizes of a LuaProfiler.
+ */
+struct LuaProfilerConfig
+{
+    LuaProfilerMode mode = LuaProfilerMode::TIMER; /**< Source of the sample requests. */
+    std::chrono::nanoseconds period = std::chrono::milliseconds(1); /**< Execution time between two samples. Zero samples on every check in HOOK mode. */
+    int checkInterval = 1000; /**< VM instructions between two checks of the sample clock in HOOK mode. */
+    std::size_t maxDepth = 64; /**< Frames recorded per sample, deeper stacks keep the innermost frames. */
+    std::size_t maxFunctions = 1024; /**< Distinct functions that can be recorded. */
+    std::size_t maxStacks = 8192; /**< Distinct call stacks that can be recorded. */
+    std::size_t maxStackFrames = 131072; /**< Frames of all distinct call stacks together. */
+};
+
+/**
+ * @class LuaProfiler
+ * @brief Sampling profiler of the Lua functions running in a state.
+ *
+ * In TIMER mode a POSIX timer on the CPU time of the thread running the state raises SIGPROF every
+ * `period`. The signal handler only arms a count hook of one instruction with lua_sethook, which Lua
+ * allows from signal handlers, so the VM runs without any hook between two samples. In HOOK mode the
+ * count hook checks the clock every `checkInterval` VM instructions, which works everywhere but costs
+ * a hook check on every VM instruction.
+ *
+ * The hook captures the Lua call stack with lua_getstack/lua_getinfo and counts it. All tables are
+ * allocated up front, the sample path does not allocate; samples that do not fit into the tables are
+ * counted as dropped.
+ *
+ * The profile is exported as folded stacks, one line per distinct stack with its frames from the
+ * outermost to the innermost separated by ';' followed by the sample count, as read by flamegraph.pl
+ * or speedscope. A profiler belongs to the thread of its state, read it while the state is idle.
+ */
+class LuaProfiler
+{
+public:
+    static constexpr std::size_t labelSize = 128; /**< Maximum length of a function label. */
+
+private:
+    /**
+     * @brief A recorded function with its label, e.g. "update (script.lua:12)".
+     */
+    struct Function
+    {
+        std::uint64_t hash = 0; /**< Hash of the label. */
+        std::uint32_t length = 0; /**< Length of the label. */
+        char label[labelSize] = {}; /**< Label of the function. */
+    };
+
+    /**
+     * @brief A recorded call stack, its frames are stored from the outermost to the innermost.
+     */
+    struct Stack
+    {
+        std::uint64_t hash = 0; /**< Hash of the function ids. */
+        std::uint32_t offset = 0; /**< Position of the first frame in mStackFrames. */
+        std::uint32_t depth = 0; /**< Number of frames. */
+        std::uint64_t count = 0; /**< Samples of the stack. */
+    };
+
+    LuaProfilerConfig mConfig = {}; /**< Sampling rate and table sizes. */
+    std::vector<Function> mFunctions = {}; /**< Recorded functions. */
+    std::size_t mFunctionCount = 0; /**< Used entries of mFunctions. */
+    std::vector<std::uint32_t> mFunctionSlots = {}; /**< Open addressing table of function indices + 1, 0 for empty. */
+    std::vector<Stack> mStacks = {}; /**< Recorded stacks. */
+    std::size_t mStackCount = 0; /**< Used entries of mStacks. */
+    std::vector<std::uint32_t> mStackSlots = {}; /**< Open addressing table of stack indices + 1, 0 for empty. */
+    std::vector<std::uint32_t> mStackFrames = {}; /**< Function ids of all recorded stacks. */
+    std::size_t mStackFrameCount = 0; /**< Used entries of mStackFrames. */
+    std::vector<std::uint32_t> mScratch = {}; /**< Function ids of the sample being captured, innermost first. */
+    Function mLabel = {}; /**< Label of the function being looked up. */
+    std::chrono::steady_clock::time_point mNextSample = {}; /**< Time of the next sample while running. */
+    std::chrono::nanoseconds mUntilSample = {}; /**< Execution time left until the next sample while paused. */
+    std::uint64_t mSamples = 0; /**< Recorded samples. */
+    std::uint64_t mDropped = 0; /**< Samples that did not fit into the tables. */
+    bool mTimer = false; /**< Set if samples are requested by the thread timer. */
+
+public:
+    /**
+     * @brief Constructor. Allocates all tables.
+     * @param config Sampling rate and table sizes.
+     */
+    explicit LuaProfiler(const LuaProfilerConfig& config = {});
+
+    /**
+     * @brief Captures a sample if the sample period passed. Called from the count hook.
+     * @param L Lua thread that is running.
+     */
+    void check(lua_State* L);
+
+    /**
+     * @brief Captures the current call stack of a Lua thread.
+     * @param L Lua thread, e.g. inside a registered function.
+     * @return True if the sample was recorded, false if there is no Lua frame or a table is full.
+     */
+    bool sample(lua_State* L);
+
+    /**
+     * @brief Continues the sample clock when a call into the state starts.
+     */
+    void resume();
+
+    /**
+     * @brief Stops the sample clock when a call into the state ends, so idle time is not sampled.
+     */
+    void pause();
+
+    /**
+     * @brief Discards all samples, the tables stay allocated.
+     */
+    void reset();
+
+    const LuaProfilerConfig& getConfig() const;
+
+    /**
+     * @brief Checks if samples are requested by the thread timer instead of the count hook.
+     * @return True in TIMER mode on platforms that support it.
+     */
+    bool usesTimer() const;
+
+    /**
+     * @brief Marks the calling thread as running a profiled state and arms the timer of the thread.
+     * The timer keeps running while the thread enters a profiled state at least once per period.
+     * @param owner State that receives the sample requests.
+     * @param request Called from the SIGPROF handler with the owner, must be async signal safe.
+     * @return The previous owner of the thread, passed to leaveThread.
+     */
+    void* enterThread(void* owner, void (*request)(void*)) const;
+
+    /**
+     * @brief Ends the profiled call on the calling thread.
+     * @param previous Owner returned by enterThread.
+     */
+    static void leaveThread(void* previous);
+
+    /**
+     * @brief Gets the number of recorded samples.
+     */
+    std::uint64_t getSamples() const;
+
+    /**
+     * @brief Gets the number of samples that did not fit into the tables.
+     */
+    std::uint64_t getDropped() const;
+
+    /**
+     * @brief Writes the profile as folded stacks, one "outer;...;inner count" line per distinct stack.
+     * @param out Stream written to.
+     */
+    void writeFolded(std::ostream& out) const;
+
+    /**
+     * @brief Gets the profile as folded stacks.
+     * @return The lines written by writeFolded.
+     */
+    std::string getFolded() const;
+
+private:
+    std::uint32_t functionId(const lua_Debug& ar);
+    std::uint32_t findFunction();
+    bool addStack(std::size_t depth);
+    void appendLabel(std::string_view text);
+};
+
+#endif // LUA_PROFILER_H
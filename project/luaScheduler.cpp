@@ -0,0 +1,153 @@
+#include "luaScheduler.h"
+
+#include <thread>
+
+LuaScheduler::LuaScheduler(LuaScript& script)
+: mScript(script)
+{}
+
+int LuaScheduler::suspend()
+{
+    mRequest = Request::SUSPEND;
+    return mScript.yield(0);
+}
+
+int LuaScheduler::sleepFor(Clock::duration duration)
+{
+    mRequest = Request::SLEEP;
+    mWakeTime = Clock::now() + duration;
+    return mScript.yield(0);
+}
+
+FuncInfo LuaScheduler::registerSleep(std::string_view funcName)
+{
+    return mScript.regFunc([this](LuaScript& lua) -> int
+    {
+        double seconds = lua.toNumber(1);
+        if(!(seconds > 0.0))
+            return sleepFor(Clock::duration::zero());
+        return sleepFor(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds)));
+    }, funcName);
+}
+
+bool LuaScheduler::cancel(LuaTaskId id)
+{
+    if(id == mCurrent)
+        return false;
+    return mTasks.erase(id) != 0;
+}
+
+std::size_t LuaScheduler::runOnce()
+{
+    wakeSleepers(Clock::now());
+
+    std::size_t count = mReady.size();
+    std::size_t resumed = 0;
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        LuaTaskId id = mReady.front();
+        mReady.pop_front();
+        if(!mTasks.contains(id))
+            continue;
+        resume(id);
+        ++resumed;
+    }
+    return resumed;
+}
+
+void LuaScheduler::run()
+{
+    while(!mTasks.empty())
+    {
+        runOnce();
+        if(!mReady.empty())
+            continue;
+
+        Clock::time_point wakeTime = nextWakeTime();
+        if(wakeTime == Clock::time_point::max())
+            break;
+        std::this_thread::sleep_until(wakeTime);
+    }
+}
+
+void LuaScheduler::setCompletionHandler(CompletionHandler handler)
+{
+    mOnComplete = std::move(handler);
+}
+
+LuaTaskId LuaScheduler::current() const
+{
+    return mCurrent;
+}
+
+std::size_t LuaScheduler::size() const
+{
+    return mTasks.size();
+}
+
+std::size_t LuaScheduler::readyCount() const
+{
+    return mReady.size();
+}
+
+LuaScheduler::Clock::time_point LuaScheduler::nextWakeTime()
+{
+    // drop entries of tasks that were cancelled while sleeping
+    while(!mSleeping.empty())
+    {
+        auto iter = mTasks.find(mSleeping.top().second);
+        if(iter != mTasks.end() && iter->second.state == TaskState::SLEEPING && iter->second.wakeTime == mSleeping.top().first)
+            return mSleeping.top().first;
+        mSleeping.pop();
+    }
+    return Clock::time_point::max();
+}
+
+void LuaScheduler::resume(LuaTaskId id)
+{
+    Entry& entry = mTasks.at(id);
+    mCurrent = id;
+    mRequest = Request::NONE;
+    FuncInfo info = mScript.resumeTask(entry.task, entry.nargs);
+    mCurrent = 0;
+    entry.nargs = 0;
+
+    if(entry.task.getStatus() != LuaTaskStatus::YIELDED)
+    {
+        if(mOnComplete)
+            mOnComplete(id, entry.task, info);
+        mTasks.erase(id);
+        return;
+    }
+
+    switch(mRequest)
+    {
+        case Request::SUSPEND:
+            entry.state = TaskState::SUSPENDED;
+            break;
+        case Request::SLEEP:
+            entry.task.clearResults();
+            entry.state = TaskState::SLEEPING;
+            entry.wakeTime = mWakeTime;
+            mSleeping.emplace(mWakeTime, id);
+            break;
+        case Request::NONE:
+            entry.task.clearResults();
+            entry.state = TaskState::READY;
+            mReady.push_back(id);
+            break;
+    }
+    mRequest = Request::NONE;
+}
+
+void LuaScheduler::wakeSleepers(Clock::time_point now)
+{
+    while(nextWakeTime() <= now)
+    {
+        LuaTaskId id = mSleeping.top().second;
+        mSleeping.pop();
+        Entry& entry = mTasks.at(id);
+        entry.state = TaskState::READY;
+        mReady.push_back(id);
+    }
+}
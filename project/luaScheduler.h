@@ -0,0 +1,221 @@
+#ifndef LUA_SCHEDULER_H
+#define LUA_SCHEDULER_H
+
+#include <lua.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "luaScript.h"
+#include "luaTask.h"
+#include "funcInfo.h"
+
+using LuaTaskId = std::uint64_t;
+
+/**
+ * @class LuaScheduler
+ * @brief Cooperative scheduler that multiplexes many LuaTasks on one LuaScript.
+ *
+ * Tasks run until they yield, then the next ready task is resumed. A task yielded with
+ * `coroutine.yield` stays ready, a task suspended by a registered function waits for wake and a
+ * sleeping task becomes ready once its wake time passed. The scheduler is bound to the thread
+ * that owns the LuaScript.
+ */
+class LuaScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using CompletionHandler = std::function<void(LuaTaskId, LuaTask&, const FuncInfo&)>;
+
+private:
+    enum class TaskState : int
+    {
+        READY,
+        SUSPENDED,
+        SLEEPING,
+    };
+
+    enum class Request : int
+    {
+        NONE,
+        SUSPEND,
+        SLEEP,
+    };
+
+    struct Entry
+    {
+        LuaTask task;
+        TaskState state = TaskState::READY;
+        int nargs = 0;
+        Clock::time_point wakeTime = {};
+    };
+
+    using Sleeper = std::pair<Clock::time_point, LuaTaskId>;
+
+    LuaScript& mScript; /**< Script the tasks run in. */
+    std::unordered_map<LuaTaskId, Entry> mTasks = {}; /**< Live tasks by id. */
+    std::deque<LuaTaskId> mReady = {}; /**< Tasks to resume in order. */
+    std::priority_queue<Sleeper, std::vector<Sleeper>, std::greater<Sleeper>> mSleeping = {}; /**< Sleeping tasks by wake time. */
+    LuaTaskId mNextId = 1; /**< Id of the next spawned task. */
+    LuaTaskId mCurrent = 0; /**< Id of the running task, 0 outside of a resume. */
+    Request mRequest = Request::NONE; /**< What the running task asked for when it yields. */
+    Clock::time_point mWakeTime = {}; /**< Wake time requested by sleepFor. */
+    CompletionHandler mOnComplete = nullptr; /**< Called when a task returned or failed. */
+
+public:
+    /**
+     * @brief Constructor with the script the tasks run in.
+     * @param script Script the tasks run in. It must outlive the scheduler.
+     */
+    explicit LuaScheduler(LuaScript& script);
+
+    LuaScheduler(const LuaScheduler&) = delete;
+    LuaScheduler& operator=(const LuaScheduler&) = delete;
+
+    /**
+     * @brief Spawns a task running a global Lua function.
+     * @tparam Args Types of the arguments.
+     * @param funcName Name of the global Lua function.
+     * @param args Arguments passed to the function.
+     * @return Id of the task, 0 if the global is not a function.
+     */
+    template<typename... Args>
+    LuaTaskId spawn(std::string_view funcName, const Args&... args)
+    {
+        return add(mScript.createTask(funcName), args...);
+    }
+
+    /**
+     * @brief Spawns a task running a prepared Lua function.
+     * @tparam Args Types of the arguments.
+     * @param funcRef Handle returned by LuaScript::prepare.
+     * @param args Arguments passed to the function.
+     * @return Id of the task, 0 if the reference is invalid.
+     */
+    template<typename... Args>
+    LuaTaskId spawn(const LuaFunctionRef& funcRef, const Args&... args)
+    {
+        return add(mScript.createTask(funcRef), args...);
+    }
+
+    /**
+     * @brief Makes a suspended task ready. The values become the results of its yield.
+     * @tparam Args Types of the values.
+     * @param id Id of the task.
+     * @param args Values passed to the task.
+     * @return False if the task does not exist or is not suspended.
+     */
+    template<typename... Args>
+    bool wake(LuaTaskId id, const Args&... args)
+    {
+        auto iter = mTasks.find(id);
+        if(iter == mTasks.end() || iter->second.state != TaskState::SUSPENDED)
+            return false;
+
+        Entry& entry = iter->second;
+        entry.task.clearResults();
+        (LuaStack::push(entry.task.getThread(), args), ...);
+        entry.nargs = static_cast<int>(sizeof...(Args));
+        entry.state = TaskState::READY;
+        mReady.push_back(id);
+        return true;
+    }
+
+    /**
+     * @brief Suspends the running task until wake is called for it.
+     * Use as return statement of a registered function: `return scheduler.suspend();`.
+     * @return Number of values to yield.
+     */
+    int suspend();
+
+    /**
+     * @brief Suspends the running task for the given duration.
+     * Use as return statement of a registered function: `return scheduler.sleepFor(10ms);`.
+     * @param duration Time to sleep.
+     * @return Number of values to yield.
+     */
+    int sleepFor(Clock::duration duration);
+
+    /**
+     * @brief Registers a Lua function that lets scripts sleep, e.g. `sleep(0.5)`.
+     * @param funcName Name of the Lua function. The argument is the duration in seconds.
+     * @return Result of the registration.
+     */
+    FuncInfo registerSleep(std::string_view funcName = "sleep");
+
+    /**
+     * @brief Removes a task without running it to completion.
+     * @param id Id of the task.
+     * @return False if the task does not exist or is running.
+     */
+    bool cancel(LuaTaskId id);
+
+    /**
+     * @brief Resumes every task that is ready, including sleeping tasks whose wake time passed.
+     * Tasks that become ready during the pass are resumed in the next pass.
+     * @return Number of resumed tasks.
+     */
+    std::size_t runOnce();
+
+    /**
+     * @brief Runs tasks until none is ready or sleeping. Waits for the next sleeping task when idle.
+     * Returns with suspended tasks left, they continue on the next run after wake.
+     */
+    void run();
+
+    /**
+     * @brief Sets the function called when a task returned or failed.
+     * The values returned by the task are on top of the stack of the task thread.
+     * @param handler Completion handler.
+     */
+    void setCompletionHandler(CompletionHandler handler);
+
+    /**
+     * @brief Gets the id of the running task.
+     * @return Id of the running task, 0 outside of a resume.
+     */
+    LuaTaskId current() const;
+
+    /**
+     * @brief Gets the number of live tasks.
+     * @return Number of ready, suspended and sleeping tasks.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Gets the number of ready tasks.
+     * @return Number of tasks waiting to be resumed.
+     */
+    std::size_t readyCount() const;
+
+    /**
+     * @brief Gets the wake time of the next sleeping task.
+     * @return Wake time, Clock::time_point::max() if no task sleeps.
+     */
+    Clock::time_point nextWakeTime();
+
+private:
+    template<typename... Args>
+    LuaTaskId add(LuaTask&& task, const Args&... args)
+    {
+        if(!task)
+            return 0;
+
+        (LuaStack::push(task.getThread(), args), ...);
+        LuaTaskId id = mNextId++;
+        mTasks.emplace(id, Entry{std::move(task), TaskState::READY, static_cast<int>(sizeof...(Args))});
+        mReady.push_back(id);
+        return id;
+    }
+
+    void resume(LuaTaskId id);
+    void wakeSleepers(Clock::time_point now);
+};
+
+#endif // LUA_SCHEDULER_H
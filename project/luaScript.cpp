@@ -2,85 +2,64 @@
 
 LuaScript::LuaScript()
 {
-    L = ::luaL_newstate();
-    ::luaL_openlibs(L);
+    initState(::Lua_lib_all);
 }
 
 LuaScript::LuaScript(const std::filesystem::path& path)
 : mPath(path)
 {
-    L = ::luaL_newstate();
-    ::luaL_openlibs(L);
+    initState(::Lua_lib_all);
 }
 
 LuaScript::LuaScript(std::size_t libs)
 {  
-    L = ::luaL_newstate();
-    openLibs(libs);
+    initState(libs);
 }
 
 LuaScript::LuaScript(const std::filesystem::path &path, std::size_t libs)
 : mPath(path)
 {
-    L = ::luaL_newstate();
-    openLibs(libs);
+    initState(libs);
 }
 
-LuaScript::~LuaScript()
+LuaScript::LuaScript(std::shared_ptr<LuaAllocator> allocator, std::size_t libs)
+: mAllocator(std::move(allocator))
 {
-    ::lua_close(L);
+    initState(libs);
 }
 
-FuncInfo LuaScript::regFunc(std::string_view funcName, FuncDescription& funcDesc)
+LuaScript::LuaScript(const std::filesystem::path& path, std::shared_ptr<LuaAllocator> allocator, std::size_t libs)
+: mPath(path), mAllocator(std::move(allocator))
 {
-    ::lua_getglobal(L, funcName.data());
-    if(!mFuncDesc.contains(funcName) && !lua_isfunction(L, -1))
-    {
-        mFuncDesc.try_emplace(funcName.data(), &funcDesc);
-        return FuncInfo(FuncInfoType::OK);
-    }
-
-    std::string errmsg;
-    errmsg.append("Failed to register function[").append(funcName).append("] - Function name is already registred!");
-    return FuncInfo(errmsg, FuncInfoType::REGISTER);
+    initState(libs);
 }
 
-FuncInfo LuaScript::regFunc(std::string_view funcName, const FuncDescription& funcDesc)
+LuaScript::~LuaScript()
 {
-::lua_getglobal(L, funcName.data());
-    if(!mFuncDesc.contains(funcName) && !lua_isfunction(L, -1))
-    {
-        mFuncDesc.try_emplace(funcName.data(), const_cast<FuncDescription*>(&funcDesc));
-        return FuncInfo(FuncInfoType::OK);
-    }
-
-    std::string errmsg;
-    errmsg.append("Failed to register function[").append(funcName).append("] - Function name is already registred!");
-    return FuncInfo(errmsg, FuncInfoType::REGISTER);
+    ::lua_close(L);
 }
 
-template<typename LuaCFunc>
-FuncInfo LuaScript::regFunc(LuaCFunc func, std::string_view funcName, const FuncDescription& funcDesc)
+FuncInfo LuaScript::regFunc(std::string_view funcName, FuncDescription& funcDesc)
 {
-    auto cFunPtr = func;
-    static auto luaCFunc = [this, cFunPtr](lua_State const*)
-    {
-        return (*cFunPtr)(*this);
-    };
-
-    auto luaBaseFunc = Lambda::ptr<int, lua_CFunction>(luaCFunc);
-    auto info = regFunc(funcName, funcDesc);
-
+    auto info = checkFuncName(funcName);
     if(info)
-        lua_register(L, funcName.data(), luaBaseFunc);
+        addFunc(funcName, &funcDesc, LuaFunctionKind::SCRIPT);
     return info;
 }
 
-template FuncInfo LuaScript::regFunc<int(*)(LuaScript&)>(int(*)(LuaScript&), std::string_view, const FuncDescription&);
+FuncInfo LuaScript::regFunc(std::string_view funcName, const FuncDescription& funcDesc)
+{
+    auto info = checkFuncName(funcName);
+    if(info)
+        addFunc(funcName, &mOwnedFuncDesc.emplace_back(funcDesc), LuaFunctionKind::SCRIPT);
+    return info;
+}
 
 FuncInfo LuaScript::compile()
 {
     using enum FuncInfoType;
+    std::string fileName = mPath.filename().string();
+    LuaTraceSpan span(fileName, LuaTraceCategory::COMPILE);
     if(!std::filesystem::exists(mPath))
     {   
         std::string errmsg;
@@ -88,23 +67,72 @@ FuncInfo LuaScript::compile()
         return FuncInfo(errmsg, COMPILE);
     }
 
-    if(luaL_dofile(L, mPath.string().c_str()))
+    // parsing is protected, so it runs under the memory limit like the chunk
+    int gcDepth = beginExecution();
+    if(mBytecodeCache)
+    {
+        auto info = mBytecodeCache->load(L, mPath);
+        if(!info)
+        {
+            endExecution(gcDepth);
+            return info;
+        }
+
+        int status = lua_pcall(L, 0, LUA_MULTRET, 0);
+        endExecution(gcDepth);
+        if(status != LUA_OK)
+        {
+            std::string errmsg;
+            errmsg.append("Failed to compile lua script with path[").append(mPath.string()).append("] - ").append(LuaStack::errorMessage(L, -1));
+            return FuncInfo(errmsg, errorType(status, COMPILE));
+        }
+        return FuncInfo(OK);
+    }
+
+    int status = ::luaL_loadfilex(L, mPath.string().c_str(), nullptr);
+    if(status == LUA_OK)
+        status = lua_pcall(L, 0, LUA_MULTRET, 0);
+    endExecution(gcDepth);
+    if(status != LUA_OK)
     {
         std::string errmsg;
-        errmsg.append("Failed to compile lua script with path[").append(mPath.string()).append("] - ").append(lua_tostring(L, -1));
-        return FuncInfo(errmsg, COMPILE);
+        errmsg.append("Failed to compile lua script with path[").append(mPath.string()).append("] - ").append(LuaStack::errorMessage(L, -1));
+        return FuncInfo(errmsg, errorType(status, COMPILE));
     }
     return FuncInfo(OK);
 }
 
+void LuaScript::setBytecodeCache(const std::filesystem::path& cacheDir)
+{
+    mBytecodeCache.emplace(cacheDir);
+}
+
+void LuaScript::clearBytecodeCache()
+{
+    mBytecodeCache.reset();
+}
+
 FuncInfo LuaScript::compileString(std::string_view luaCode)
+{
+    // the code is not required to be null terminated, the chunk name only needs its beginning
+    return compileString(luaCode, luaCode.substr(0, LUA_IDSIZE));
+}
+
+FuncInfo LuaScript::compileString(std::string_view luaCode, std::string_view chunkName)
 {
     using enum FuncInfoType;
-    if(luaL_dostring(L, luaCode.data()))
+    LuaTraceSpan span("compileString", LuaTraceCategory::COMPILE);
+    std::string name(chunkName);
+    int gcDepth = beginExecution();
+    int status = ::luaL_loadbufferx(L, luaCode.data(), luaCode.size(), name.c_str(), nullptr);
+    if(status == LUA_OK)
+        status = lua_pcall(L, 0, LUA_MULTRET, 0);
+    endExecution(gcDepth);
+    if(status != LUA_OK)
     {
         std::string errmsg;
-        errmsg.append("Failed to compile lua script with path[").append(mPath.string()).append("] - ").append(lua_tostring(L, -1));
-        return FuncInfo(errmsg, COMPILE);
+        errmsg.append("Failed to compile lua script with path[").append(mPath.string()).append("] - ").append(LuaStack::errorMessage(L, -1));
+        return FuncInfo(errmsg, errorType(status, COMPILE));
     }
     return FuncInfo(OK);
 }
@@ -112,43 +140,193 @@ FuncInfo LuaScript::compileString(std::string_view luaCode)
 FuncInfo LuaScript::doFunc(std::string_view funcName)
 {
     using enum FuncInfoType;
-    ::lua_getglobal(L, funcName.data());
+    auto iter = mFuncDesc.find(funcName);
+    if(iter == mFuncDesc.end())
+    {
+        std::string errmsg;
+        errmsg.append("Failed to run function[").append(funcName).append("] - no function with this name was registred");
+        return FuncInfo(errmsg, RUN);
+    }
 
-    FuncDescription* disc = nullptr;
+    ::lua_getglobal(L, iter->first.c_str());
+    return callFunc(*iter->second.desc, funcName, iter->second.stats);
+}
+
+LuaFunctionRef LuaScript::prepare(std::string_view funcName)
+{
+    auto iter = mFuncDesc.find(funcName);
+    if(iter == mFuncDesc.end())
+        return LuaFunctionRef();
 
-    for(auto const& [key, value] : mFuncDesc)
+    ::lua_getglobal(L, iter->first.c_str());
+    if(!lua_isfunction(L, -1))
     {
-        if(key == funcName)
+        lua_pop(L, 1);
+        return LuaFunctionRef();
+    }
+
+    // the registry is shared by all threads, the handle keeps the main thread because L may be a coroutine
+    int ref = ::luaL_ref(L, LUA_REGISTRYINDEX);
+    return LuaFunctionRef(mMainState, ref, iter->second.desc, funcName, iter->second.stats);
+}
+
+FuncInfo LuaScript::doFunc(const LuaFunctionRef& funcRef)
+{
+    using enum FuncInfoType;
+    if(!funcRef)
+    {
+        std::string errmsg;
+        errmsg.append("Failed to run function[").append(funcRef.getName()).append("] - invalid function reference");
+        return FuncInfo(errmsg, RUN);
+    }
+
+    funcRef.push(L);
+    return callFunc(*funcRef.getFuncDesc(), funcRef.getName(), funcRef.getStats());
+}
+
+FuncInfo LuaScript::runBatch(const LuaFunctionRef& funcRef, lua_CFunction invoke, BatchState& batch)
+{
+    using enum FuncInfoType;
+    if(!funcRef)
+    {
+        std::string errmsg;
+        errmsg.append("Failed to run function[").append(funcRef.getName()).append("] - invalid function reference");
+        return FuncInfo(errmsg, RUN);
+    }
+
+    batch.stats = measuredStats(funcRef.getStats());
+    funcRef.push(L);
+    // the tracer records the batch as one span, the call statistics record every item
+    CallTiming timing(nullptr);
+    int gcDepth = beginExecution();
+    int status = LUA_OK;
+    bool outOfMemory = false;
+    // one protected call runs every item, unless their results are collected after each item
+    while(status == LUA_OK && !outOfMemory && !batch.mismatch && batch.index < batch.size)
+    {
+        ::lua_pushcfunction(L, invoke);
+        ::lua_pushlightuserdata(L, &batch);
+        ::lua_pushvalue(L, -3);
+        status = lua_pcall(L, 2, batch.collect ? 1 : 0, 0);
+        if(status != LUA_OK || batch.collect == nullptr)
+            continue;
+        try
         {
-            disc = value;
-            break;
+            batch.collect(L, batch);
+        }
+        catch(const std::bad_alloc&)
+        {
+            outOfMemory = true;
         }
+        lua_pop(L, 1);
     }
+    endExecution(gcDepth);
+    timing.finish(LuaTraceCategory::SCRIPT, funcRef.getName(), status != LUA_OK || outOfMemory || batch.mismatch);
+    // remove the function, an error message stays on top
+    if(status != LUA_OK)
+        lua_remove(L, -2);
+    else
+        lua_pop(L, 1);
+    if(mGcConfig.stepBudget > 0)
+        stepGc(mGcConfig.stepBudget);
 
-    if(!disc)
+    if(status != LUA_OK)
     {
+        // the failing item unwound invokeBatch before it could record itself
+        if(batch.stats && batch.start != std::chrono::steady_clock::time_point{})
+            batch.stats->record(batch.start, true);
         std::string errmsg;
-        errmsg.append("Failed to run function[").append(funcName).append("] - no function with this name was registred");
+        errmsg.append("Failed to run function[").append(funcRef.getName()).append("] - item ").append(std::to_string(batch.index)).append(": ").append(LuaStack::errorMessage(L, -1));
+        lua_pop(L, 1);
+        return FuncInfo(errmsg, errorType(status, RUN));
+    }
+    if(outOfMemory)
+    {
+        std::string errmsg;
+        errmsg.append("Failed to run function[").append(funcRef.getName()).append("] - item ").append(std::to_string(batch.index)).append(": not enough memory to copy the returned value");
+        return FuncInfo(errmsg, MEMORY);
+    }
+    if(batch.mismatch)
+    {
+        std::string errmsg;
+        errmsg.append("Failed to run function[").append(funcRef.getName()).append("] - item ").append(std::to_string(batch.index)).append(": returned value does not match the expected type");
         return FuncInfo(errmsg, RUN);
     }
+    return FuncInfo(OK);
+}
+
+LuaTask LuaScript::createTask(std::string_view funcName)
+{
+    ::lua_getglobal(L, std::string(funcName).c_str());
+    if(!lua_isfunction(L, -1))
+    {
+        lua_pop(L, 1);
+        return LuaTask();
+    }
 
-    std::vector<LuaDescValue>& args = disc->getArgs();
-    std::vector<LuaDescValueR>& retVals = disc->getRetVals();
+    lua_State* thread = ::lua_newthread(L);
+    lua_insert(L, -2);
+    ::lua_xmove(L, thread, 1);
+    int ref = ::luaL_ref(L, LUA_REGISTRYINDEX);
+    return LuaTask(mMainState, thread, ref, funcName);
+}
 
-    resolveArgs(args);
+LuaTask LuaScript::createTask(const LuaFunctionRef& funcRef)
+{
+    if(!funcRef)
+        return LuaTask();
 
-    if(lua_pcall(L, args.size(), retVals.size(), 0))
+    lua_State* thread = ::lua_newthread(L);
+    funcRef.push(thread);
+    int ref = ::luaL_ref(L, LUA_REGISTRYINDEX);
+    return LuaTask(mMainState, thread, ref, funcRef.getName());
+}
+
+FuncInfo LuaScript::resumeTask(LuaTask& task, int nargs)
+{
+    using enum FuncInfoType;
+    if(!task.isResumable())
     {
         std::string errmsg;
-        errmsg.append("Failed to run function[").append(funcName).append("] - ").append(lua_tostring(L, -1));
+        errmsg.append("Failed to resume task[").append(task.getName()).append("] - task is not resumable");
         return FuncInfo(errmsg, RUN);
     }
 
-    resolveRets(retVals);
-    
-    lua_pop(L, retVals.size());
+    lua_State* thread = task.getThread();
+    lua_State* caller = L;
+    int results = 0;
+    L = thread;
+    lua_State* sampled = mSampleState.exchange(thread);
+    CallTiming timing(nullptr);
+    int gcDepth = beginExecution();
+    int status = ::lua_resume(thread, caller, nargs, &results);
+    endExecution(gcDepth);
+    mSampleState = sampled;
+    timing.finish(LuaTraceCategory::SCRIPT, task.getName(), status != LUA_OK && status != LUA_YIELD);
+    L = caller;
 
-    return FuncInfo(OK);
+    if(status == LUA_YIELD)
+    {
+        task.setStatus(LuaTaskStatus::YIELDED, results);
+        return FuncInfo(OK);
+    }
+    if(status == LUA_OK)
+    {
+        task.setStatus(LuaTaskStatus::DONE, results);
+        return FuncInfo(OK);
+    }
+
+    std::string errmsg;
+    errmsg.append("Failed to run task[").append(task.getName()).append("] - ").append(LuaStack::errorMessage(thread, -1));
+    lua_pop(thread, 1);
+    task.setStatus(LuaTaskStatus::FAILED, 0);
+    return FuncInfo(errmsg, errorType(status, RUN));
+}
+
+int LuaScript::yield(int nresults)
+{
+    mYieldResults = nresults;
+    return nresults;
 }
 
 std::string_view LuaScript::toString(int index)
@@ -158,7 +336,21 @@ std::string_view LuaScript::toString(int index)
         std::cout << "Failed to get string: " << ::lua_tostring(L, -1) << std::endl;
         return "";
     }
-    return ::lua_tostring(L, index);
+    std::size_t len = 0;
+    const char* str = ::lua_tolstring(L, index, &len);
+    return std::string_view(str, len);
+}
+
+LuaPinnedString LuaScript::pinString(int index)
+{
+    if(::lua_type(L, index) != LUA_TSTRING)
+        return LuaPinnedString();
+
+    std::size_t len = 0;
+    const char* str = ::lua_tolstring(L, index, &len);
+    ::lua_pushvalue(L, index);
+    int ref = ::luaL_ref(L, LUA_REGISTRYINDEX);
+    return LuaPinnedString(mMainState, ref, std::string_view(str, len));
 }
 
 long long LuaScript::toInteger(int index)
@@ -193,7 +385,7 @@ double LuaScript::toNumber(int index)
 
 void LuaScript::pushString(std::string_view string)
 {
-    ::lua_pushstring(L, string.data());
+    ::lua_pushlstring(L, string.data(), string.size());
     mRetValCount++;
 }
 
@@ -233,32 +425,33 @@ void LuaScript::resolvePushTable(LuaTable &table, long long idx)
             auto [name, value] = table.getNextValue();
             if(value.hasType<long long>())
             {
-                ::lua_pushstring(L, name.data());
+                ::lua_pushlstring(L, name.data(), name.size());
                 ::lua_pushinteger(L,  value.retrieve<long long>());
                 ::lua_settable(L, -3);
             }
             else if(value.hasType<double>())
             {
-                ::lua_pushstring(L, name.data());
+                ::lua_pushlstring(L, name.data(), name.size());
                 ::lua_pushnumber(L,  value.retrieve<double>());
                 ::lua_settable(L, -3);
             }
             else if(value.hasType<bool>())
             {
-                ::lua_pushstring(L, name.data());
+                ::lua_pushlstring(L, name.data(), name.size());
                 ::lua_pushboolean(L,  value.retrieve<bool>());
                 ::lua_settable(L, -3);
             }
             else if(value.hasType<std::string>())
             {
-                ::lua_pushstring(L, name.data());
-                ::lua_pushstring(L, value.retrieve<std::string>().data());
+                ::lua_pushlstring(L, name.data(), name.size());
+                auto const& str = value.retrieve<std::string>();
+                ::lua_pushlstring(L, str.data(), str.size());
                 ::lua_settable(L, -3);
             }
             else if(value.hasType<LuaTable>())
             {
                 auto t = value.retrieve<LuaTable>();
-                ::lua_pushstring(L, t.getName().data());
+                ::lua_pushlstring(L, t.getName().data(), t.getName().size());
                 resolvePushTable(t, 1);
                 ::lua_settable(L, -3);
             }
@@ -295,7 +488,8 @@ void LuaScript::resolvePushTable(LuaTable &table, long long idx)
             }
             else if(value.hasType<std::string>())
             {
-                ::lua_pushstring(L,  value.retrieve<std::string>().data());
+                auto const& str = value.retrieve<std::string>();
+                ::lua_pushlstring(L, str.data(), str.size());
                 ::lua_rawseti(L, -2, idx);
                 idx++;
             }
@@ -317,30 +511,399 @@ void LuaScript::resolvePushTable(LuaTable &table, long long idx)
 void LuaScript::pushTable(LuaTable &table, long long idx)
 {
     resolvePushTable(table, idx);
-    ::lua_setglobal(L, table.getName().data());
+    ::lua_setglobal(L, std::string(table.getName()).c_str());
+}
+
+static_assert(std::is_same_v<lua_Number, double> && std::is_same_v<lua_Integer, long long>, "Bulk array transfer expects the default lua number types");
+
+bool LuaScript::pushArray(std::span<const double> values)
+{
+    if(values.size() > INT_MAX)
+        return false;
+    ::lua_createtable(L, static_cast<int>(values.size()), 0);
+    ::lua_rawsetnumbers(L, -1, values.data(), static_cast<unsigned int>(values.size()));
+    mRetValCount++;
+    return true;
+}
+
+bool LuaScript::pushArray(std::span<const long long> values)
+{
+    if(values.size() > INT_MAX)
+        return false;
+    ::lua_createtable(L, static_cast<int>(values.size()), 0);
+    ::lua_rawsetintegers(L, -1, values.data(), static_cast<unsigned int>(values.size()));
+    mRetValCount++;
+    return true;
+}
+
+bool LuaScript::pushArray(std::string_view name, std::span<const double> values)
+{
+    if(values.size() > INT_MAX)
+        return false;
+    ::lua_createtable(L, static_cast<int>(values.size()), 0);
+    ::lua_rawsetnumbers(L, -1, values.data(), static_cast<unsigned int>(values.size()));
+    ::lua_setglobal(L, std::string(name).c_str());
+    return true;
+}
+
+bool LuaScript::pushArray(std::string_view name, std::span<const long long> values)
+{
+    if(values.size() > INT_MAX)
+        return false;
+    ::lua_createtable(L, static_cast<int>(values.size()), 0);
+    ::lua_rawsetintegers(L, -1, values.data(), static_cast<unsigned int>(values.size()));
+    ::lua_setglobal(L, std::string(name).c_str());
+    return true;
+}
+
+void LuaScript::pushSharedData(const LuaSharedData& data)
+{
+    LuaSharedData::push(L, data);
+    mRetValCount++;
+}
+
+void LuaScript::pushSharedData(std::string_view name, const LuaSharedData& data)
+{
+    LuaSharedData::push(L, data);
+    ::lua_setglobal(L, std::string(name).c_str());
+}
+
+std::size_t LuaScript::readArray(std::string_view name, std::span<double> values)
+{
+    ::lua_getglobal(L, std::string(name).c_str());
+    auto count = readArray(-1, values);
+    lua_pop(L, 1);
+    return count;
+}
+
+std::size_t LuaScript::readArray(std::string_view name, std::span<long long> values)
+{
+    ::lua_getglobal(L, std::string(name).c_str());
+    auto count = readArray(-1, values);
+    lua_pop(L, 1);
+    return count;
+}
+
+std::size_t LuaScript::readArray(int index, std::span<double> values)
+{
+    if(!lua_istable(L, index))
+        return 0;
+    // no Lua array holds more than INT_MAX values, so a larger buffer is only filled up to that
+    return ::lua_rawgetnumbers(L, index, values.data(), static_cast<unsigned int>(std::min<std::size_t>(values.size(), INT_MAX)));
+}
+
+std::size_t LuaScript::readArray(int index, std::span<long long> values)
+{
+    if(!lua_istable(L, index))
+        return 0;
+    // no Lua array holds more than INT_MAX values, so a larger buffer is only filled up to that
+    return ::lua_rawgetintegers(L, index, values.data(), static_cast<unsigned int>(std::min<std::size_t>(values.size(), INT_MAX)));
 }
 
 LuaTable LuaScript::getTable(std::string_view name)
 {
     int idx = -1;
-    ::lua_getglobal(L, name.data());
+    ::lua_getglobal(L, std::string(name).c_str());
     if (!lua_istable(L, idx))
     {
-        return LuaTable();       
+        lua_pop(L, 1);
+        return LuaTable();
     }
 
     LuaTable table(name);
 
     resolveTable(table, idx);
+    lua_pop(L, 1);
 
     return table;
 }
 
+FuncInfo LuaScript::getFlatTable(std::string_view name, LuaFlatTable& table)
+{
+    table.clear();
+    ::lua_getglobal(L, std::string(name).c_str());
+    if(!lua_istable(L, -1))
+    {
+        lua_pop(L, 1);
+        std::string errmsg;
+        errmsg.append("Failed to get table[").append(name).append("] - global is not a table");
+        return FuncInfo(errmsg, FuncInfoType::RUN);
+    }
+
+    lua_newtable(L);
+    bool converted = flattenTable(table, ::lua_absindex(L, -2), ::lua_absindex(L, -1), 0) != UINT32_MAX;
+    lua_pop(L, 2);
+    if(!converted)
+    {
+        table.clear();
+        std::string errmsg;
+        errmsg.append("Failed to get table[").append(name).append("] - tables nested deeper than ")
+              .append(std::to_string(Lua_flat_max_depth)).append(" levels");
+        return FuncInfo(errmsg, FuncInfoType::RUN);
+    }
+    return FuncInfo(FuncInfoType::OK);
+}
+
+LuaTableView LuaScript::getTableView(std::string_view name)
+{
+    // the view reads through the main thread, L may be a coroutine that is collected before the view
+    ::lua_getglobal(L, std::string(name).c_str());
+    if(L != mMainState)
+        ::lua_xmove(L, mMainState, 1);
+    LuaTableView view(mMainState, -1);
+    lua_pop(mMainState, 1);
+    return view;
+}
+
 lua_State* LuaScript::getLuaState()
 {
     return L;
 }
 
+void LuaScript::takeSnapshot()
+{
+    if(mSnapshot.ref != LUA_NOREF)
+        ::luaL_unref(L, LUA_REGISTRYINDEX, mSnapshot.ref);
+
+    // snapshot = { tables = {[t] = {k = v}}, metatables = {[t] = mt or false}, upvalues = {[f] = {n = n, ...}} }
+    int top = ::lua_gettop(L);
+    int tables = top + 2;
+    int metatables = top + 3;
+    int upvalues = top + 4;
+    int pending = top + 5;
+    ::lua_createtable(L, 0, 3);
+    lua_newtable(L);
+    lua_newtable(L);
+    lua_newtable(L);
+    lua_newtable(L);
+    // every table reachable from the globals and the string metatable, e.g. package.loaded, is recorded once;
+    // the tables map is the visited set and the pending list replaces recursion, so deep nestings can not overflow the stack
+    lua_pushglobaltable(L);
+    pendTable(-1, tables, pending);
+    lua_pushliteral(L, "");
+    if(::lua_getmetatable(L, -1))
+        pendTable(-1, tables, pending);
+    ::lua_settop(L, pending);
+    for(auto count = ::lua_rawlen(L, pending); count > 0; count = ::lua_rawlen(L, pending))
+    {
+        ::lua_rawgeti(L, pending, static_cast<lua_Integer>(count));
+        ::lua_pushnil(L);
+        ::lua_rawseti(L, pending, static_cast<lua_Integer>(count));
+        snapshotTable(pending + 1, tables, metatables, upvalues, pending);
+        lua_pop(L, 1);
+    }
+    ::lua_settop(L, upvalues);
+    ::lua_setfield(L, top + 1, "upvalues");
+    ::lua_setfield(L, top + 1, "metatables");
+    ::lua_setfield(L, top + 1, "tables");
+    mSnapshot.ref = ::luaL_ref(L, LUA_REGISTRYINDEX);
+
+    mSnapshot.funcDesc = mFuncDesc;
+    mSnapshot.ownedFuncDesc = mOwnedFuncDesc.size();
+    mSnapshot.userPtr = mUserPtr;
+    mSnapshot.bytecodeCache = mBytecodeCache;
+    mSnapshot.memoryLimit = mMemory.limit;
+    mSnapshot.gcConfig = mGcConfig;
+    mSnapshot.execLimit = mExecLimit;
+    mSnapshot.callStats = mCallStats.isEnabled();
+}
+
+bool LuaScript::isExecuting() const
+{
+    return mExecDepth != 0;
+}
+
+bool LuaScript::resetToSnapshot()
+{
+    if(mExecDepth != 0)
+        return false;
+    ::lua_settop(L, 0);
+    mRetValCount = 0;
+    if(mSnapshot.ref == LUA_NOREF)
+        return false;
+
+    ::lua_rawgeti(L, LUA_REGISTRYINDEX, mSnapshot.ref);
+    ::lua_getfield(L, 1, "tables");
+    ::lua_pushnil(L);
+    while(::lua_next(L, 2) != 0)
+    {
+        restoreTable(3, 4);
+        lua_pop(L, 1);
+    }
+
+    ::lua_getfield(L, 1, "metatables");
+    ::lua_pushnil(L);
+    while(::lua_next(L, 3) != 0)
+    {
+        if(!lua_istable(L, -1))
+        {
+            lua_pop(L, 1);
+            ::lua_pushnil(L);
+        }
+        ::lua_setmetatable(L, 4);
+    }
+
+    ::lua_getfield(L, 1, "upvalues");
+    ::lua_pushnil(L);
+    while(::lua_next(L, 4) != 0)
+    {
+        ::lua_getfield(L, 6, "n");
+        auto count = static_cast<int>(::lua_tointeger(L, -1));
+        lua_pop(L, 1);
+        for(int i = 1; i <= count; i++)
+        {
+            ::lua_rawgeti(L, 6, i);
+            if(::lua_setupvalue(L, 5, i) == nullptr)
+                lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+    }
+    ::lua_settop(L, 0);
+
+    mFuncDesc = mSnapshot.funcDesc;
+    while(mOwnedFuncDesc.size() > mSnapshot.ownedFuncDesc)
+        mOwnedFuncDesc.pop_back();
+    mUserPtr = mSnapshot.userPtr;
+    mBytecodeCache = mSnapshot.bytecodeCache;
+    stopProfiler();
+    mProfiler.reset();
+    mCallStats.reset();
+    mCallStats.setEnabled(mSnapshot.callStats);
+    mExecLimit = mSnapshot.execLimit;
+    mYieldResults = -1;
+    mMemory.limit = mSnapshot.memoryLimit;
+    setGcConfig(mSnapshot.gcConfig);
+    resetGcStats();
+
+    ::lua_gc(L, LUA_GCSTEP, 0);
+    resetPeakMemory();
+    return true;
+}
+
+void LuaScript::setMemoryLimit(std::size_t bytes)
+{
+    mMemory.limit = bytes;
+}
+
+const LuaMemoryStats& LuaScript::getMemoryStats() const
+{
+    return mMemory;
+}
+
+void LuaScript::resetPeakMemory()
+{
+    mMemory.peak = mMemory.current;
+}
+
+void LuaScript::setGcConfig(const LuaGcConfig& config)
+{
+    mGcConfig = config;
+    if(config.mode == LuaGcMode::GENERATIONAL)
+        ::lua_gc(L, LUA_GCGEN, config.minorMul, config.majorMul);
+    else
+        ::lua_gc(L, LUA_GCINC, config.pause, config.stepMul, config.stepSize);
+    ::lua_gc(L, config.automatic ? LUA_GCRESTART : LUA_GCSTOP);
+}
+
+const LuaGcConfig& LuaScript::getGcConfig() const
+{
+    return mGcConfig;
+}
+
+bool LuaScript::stepGc(int kbytes)
+{
+    return ::lua_gc(L, LUA_GCSTEP, kbytes) != 0;
+}
+
+void LuaScript::collectGarbage()
+{
+    ::lua_gc(L, LUA_GCCOLLECT);
+}
+
+const LuaGcStats& LuaScript::getGcStats() const
+{
+    return mGcStats;
+}
+
+void LuaScript::resetGcStats()
+{
+    mGcStats = {};
+}
+
+void LuaScript::setExecutionLimit(const LuaExecutionLimit& limit)
+{
+    mExecLimit = limit;
+    if(mExecLimit.checkInterval < 1)
+        mExecLimit.checkInterval = 1;
+}
+
+const LuaExecutionLimit& LuaScript::getExecutionLimit() const
+{
+    return mExecLimit;
+}
+
+void LuaScript::startProfiler(const LuaProfilerConfig& config)
+{
+    stopProfiler();
+    mProfiler = std::make_unique<LuaProfiler>(config);
+    mProfiling = true;
+    if(mExecDepth == 0)
+        return;
+    mProfiler->resume();
+    if(mProfiler->usesTimer())
+        mProfiledPrevious = mProfiler->enterThread(this, &LuaScript::requestSample);
+    else
+        setExecutionHook();
+}
+
+void LuaScript::stopProfiler()
+{
+    if(!mProfiling)
+        return;
+    mProfiling = false;
+    if(mExecDepth == 0)
+        return;
+    if(mProfiler->usesTimer())
+        LuaProfiler::leaveThread(mProfiledPrevious);
+    else
+        setExecutionHook();
+}
+
+bool LuaScript::isProfiling() const
+{
+    return mProfiling;
+}
+
+const LuaProfiler* LuaScript::getProfiler() const
+{
+    return mProfiler.get();
+}
+
+void LuaScript::setCallStatsEnabled(bool enabled)
+{
+    mCallStats.setEnabled(enabled);
+}
+
+bool LuaScript::isCallStatsEnabled() const
+{
+    return mCallStats.isEnabled();
+}
+
+std::vector<LuaFunctionStatsSnapshot> LuaScript::getCallStats() const
+{
+    return mCallStats.snapshot();
+}
+
+std::optional<LuaFunctionStatsSnapshot> LuaScript::getCallStats(std::string_view funcName) const
+{
+    return mCallStats.snapshot(funcName);
+}
+
+void LuaScript::resetCallStats()
+{
+    mCallStats.reset();
+}
+
 void LuaScript::resolveTable(LuaTable &table, int idx)
 {
 
@@ -363,9 +926,24 @@ void LuaScript::keyValueTable(LuaTable &table, int idx)
     while(::lua_next(L, idx - 1) != 0)
     {
         std::string_view key;
+        std::string numberKey;
         if(::lua_isstring(L, idx - 1))
         {
-            key = lua_tostring(L, idx - 1);
+            std::size_t len = 0;
+            if(::lua_type(L, idx - 1) == LUA_TSTRING)
+            {
+                const char* str = ::lua_tolstring(L, idx - 1, &len);
+                key = std::string_view(str, len);
+            }
+            else
+            {
+                // converting a number key in place would break lua_next, so it is converted on a copy
+                ::lua_pushvalue(L, idx - 1);
+                const char* str = ::lua_tolstring(L, -1, &len);
+                numberKey.assign(str, len);
+                lua_pop(L, 1);
+                key = numberKey;
+            }
             switch (const int type = ::lua_type(L, idx))
             {
             case LUA_TNUMBER:
@@ -380,7 +958,9 @@ void LuaScript::keyValueTable(LuaTable &table, int idx)
             }
             case LUA_TSTRING:
             {
-                table.addValue<std::string>(key, ::lua_tostring(L, idx));
+                std::size_t len = 0;
+                const char* str = ::lua_tolstring(L, idx, &len);
+                table.addValue<std::string>(key, std::string(str, len));
                 break;
             }
             case LUA_TTABLE:
@@ -392,9 +972,8 @@ void LuaScript::keyValueTable(LuaTable &table, int idx)
             default:
                 break;
             }
-
-            lua_pop(L, 1);
         }
+        lua_pop(L, 1);
     }
 }
 
@@ -420,7 +999,9 @@ void LuaScript::indexedTable(LuaTable &table, int idx, unsigned long long tableL
         }
         case LUA_TSTRING:
         {
-            table.addValue<std::string>(::lua_tostring(L, idx));
+            std::size_t len = 0;
+            const char* str = ::lua_tolstring(L, idx, &len);
+            table.addValue<std::string>(std::string(str, len));
             break;
         }
         case LUA_TTABLE:
@@ -437,9 +1018,351 @@ void LuaScript::indexedTable(LuaTable &table, int idx, unsigned long long tableL
     }
 }
 
+std::uint32_t LuaScript::flattenTable(LuaFlatTable& table, int idx, int visited, int depth)
+{
+    // every level holds a key, a value and the visited lookup on the stack
+    if(depth >= Lua_flat_max_depth || !::lua_checkstack(L, 4))
+        return UINT32_MAX;
+
+    auto arraySize = static_cast<std::uint32_t>(::lua_rawlen(L, idx));
+    std::uint32_t hashSize = 0;
+
+    ::lua_pushnil(L);
+    while(::lua_next(L, idx) != 0)
+    {
+        lua_pop(L, 1);
+        int isInt = 0;
+        int keyType = ::lua_type(L, -1);
+        auto key = ::lua_tointegerx(L, -1, &isInt);
+        if(keyType == LUA_TNUMBER && isInt && key >= 1 && key <= static_cast<lua_Integer>(arraySize))
+            continue;
+        if(keyType == LUA_TSTRING || keyType == LUA_TNUMBER || keyType == LUA_TBOOLEAN)
+            hashSize++;
+    }
+
+    auto id = table.addTable(arraySize, hashSize);
+    ::lua_pushvalue(L, idx);
+    ::lua_pushinteger(L, id);
+    ::lua_rawset(L, visited);
+
+    for(std::uint32_t i = 0; i < arraySize; i++)
+    {
+        LuaFlatValue value;
+        ::lua_rawgeti(L, idx, static_cast<lua_Integer>(i) + 1);
+        bool failed = !flattenValue(table, -1, visited, depth, value) && value.type == LuaFlatType::TABLE;
+        lua_pop(L, 1);
+        if(failed)
+            return UINT32_MAX;
+        table.setArrayValue(id, i, value);
+    }
+
+    std::uint32_t entry = 0;
+    ::lua_pushnil(L);
+    while(::lua_next(L, idx) != 0)
+    {
+        LuaFlatEntry flatEntry;
+        int isInt = 0;
+        auto key = ::lua_tointegerx(L, -2, &isInt);
+        bool inArray = ::lua_type(L, -2) == LUA_TNUMBER && isInt && key >= 1 && key <= static_cast<lua_Integer>(arraySize);
+        if(!inArray && ::lua_type(L, -2) != LUA_TTABLE && flattenValue(table, -2, visited, depth, flatEntry.key) && entry < hashSize)
+        {
+            if(!flattenValue(table, -1, visited, depth, flatEntry.value) && flatEntry.value.type == LuaFlatType::TABLE)
+            {
+                lua_pop(L, 2);
+                return UINT32_MAX;
+            }
+            table.setHashEntry(id, entry++, flatEntry);
+        }
+        lua_pop(L, 1);
+    }
+    table.shrinkHash(id, entry);
+    table.sortHash(id);
+    return id;
+}
+
+bool LuaScript::flattenValue(LuaFlatTable& table, int idx, int visited, int depth, LuaFlatValue& value)
+{
+    switch(::lua_type(L, idx))
+    {
+    case LUA_TNUMBER:
+        if(::lua_isinteger(L, idx))
+        {
+            value.type = LuaFlatType::INTEGER;
+            value.integer = ::lua_tointeger(L, idx);
+        }
+        else
+        {
+            value.type = LuaFlatType::NUMBER;
+            value.number = ::lua_tonumber(L, idx);
+        }
+        return true;
+    case LUA_TBOOLEAN:
+        value.type = LuaFlatType::BOOLEAN;
+        value.boolean = ::lua_toboolean(L, idx);
+        return true;
+    case LUA_TSTRING:
+    {
+        std::size_t len = 0;
+        const char* str = ::lua_tolstring(L, idx, &len);
+        value.type = LuaFlatType::STRING;
+        value.index = table.intern(std::string_view(str, len));
+        return true;
+    }
+    case LUA_TTABLE:
+    {
+        idx = ::lua_absindex(L, idx);
+        value.type = LuaFlatType::TABLE;
+        ::lua_pushvalue(L, idx);
+        if(::lua_rawget(L, visited) == LUA_TNUMBER)
+            value.index = static_cast<std::uint32_t>(::lua_tointeger(L, -1));
+        else
+            value.index = flattenTable(table, idx, visited, depth + 1);
+        lua_pop(L, 1);
+        // a table that could not be converted is reported as not stored, with its type left at TABLE
+        return value.index != UINT32_MAX;
+    }
+    default:
+        value.type = LuaFlatType::NIL;
+        return false;
+    }
+}
+
+static int luaPanic(lua_State* L)
+{
+    std::cerr << "PANIC: unprotected error in call to Lua API (" << LuaStack::errorMessage(L, -1) << ")" << std::endl;
+    return 0;
+}
+
+void LuaScript::initState(std::size_t libs)
+{
+    if(mAllocator)
+    {
+        L = ::lua_newstate(&LuaScript::allocate, this);
+        if(L != nullptr)
+            ::lua_atpanic(L, luaPanic);
+    }
+    else
+    {
+        // keep the panic and warning handlers of luaL_newstate, only route the memory through the accounting
+        L = ::luaL_newstate();
+        if(L != nullptr)
+        {
+            mMemory.current = static_cast<std::size_t>(::lua_gc(L, LUA_GCCOUNT)) * 1024 + static_cast<std::size_t>(::lua_gc(L, LUA_GCCOUNTB));
+            mMemory.peak = mMemory.current;
+            ::lua_setallocf(L, &LuaScript::allocate, this);
+        }
+    }
+    if(L == nullptr)
+        throw std::runtime_error("Failed to create lua state");
+    mMainState = L;
+    mSampleState = L;
+    ::lua_setgchook(L, &LuaScript::gcHook, this);
+    // coroutines resumed during a call take over the count hook, also those created before it
+    ::lua_sethookinherit(L, &LuaScript::executionHook);
+    *static_cast<LuaScript**>(lua_getextraspace(L)) = this;
+    openLibs(libs);
+}
+
+void* LuaScript::allocate(void* ud, void* ptr, std::size_t osize, std::size_t nsize)
+{
+    auto* self = static_cast<LuaScript*>(ud);
+    LuaMemoryStats& memory = self->mMemory;
+    // osize encodes the object type when ptr is nullptr
+    std::size_t oldSize = ptr != nullptr ? osize : 0;
+
+    if(nsize == 0)
+    {
+        if(ptr == nullptr)
+            return nullptr;
+        if(self->mAllocator)
+            self->mAllocator->reallocate(ptr, osize, 0);
+        else
+            std::free(ptr);
+        memory.current -= oldSize;
+        ++memory.frees;
+        return nullptr;
+    }
+
+    // only calls are limited, the host pushes values between them outside of a protected call where a
+    // memory error would end in the panic handler
+    if(memory.limit != 0 && self->mExecDepth > 0 && nsize > oldSize && memory.current - oldSize + nsize > memory.limit)
+    {
+        ++memory.failures;
+        return nullptr;
+    }
+
+    void* block = self->mAllocator ? self->mAllocator->reallocate(ptr, osize, nsize) : std::realloc(ptr, nsize);
+    if(block == nullptr)
+    {
+        ++memory.failures;
+        return nullptr;
+    }
+
+    memory.current = memory.current - oldSize + nsize;
+    if(memory.current > memory.peak)
+        memory.peak = memory.current;
+    if(ptr == nullptr)
+        ++memory.allocations;
+    else
+        ++memory.reallocations;
+    return block;
+}
+
+void LuaScript::gcHook(void* ud, int event, int done)
+{
+    auto* self = static_cast<LuaScript*>(ud);
+    if(!done)
+    {
+        if(self->mGcDepth++ == 0)
+            self->mGcStart = std::chrono::steady_clock::now();
+        return;
+    }
+    // an end without a begin belongs to a step whose depth was restored by endExecution
+    if(self->mGcDepth == 0 || --self->mGcDepth != 0)
+        return;
+
+    auto end = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - self->mGcStart);
+    if(LuaTracer::isEnabled())
+        LuaTracer::record(LuaTraceCategory::GC, event == LUA_GCHOOKFULL ? "full gc" : "gc step", self->mGcStart, end);
+    LuaGcStats& stats = self->mGcStats;
+    if(event == LUA_GCHOOKFULL)
+        ++stats.fullCollections;
+    else
+        ++stats.steps;
+    stats.time += elapsed;
+    if(elapsed > stats.maxPause)
+        stats.maxPause = elapsed;
+}
+
+int LuaScript::beginExecution()
+{
+    if(mExecDepth++ != 0)
+        return mGcDepth;
+    mExecExceeded = false;
+    mYieldResults = -1;
+    bool hookSampling = false;
+    if(mProfiling)
+    {
+        mProfiler->resume();
+        hookSampling = !mProfiler->usesTimer();
+    }
+
+    if(mExecLimit.isLimited() || hookSampling)
+    {
+        mExecInstructions = 0;
+        if(mExecLimit.timeout != std::chrono::nanoseconds::zero())
+            mExecDeadline = std::chrono::steady_clock::now() + mExecLimit.timeout;
+        setExecutionHook();
+    }
+    if(mProfiling && !hookSampling)
+        mProfiledPrevious = mProfiler->enterThread(this, &LuaScript::requestSample);
+    return mGcDepth;
+}
+
+void LuaScript::endExecution(int gcDepth)
+{
+    // a collector step never outlasts the call it started in, a step that was unwound by an error left its depth behind
+    mGcDepth = gcDepth;
+    if(--mExecDepth != 0)
+        return;
+    if(mProfiling)
+    {
+        mProfiler->pause();
+        if(mProfiler->usesTimer())
+            LuaProfiler::leaveThread(mProfiledPrevious);
+    }
+    // a sample requested at the end of the call left its hook armed
+    bool requested = mSampleRequested.exchange(false, std::memory_order_relaxed);
+    if(mExecHookCount == 0 && !requested)
+        return;
+    ::lua_sethook(mMainState, nullptr, 0, 0);
+    if(L != mMainState)
+        ::lua_sethook(L, nullptr, 0, 0);
+    mExecHookCount = 0;
+}
+
+void LuaScript::setExecutionHook()
+{
+    // the budget and the hook sampling profiler share the count hook, it fires at the shorter of their intervals
+    int count = 0;
+    if(mExecLimit.isLimited())
+    {
+        count = mExecLimit.checkInterval;
+        if(mExecLimit.instructions != 0 && mExecLimit.instructions < static_cast<std::uint64_t>(count))
+            count = static_cast<int>(mExecLimit.instructions);
+    }
+    if(mProfiling && !mProfiler->usesTimer() && (count == 0 || mProfiler->getConfig().checkInterval < count))
+        count = mProfiler->getConfig().checkInterval;
+
+    mExecHookCount = count;
+    // the main thread passes the hook on to the coroutines it resumes, the running thread takes it right away
+    for(lua_State* state : {mMainState, L})
+    {
+        if(count != 0)
+            ::lua_sethook(state, &LuaScript::executionHook, LUA_MASKCOUNT, count);
+        else
+            ::lua_sethook(state, nullptr, 0, 0);
+    }
+}
+
+void LuaScript::requestSample(void* owner)
+{
+    // runs in the SIGPROF handler, lua_sethook may be called asynchronously, L is swapped by the calls
+    auto* self = static_cast<LuaScript*>(owner);
+    self->mSampleRequested.store(true, std::memory_order_relaxed);
+    ::lua_sethook(self->mSampleState.load(std::memory_order_relaxed), &LuaScript::executionHook, LUA_MASKCOUNT, 1);
+}
+
+void LuaScript::executionHook(lua_State* state, lua_Debug*)
+{
+    auto* self = *static_cast<LuaScript**>(lua_getextraspace(state));
+    if(self->mSampleRequested.exchange(false, std::memory_order_relaxed))
+    {
+        // armed by the sample timer for the next instruction, the budget did not advance
+        if(self->mProfiling)
+            self->mProfiler->sample(state);
+        if(!self->mExecExceeded)
+        {
+            self->setExecutionHook();
+            return;
+        }
+    }
+    else if(self->mProfiling && !self->mProfiler->usesTimer())
+        self->mProfiler->check(state);
+    if(!self->mExecLimit.isLimited())
+        return;
+    if(!self->mExecExceeded)
+    {
+        self->mExecInstructions += static_cast<std::uint64_t>(self->mExecHookCount);
+        const LuaExecutionLimit& limit = self->mExecLimit;
+        if(limit.instructions != 0 && self->mExecInstructions >= limit.instructions)
+            self->mExecExceeded = true;
+        else if(limit.timeout != std::chrono::nanoseconds::zero() && std::chrono::steady_clock::now() >= self->mExecDeadline)
+            self->mExecExceeded = true;
+        else
+            return;
+    }
+    // check every instruction from now on, so a script catching the error with pcall or coroutine.resume is stopped on its next instruction
+    ::lua_sethook(state, &LuaScript::executionHook, LUA_MASKCOUNT, 1);
+    if(state != self->mMainState)
+        ::lua_sethook(self->mMainState, &LuaScript::executionHook, LUA_MASKCOUNT, 1);
+    ::luaL_error(state, "execution budget exceeded");
+}
+
+FuncInfoType LuaScript::errorType(int status, FuncInfoType fallback) const
+{
+    if(status == LUA_ERRMEM)
+        return FuncInfoType::MEMORY;
+    if(mExecExceeded)
+        return FuncInfoType::TIMEOUT;
+    return fallback;
+}
+
 void LuaScript::openLibs(std::size_t libs)
 {
-    ::luaopen_base(L);
+    ::luaL_requiref(L, LUA_GNAME, ::luaopen_base, 1);
+    lua_pop(L, 1);
     if (libs & ::Lua_lib_package)
         ::luaL_requiref(L, "package", ::luaopen_package, 1);
     if (libs & ::Lua_lib_table)
@@ -458,6 +1381,7 @@ void LuaScript::openLibs(std::size_t libs)
         ::luaL_requiref(L, "os", ::luaopen_os, 1);
     if (libs & ::Lua_lib_utf8)
         ::luaL_requiref(L, "utf8", ::luaopen_utf8, 1);
+    lua_settop(L, 0);
 }
 
 void LuaScript::resolveArgs(std::vector<LuaDescValue>& args)
@@ -482,7 +1406,8 @@ void LuaScript::resolveArgs(std::vector<LuaDescValue>& args)
         }
         if(arg.hasType<std::string>() && arg.hasValue())
         {
-            ::lua_pushstring(L,  arg.retrieve<std::string>().data());
+            auto const& str = arg.retrieve<std::string>();
+            ::lua_pushlstring(L, str.data(), str.size());
             continue;
         }
         if(arg.hasType<LuaTable>() && arg.hasValue())
@@ -520,7 +1445,9 @@ void LuaScript::resolveRets(std::vector<LuaDescValueR> &retVals)
         {
             if(!::lua_isstring(L, -static_cast<int>(index)))
                 throw std::invalid_argument("Failed to get return value. Expected was string'");
-            *retVal.retrieve<std::string*>() = lua_tostring(L, -index);
+            std::size_t len = 0;
+            const char* str = ::lua_tolstring(L, -static_cast<int>(index), &len);
+            retVal.retrieve<std::string*>()->assign(str, len);
         }
         else if(retVal.hasType<LuaTable*>() && retVal.hasValue())
         {
@@ -531,3 +1458,157 @@ void LuaScript::resolveRets(std::vector<LuaDescValueR> &retVals)
         index--;
     }
 }
+
+FuncInfo LuaScript::callFunc(FuncDescription& funcDesc, std::string_view funcName, LuaFunctionStats* stats)
+{
+    using enum FuncInfoType;
+    std::vector<LuaDescValue>& args = funcDesc.getArgs();
+    std::vector<LuaDescValueR>& retVals = funcDesc.getRetVals();
+
+    resolveArgs(args);
+
+    CallTiming timing(measuredStats(stats));
+    int gcDepth = beginExecution();
+    int status = lua_pcall(L, static_cast<int>(args.size()), static_cast<int>(retVals.size()), 0);
+    endExecution(gcDepth);
+    timing.finish(LuaTraceCategory::SCRIPT, funcName, status != LUA_OK);
+    if(mGcConfig.stepBudget > 0)
+        stepGc(mGcConfig.stepBudget);
+    if(status != LUA_OK)
+    {
+        std::string errmsg;
+        errmsg.append("Failed to run function[").append(funcName).append("] - ").append(LuaStack::errorMessage(L, -1));
+        lua_pop(L, 1);
+        return FuncInfo(errmsg, errorType(status, RUN));
+    }
+
+    resolveRets(retVals);
+
+    lua_pop(L, static_cast<int>(retVals.size()));
+
+    return FuncInfo(OK);
+}
+
+void LuaScript::snapshotTable(int table, int tables, int metatables, int upvalues, int pending)
+{
+    // a table reachable twice, e.g. _G._G, is recorded once
+    ::lua_pushvalue(L, table);
+    bool recorded = ::lua_rawget(L, tables) != LUA_TNIL;
+    lua_pop(L, 1);
+    if(recorded)
+        return;
+
+    ::lua_pushvalue(L, table);
+    lua_newtable(L);
+    ::lua_pushnil(L);
+    while(::lua_next(L, table) != 0)
+    {
+        if(::lua_type(L, -1) == LUA_TFUNCTION)
+            snapshotUpvalues(::lua_absindex(L, -1), tables, upvalues, pending);
+        pendTable(-1, tables, pending);
+        pendTable(-2, tables, pending);
+        ::lua_pushvalue(L, -2);
+        lua_insert(L, -2);
+        ::lua_rawset(L, -4);
+    }
+    ::lua_rawset(L, tables);
+
+    ::lua_pushvalue(L, table);
+    if(::lua_getmetatable(L, table))
+        pendTable(-1, tables, pending);
+    else
+        ::lua_pushboolean(L, 0);
+    ::lua_rawset(L, metatables);
+}
+
+void LuaScript::pendTable(int index, int tables, int pending)
+{
+    if(!lua_istable(L, index))
+        return;
+    ::lua_pushvalue(L, index);
+    bool recorded = ::lua_rawget(L, tables) != LUA_TNIL;
+    if(recorded)
+    {
+        lua_pop(L, 1);
+        return;
+    }
+    lua_pop(L, 1);
+    ::lua_pushvalue(L, index);
+    ::lua_rawseti(L, pending, static_cast<lua_Integer>(::lua_rawlen(L, pending)) + 1);
+}
+
+void LuaScript::snapshotUpvalues(int func, int tables, int upvalues, int pending)
+{
+    // upvalues of C functions, e.g. the bound natives, are owned by the host
+    if(::lua_iscfunction(L, func))
+        return;
+    ::lua_pushvalue(L, func);
+    bool recorded = ::lua_rawget(L, upvalues) != LUA_TNIL;
+    lua_pop(L, 1);
+    if(recorded)
+        return;
+
+    ::lua_pushvalue(L, func);
+    lua_newtable(L);
+    int count = 0;
+    while(::lua_getupvalue(L, func, count + 1) != nullptr)
+    {
+        pendTable(-1, tables, pending);
+        ::lua_rawseti(L, -2, ++count);
+    }
+    ::lua_pushinteger(L, count);
+    ::lua_setfield(L, -2, "n");
+    ::lua_rawset(L, upvalues);
+}
+
+void LuaScript::restoreTable(int target, int snapshot)
+{
+    ::lua_pushnil(L);
+    while(::lua_next(L, target) != 0)
+    {
+        lua_pop(L, 1);
+        ::lua_pushvalue(L, -1);
+        if(::lua_rawget(L, snapshot) == LUA_TNIL)
+        {
+            ::lua_pushvalue(L, -2);
+            ::lua_pushnil(L);
+            ::lua_rawset(L, target);
+        }
+        lua_pop(L, 1);
+    }
+
+    ::lua_pushnil(L);
+    while(::lua_next(L, snapshot) != 0)
+    {
+        ::lua_pushvalue(L, -2);
+        lua_insert(L, -2);
+        ::lua_rawset(L, target);
+    }
+}
+
+FuncInfo LuaScript::checkFuncName(std::string_view funcName)
+{
+    std::string name(funcName);
+    ::lua_getglobal(L, name.c_str());
+    bool isFunction = lua_isfunction(L, -1);
+    lua_pop(L, 1);
+    if(!mFuncDesc.contains(funcName) && !isFunction)
+        return FuncInfo(FuncInfoType::OK);
+
+    std::string errmsg;
+    errmsg.append("Failed to register function[").append(funcName).append("] - Function name is already registred!");
+    return FuncInfo(errmsg, FuncInfoType::REGISTER);
+}
+
+std::pair<const std::string, LuaScript::RegisteredFunc>& LuaScript::addFunc(std::string_view funcName, FuncDescription* funcDesc, LuaFunctionKind kind)
+{
+    return *mFuncDesc.try_emplace(std::string(funcName), RegisteredFunc{funcDesc, mCallStats.add(funcName, kind)}).first;
+}
+
+LuaFunctionStats* LuaScript::measuredStats(LuaFunctionStats* stats) const
+{
+    // a native called through doFunc or call records itself
+    if(stats == nullptr || stats->getKind() != LuaFunctionKind::SCRIPT || !stats->isEnabled())
+        return nullptr;
+    return stats;
+}
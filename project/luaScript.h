@@ -9,9 +9,38 @@
 #include <functional>
 #include <filesystem>
 #include <cstring>
+#include <cstddef>
+#include <cstdlib>
+#include <climits>
+#include <algorithm>
+#include <deque>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <stdexcept>
+#include <new>
+#include <type_traits>
 
 #include "funcDesc.h"
-#include "lambda.h"
+#include "luaFunctionRef.h"
+#include "luaPinnedString.h"
+#include "luaFlatTable.h"
+#include "luaSharedData.h"
+#include "luaTableView.h"
+#include "luaTask.h"
+#include "bytecodeCache.h"
+#include "luaAllocator.h"
+#include "luaGcConfig.h"
+#include "luaExecutionLimit.h"
+#include "luaProfiler.h"
+#include "luaCallStats.h"
+#include "luaTracer.h"
+#include "luaStack.h"
+#include "luaBind.h"
 #include "luaTable.h"
 #include "util.h"
 #include "funcInfo.h"
@@ -29,6 +58,8 @@ constexpr std::size_t Lua_lib_all         = ::Lua_lib_package | ::Lua_lib_table
                                                 ::Lua_lib_debug | ::Lua_lib_io | ::Lua_lib_coroutine | ::Lua_lib_os |
                                                 ::Lua_lib_utf8;
 
+constexpr int Lua_flat_max_depth          = 200; /**< Deepest table nesting getFlatTable converts. */
+
 /**
  * @class LuaScript
  * @brief A class for managing Lua scripts and function interactions.
@@ -36,11 +67,62 @@ constexpr std::size_t Lua_lib_all         = ::Lua_lib_package | ::Lua_lib_table
 class LuaScript 
 {
 private:
-    std::unordered_map<std::string, void*, TransparentHash, TransparentEqual> mUserPtr = {}; /**< Map of user data pointers. */
-    std::unordered_map<std::string, FuncDescription*, TransparentHash, TransparentEqual> mFuncDesc = {}; /**< Map of function descriptions. */
+    /**
+     * @brief A registered function.
+     */
+    struct RegisteredFunc
+    {
+        FuncDescription* desc = nullptr; /**< Function description. */
+        LuaFunctionStats* stats = nullptr; /**< Call statistics. */
+    };
+
+    using FuncMap = std::unordered_map<std::string, RegisteredFunc, TransparentHash, TransparentEqual>;
+    using UserPtrMap = std::unordered_map<std::string, void*, TransparentHash, TransparentEqual>;
+
+    /**
+     * @brief Baseline recorded by takeSnapshot and restored by resetToSnapshot.
+     */
+    struct Snapshot
+    {
+        int ref = LUA_NOREF; /**< Registry reference of the recorded tables, metatables and upvalues. */
+        FuncMap funcDesc = {}; /**< Registered functions. */
+        std::size_t ownedFuncDesc = 0; /**< Number of owned function descriptions. */
+        UserPtrMap userPtr = {}; /**< User data pointers. */
+        std::optional<BytecodeCache> bytecodeCache = std::nullopt; /**< Bytecode cache used by compile. */
+        std::size_t memoryLimit = 0; /**< Memory limit. */
+        LuaGcConfig gcConfig = {}; /**< Garbage collector settings. */
+        LuaExecutionLimit execLimit = {}; /**< Budget of a single call. */
+        bool callStats = false; /**< Set if call statistics were recorded. */
+    };
+
+    UserPtrMap mUserPtr = {}; /**< Map of user data pointers. */
+    FuncMap mFuncDesc = {}; /**< Map of function descriptions. */
+    std::deque<FuncDescription> mOwnedFuncDesc = {}; /**< Copies of function descriptions registered by const reference. */
     lua_State* L = nullptr; /**< Lua state instance. */
+    lua_State* mMainState = nullptr; /**< Main thread of the Lua state, L is the running thread during calls. */
     std::filesystem::path mPath = ""; /**< Path to the Lua script. */
     int mRetValCount = 0; /**< Return value count for Lua function calls. */
+    std::optional<BytecodeCache> mBytecodeCache = std::nullopt; /**< Bytecode cache used by compile. */
+    Snapshot mSnapshot = {}; /**< Baseline of resetToSnapshot. */
+    std::shared_ptr<LuaAllocator> mAllocator = nullptr; /**< Allocator of the Lua state, nullptr for the system allocator. */
+    LuaMemoryStats mMemory = {}; /**< Memory accounting of the Lua state. */
+    LuaGcConfig mGcConfig = {}; /**< Garbage collector settings. */
+    LuaGcStats mGcStats = {}; /**< Time spent in the garbage collector. */
+    std::chrono::steady_clock::time_point mGcStart = {}; /**< Start of the running collector step. */
+    int mGcDepth = 0; /**< Nesting depth of collector steps. */
+    LuaExecutionLimit mExecLimit = {}; /**< Budget of a single call. */
+    std::chrono::steady_clock::time_point mExecDeadline = {}; /**< Deadline of the running call. */
+    std::uint64_t mExecInstructions = 0; /**< VM instructions executed by the running call. */
+    int mExecHookCount = 0; /**< VM instructions between two budget checks of the running call. */
+    int mExecDepth = 0; /**< Nesting depth of budgeted calls. */
+    bool mExecExceeded = false; /**< Set once the running call exceeded its budget. */
+    std::unique_ptr<LuaProfiler> mProfiler = nullptr; /**< Profile of the last startProfiler, nullptr if never started. */
+    bool mProfiling = false; /**< Set while the profiler samples. */
+    std::atomic<bool> mSampleRequested = false; /**< Set by the sample timer until the hook took the sample. */
+    std::atomic<lua_State*> mSampleState = nullptr; /**< Thread the sample timer arms, the main thread or the resumed task. */
+    void* mProfiledPrevious = nullptr; /**< State that was profiled on this thread before the running call. */
+    int mYieldResults = -1; /**< Values to yield when the running registered function returns, -1 for no yield. */
+    LuaCallStats mCallStats = {}; /**< Call statistics of the registered functions. */
 
 public:
     /**
@@ -67,11 +149,29 @@ public:
      */
     explicit LuaScript(const std::filesystem::path& path, std::size_t libs);
 
+    /**
+     * @brief Constructor with an allocator for the Lua state and bitmask libraries to open.
+     * @param allocator Allocator that serves all memory of the Lua state. It is kept alive by the script.
+     * @param libs Bitmask to open the lua libraries.
+     */
+    explicit LuaScript(std::shared_ptr<LuaAllocator> allocator, std::size_t libs = ::Lua_lib_all);
+
+    /**
+     * @brief Constructor with script path, an allocator for the Lua state and bitmask libraries to open.
+     * @param path Path to the Lua script file.
+     * @param allocator Allocator that serves all memory of the Lua state. It is kept alive by the script.
+     * @param libs Bitmask to open the lua libraries.
+     */
+    LuaScript(const std::filesystem::path& path, std::shared_ptr<LuaAllocator> allocator, std::size_t libs = ::Lua_lib_all);
+
     /**
      * @brief Destructor. Closes the Lua state.
      */
     ~LuaScript();
 
+    LuaScript(const LuaScript&) = delete;
+    LuaScript& operator=(const LuaScript&) = delete;
+
     /**
      * @brief Registers a Lua function with the given name and optional function description.
      * @param funcName Name of the Lua function.
@@ -83,37 +183,291 @@ public:
     using LuaScriptFunc = int(*)(LuaScript&);
     /**
      * @brief Registers a C++ function as a Lua function with the given name and optional function description.
-     * @param func C++ function to register.
+     * The callable is moved into a full userdata and bound together with this script as upvalues of a C closure,
+     * so every registration keeps its own target. The callable runs in a protected call, Lua errors it raises and
+     * C++ exceptions are raised to the script once the state of this object is restored. Suspend a task with yield,
+     * not with lua_yield.
+     * @param func C++ function to register. Any callable with the signature int(LuaScript&).
      * @param funcName Name of the Lua function.
      * @param funcDesc Function description (optional).
      */
     template<typename LuaCFunc = LuaScriptFunc>
-    FuncInfo regFunc(LuaCFunc func, std::string_view funcName, const FuncDescription& funcDesc = FuncDescription());
+        requires std::is_invocable_r_v<int, std::decay_t<LuaCFunc>&, LuaScript&>
+    FuncInfo regFunc(LuaCFunc&& func, std::string_view funcName, const FuncDescription& funcDesc = FuncDescription())
+    {
+        auto info = checkFuncName(funcName);
+        if(!info)
+            return info;
+
+        auto& registered = addFunc(funcName, &mOwnedFuncDesc.emplace_back(funcDesc), LuaFunctionKind::NATIVE);
+        pushClosure(std::forward<LuaCFunc>(func), registered.second.stats);
+        ::lua_setglobal(L, registered.first.c_str());
+        return info;
+    }
+
+    /**
+     * @brief Registers any C++ callable as a Lua function. Arguments are read from the Lua stack and results are
+     * pushed back by compile time dispatch on the callable's signature, e.g. double(int, std::string_view).
+     * Besides the types of LuaStack, arguments may be std::optional (nil for no value) or std::span of numbers and
+     * results may be std::tuple for multiple return values. Arguments of the wrong type raise a Lua error.
+     * @param func C++ callable to register. Its call operator must not be overloaded or templated.
+     * @param funcName Name of the Lua function.
+     * @param funcDesc Function description (optional).
+     */
+    template<typename Func>
+        requires (!std::is_invocable_r_v<int, std::decay_t<Func>&, LuaScript&>)
+    FuncInfo regFunc(Func&& func, std::string_view funcName, const FuncDescription& funcDesc = FuncDescription())
+    {
+        auto info = checkFuncName(funcName);
+        if(!info)
+            return info;
+
+        auto& registered = addFunc(funcName, &mOwnedFuncDesc.emplace_back(funcDesc), LuaFunctionKind::NATIVE);
+        pushMeasuredFunction(std::forward<Func>(func), registered.second.stats);
+        ::lua_setglobal(L, registered.first.c_str());
+        return info;
+    }
+
+    /**
+     * @brief Registers a member function of the given object as a Lua function with automatic marshalling.
+     * @param method Member function to register.
+     * @param object Object the member function is called on. It must outlive the Lua state.
+     * @param funcName Name of the Lua function.
+     * @param funcDesc Function description (optional).
+     */
+    template<typename Ret, typename Class, typename... Args>
+    FuncInfo regFunc(Ret (Class::*method)(Args...), Class* object, std::string_view funcName, const FuncDescription& funcDesc = FuncDescription())
+    {
+        return regFunc([object, method](Args... args) -> Ret { return (object->*method)(std::forward<Args>(args)...); }, funcName, funcDesc);
+    }
+
+    template<typename Ret, typename Class, typename... Args>
+    FuncInfo regFunc(Ret (Class::*method)(Args...) const, const Class* object, std::string_view funcName, const FuncDescription& funcDesc = FuncDescription())
+    {
+        return regFunc([object, method](Args... args) -> Ret { return (object->*method)(std::forward<Args>(args)...); }, funcName, funcDesc);
+    }
 
     /**
      * @brief Compiles and executes the Lua script loaded from the specified file path.
      */
     FuncInfo compile();
 
+    /**
+     * @brief Enables the bytecode cache for compile. Precompiled chunks are stored in and loaded from the given directory.
+     * @param cacheDir Directory that holds the cached chunks.
+     */
+    void setBytecodeCache(const std::filesystem::path& cacheDir);
+
+    /**
+     * @brief Disables the bytecode cache. compile loads the script source again.
+     */
+    void clearBytecodeCache();
+
     /**
      * @brief Compiles and executes the given Lua code string.
      * @param luaCode Lua code string to compile and execute.
      */
     FuncInfo compileString(std::string_view luaCode);
 
+    /**
+     * @brief Compiles and executes the given Lua code string or precompiled chunk.
+     * @param luaCode Lua code string or bytecode to compile and execute.
+     * @param chunkName Name of the chunk in error messages and tracebacks, e.g. "@file.lua" or "=name".
+     */
+    FuncInfo compileString(std::string_view luaCode, std::string_view chunkName);
+
     /**
      * @brief Calls a Lua function with the given name.
      * @param funcName Name of the Lua function to call.
      */
     FuncInfo doFunc(std::string_view funcName);
 
+    /**
+     * @brief Resolves a registered Lua function once and returns a reusable handle to it.
+     * @param funcName Name of the registered Lua function.
+     * @return Handle to the Lua function. The handle is invalid if the function is not registered or not defined.
+     */
+    LuaFunctionRef prepare(std::string_view funcName);
+
+    /**
+     * @brief Calls a prepared Lua function without looking up its name or description.
+     * @param funcRef Handle returned by prepare.
+     */
+    FuncInfo doFunc(const LuaFunctionRef& funcRef);
+
+    /**
+     * @brief Calls a prepared Lua function with typed arguments and return values.
+     * Arguments are pushed and results are read by compile time dispatch on the C++ types, without a FuncDescription.
+     * @tparam R Types of the return values.
+     * @tparam Args Types of the arguments.
+     * @param funcRef Handle returned by prepare.
+     * @param args Arguments passed to the Lua function.
+     * @return The return values of the Lua function.
+     * @throws std::runtime_error if the reference is invalid, the stack can not grow or the Lua function raised an error.
+     * @throws std::invalid_argument if a return value does not have the expected type.
+     */
+    template<typename... R, typename... Args>
+    std::tuple<R...> call(const LuaFunctionRef& funcRef, Args&&... args)
+    {
+        static_assert((!std::is_same_v<LuaStack::Plain<R>, std::string_view> && ...), "Return values are popped, use std::string instead of std::string_view");
+        if(!funcRef)
+        {
+            std::string errmsg;
+            errmsg.append("Failed to run function[").append(funcRef.getName()).append("] - invalid function reference");
+            throw std::runtime_error(errmsg);
+        }
+
+        constexpr int nresults = static_cast<int>(sizeof...(R));
+        if(!::lua_checkstack(L, std::max(2, nresults)))
+        {
+            std::string errmsg;
+            errmsg.append("Failed to run function[").append(funcRef.getName()).append("] - stack overflow");
+            throw std::runtime_error(errmsg);
+        }
+
+        // pushing the arguments can raise a Lua error, they are pushed in a protected call before the execution
+        // starts, so they are not refused by the memory limit
+        constexpr int nargs = (LuaStack::count<Args>() + ... + 0);
+        PushedCall<std::remove_reference_t<Args>...> pushed{&funcRef, {args...}};
+        ::lua_pushcfunction(L, &pushCall<std::remove_reference_t<Args>...>);
+        ::lua_pushlightuserdata(L, &pushed);
+        if(lua_pcall(L, 1, nargs + 1, 0) != LUA_OK)
+        {
+            std::string errmsg;
+            errmsg.append("Failed to run function[").append(funcRef.getName()).append("] - ").append(LuaStack::errorMessage(L, -1));
+            lua_pop(L, 1);
+            throw std::runtime_error(errmsg);
+        }
+
+        CallTiming timing(measuredStats(funcRef.getStats()));
+        int gcDepth = beginExecution();
+        int status = lua_pcall(L, nargs, nresults, 0);
+        endExecution(gcDepth);
+        timing.finish(LuaTraceCategory::SCRIPT, funcRef.getName(), status != LUA_OK);
+        if(mGcConfig.stepBudget > 0)
+            stepGc(mGcConfig.stepBudget);
+        if(status != LUA_OK)
+        {
+            std::string errmsg;
+            errmsg.append("Failed to run function[").append(funcRef.getName()).append("] - ").append(LuaStack::errorMessage(L, -1));
+            lua_pop(L, 1);
+            throw std::runtime_error(errmsg);
+        }
+        return popRets<R...>(std::index_sequence_for<R...>{});
+    }
+
+    /**
+     * @brief Calls a prepared Lua function once per argument tuple and stores one return value per call.
+     * All calls run inside a single protected call with the function kept on the stack, so the cost per item
+     * is the argument pushes and the call itself. Results that allocate when copied, e.g. strings, get a
+     * protected call per item and are copied after it returned. The execution limit and the gc step budget
+     * apply to the batch as a whole.
+     * @tparam R Type of the return value.
+     * @tparam Tuple std::tuple with the argument types, possibly const.
+     * @param funcRef Handle returned by prepare.
+     * @param args Arguments of every call, e.g. `std::span(inputs)`.
+     * @param results Receives the return value of every call. Must be at least as large as args.
+     * @return OK if every call succeeded. On error the results of the calls before the failing one are valid.
+     */
+    template<typename R, typename Tuple>
+    FuncInfo callBatch(const LuaFunctionRef& funcRef, std::span<Tuple> args, std::span<R> results)
+    {
+        static_assert(!std::is_same_v<LuaStack::Plain<R>, std::string_view>, "Return values are popped, use std::string instead of std::string_view");
+        if(results.size() < args.size())
+        {
+            std::string errmsg;
+            errmsg.append("Failed to run function[").append(funcRef.getName()).append("] - result span is smaller than the argument span");
+            return FuncInfo(errmsg, FuncInfoType::RUN);
+        }
+        BatchCall<std::remove_const_t<Tuple>, R> batch{{}, args, results.data()};
+        batch.size = args.size();
+        if constexpr (collectsBatch<R>)
+            batch.collect = &collectBatch<std::remove_const_t<Tuple>, R>;
+        return runBatch(funcRef, &invokeBatch<std::remove_const_t<Tuple>, R>, batch);
+    }
+
+    /**
+     * @brief Calls a prepared Lua function once per argument tuple, discarding return values.
+     * @tparam Tuple std::tuple with the argument types, possibly const.
+     * @param funcRef Handle returned by prepare.
+     * @param args Arguments of every call, e.g. `std::span(inputs)`.
+     * @return OK if every call succeeded.
+     */
+    template<typename Tuple>
+    FuncInfo callBatch(const LuaFunctionRef& funcRef, std::span<Tuple> args)
+    {
+        BatchCall<std::remove_const_t<Tuple>, void> batch{{}, args, nullptr};
+        batch.size = args.size();
+        return runBatch(funcRef, &invokeBatch<std::remove_const_t<Tuple>, void>, batch);
+    }
+
+    /**
+     * @brief Creates a task that runs a global Lua function in its own coroutine.
+     * @param funcName Name of the global Lua function.
+     * @return The task. It is invalid if the global is not a function.
+     */
+    LuaTask createTask(std::string_view funcName);
+
+    /**
+     * @brief Creates a task that runs a prepared Lua function in its own coroutine.
+     * @param funcRef Handle returned by prepare.
+     * @return The task. It is invalid if the reference is invalid.
+     */
+    LuaTask createTask(const LuaFunctionRef& funcRef);
+
+    /**
+     * @brief Starts or continues a task with typed arguments.
+     * The first resume passes the arguments to the function, later resumes pass them as results of the yield.
+     * @tparam Args Types of the arguments.
+     * @param task Task to resume.
+     * @param args Arguments.
+     * @return OK if the task yielded or returned, see LuaTask::getStatus. The values it yielded or returned
+     * are on top of the stack of the task thread.
+     */
+    template<typename... Args>
+    FuncInfo resume(LuaTask& task, const Args&... args)
+    {
+        if(task.isResumable())
+        {
+            task.clearResults();
+            (LuaStack::push(task.getThread(), args), ...);
+        }
+        return resumeTask(task, static_cast<int>(sizeof...(Args)));
+    }
+
+    /**
+     * @brief Starts or continues a task with arguments already pushed onto the stack of the task thread.
+     * @param task Task to resume.
+     * @param nargs Number of arguments on top of the stack of the task thread.
+     * @return OK if the task yielded or returned, see LuaTask::getStatus.
+     */
+    FuncInfo resumeTask(LuaTask& task, int nargs);
+
+    /**
+     * @brief Suspends the task that called the running registered function once the function returns.
+     * Use as return statement of a registered function: `return lua.yield(1);`. Callables registered with
+     * their C++ signature yield their results instead of nresults. Calling it outside of a task raises a Lua error,
+     * a request left by a function that raised an error or by host code is dropped.
+     * @param nresults Number of values on top of the stack passed to the resumer.
+     * @return nresults.
+     */
+    int yield(int nresults = 0);
+
     /**
      * @brief Converts a Lua value at the specified index to a string.
      * @param index Index of the Lua value on the stack.
-     * @return Converted string value.
+     * @return Converted string value. The view is valid as long as the Lua value stays on the stack.
      */
     std::string_view toString(int index);
 
+    /**
+     * @brief Exposes the Lua string at the specified index without copying it.
+     * The returned guard keeps the string alive, so the view stays valid after the value left the stack.
+     * @param index Index of the Lua string on the stack.
+     * @return Guard holding a view of the string. The guard is empty if the value is not a string.
+     */
+    LuaPinnedString pinString(int index);
+
     /**
      * @brief Converts a Lua value at the specified index to an integer.
      * @param index Index of the Lua value on the stack.
@@ -166,15 +520,225 @@ public:
     int getRetValCount();
 
     void pushTable(LuaTable& table, long long idx = 1);
+
+    /**
+     * @brief Pushes an array of numbers as a new table onto the Lua stack.
+     * The table is sized once and its array part is filled in bulk.
+     * @param values Values stored at the keys 1..n.
+     * @return False without pushing anything if values holds more than INT_MAX values.
+     */
+    bool pushArray(std::span<const double> values);
+    bool pushArray(std::span<const long long> values);
+
+    /**
+     * @brief Stores an array of numbers as a new global table.
+     * @param name Name of the global Lua table.
+     * @param values Values stored at the keys 1..n.
+     * @return False without storing anything if values holds more than INT_MAX values.
+     */
+    bool pushArray(std::string_view name, std::span<const double> values);
+    bool pushArray(std::string_view name, std::span<const long long> values);
+
+    /**
+     * @brief Pushes a read-only view of shared data onto the Lua stack. The data is referenced, not copied.
+     * @param data Shared data. nil is pushed for an empty handle.
+     */
+    void pushSharedData(const LuaSharedData& data);
+
+    /**
+     * @brief Stores a read-only view of shared data as a global. The data is referenced, not copied.
+     * @param name Name of the global.
+     * @param data Shared data. nil is stored for an empty handle.
+     */
+    void pushSharedData(std::string_view name, const LuaSharedData& data);
+
+    /**
+     * @brief Reads the array part of the global Lua table with the given name into the given buffer.
+     * @param name Name of the global Lua table.
+     * @param values Buffer for the values at the keys 1..values.size().
+     * @return Number of leading values read. Reading stops at the first value that is not a number (an integer for long long).
+     */
+    std::size_t readArray(std::string_view name, std::span<double> values);
+    std::size_t readArray(std::string_view name, std::span<long long> values);
+
+    /**
+     * @brief Reads the array part of the Lua table at the specified index into the given buffer.
+     * @param index Index of the Lua table on the stack.
+     * @param values Buffer for the values at the keys 1..values.size().
+     * @return Number of leading values read, 0 if the value is not a table.
+     */
+    std::size_t readArray(int index, std::span<double> values);
+    std::size_t readArray(int index, std::span<long long> values);
     
     LuaTable getTable(std::string_view name);
 
+    /**
+     * @brief Converts the global Lua table with the given name into a flat representation.
+     * Nested tables are stored in the same arena and tables that are reachable more than once (including cycles) are
+     * converted once. The passed table is cleared first, so reusing it avoids allocations on later conversions.
+     * Tables nested deeper than Lua_flat_max_depth are rejected with an error.
+     * @param name Name of the global Lua table.
+     * @param table Flat table that receives the conversion.
+     */
+    FuncInfo getFlatTable(std::string_view name, LuaFlatTable& table);
+
+    /**
+     * @brief Creates a lazy view of the global Lua table with the given name. Nothing is copied up front.
+     * @param name Name of the global Lua table.
+     * @return View of the table. The view is invalid if the global is not a table.
+     */
+    LuaTableView getTableView(std::string_view name);
+
     /**
      * @brief Retrieves the Lua state associated with the LuaScript instance.
      * @return Pointer to the Lua state.
      */
     lua_State* getLuaState();
 
+    /**
+     * @brief Records the current state as the baseline for resetToSnapshot.
+     * Lua values are captured for every table reachable from the globals and the string metatable, e.g. nested
+     * tables of user data or package.loaded, through fields, keys, metatables and the upvalues of lua functions.
+     * On the C++ side the registered functions, user pointers, bytecode cache, memory limit, garbage collector
+     * settings, execution limit and whether call statistics are recorded.
+     */
+    void takeSnapshot();
+
+    /**
+     * @brief Restores the state recorded by takeSnapshot, clears the stack and steps the garbage collector.
+     * Functions registered since the snapshot are unregistered, the profiler is stopped and discarded and the
+     * call, memory peak and garbage collector statistics are reset. Handles created since the snapshot, e.g.
+     * LuaFunctionRef or LuaTask, must be destroyed before.
+     * @return False if no snapshot was taken or a call is running, the state can not be reset then.
+     */
+    bool resetToSnapshot();
+
+    /**
+     * @brief Checks if a call into the state is running, e.g. when called from a registered function.
+     * @return True between the start and the end of the outermost compile, doFunc, call or task resume.
+     */
+    bool isExecuting() const;
+
+    /**
+     * @brief Sets a hard cap on the memory of the Lua state.
+     * Allocations that would exceed the cap fail after an emergency collection, which raises a Lua memory
+     * error that is reported as FuncInfoType::MEMORY. The cap applies while a chunk is loaded or run and while
+     * a function or task runs. Values the host pushes between calls are not refused, since a memory error
+     * outside of a protected call would abort; they count towards the cap of the next call.
+     * @param bytes Maximum bytes, zero removes the limit.
+     */
+    void setMemoryLimit(std::size_t bytes);
+
+    /**
+     * @brief Gets the memory accounting of the Lua state.
+     * @return Current and peak bytes, the limit and allocation counts.
+     */
+    const LuaMemoryStats& getMemoryStats() const;
+
+    /**
+     * @brief Sets the peak memory to the current memory.
+     */
+    void resetPeakMemory();
+
+    /**
+     * @brief Applies garbage collector settings to the Lua state.
+     * @param config Collector mode, its parameters and the step budget per doFunc.
+     */
+    void setGcConfig(const LuaGcConfig& config);
+
+    /**
+     * @brief Gets the garbage collector settings.
+     * @return The settings last applied with setGcConfig.
+     */
+    const LuaGcConfig& getGcConfig() const;
+
+    /**
+     * @brief Performs an explicit collector step, also when the collector is stopped.
+     * Useful to collect between frames with LuaGcConfig::automatic set to false.
+     * @param kbytes Amount of work in kilobytes, zero for a single basic step.
+     * @return True if the step finished a collection cycle.
+     */
+    bool stepGc(int kbytes = 0);
+
+    /**
+     * @brief Performs a full garbage collection cycle.
+     */
+    void collectGarbage();
+
+    /**
+     * @brief Gets the time spent in the garbage collector.
+     * @return Step and collection counts with their total and longest time.
+     */
+    const LuaGcStats& getGcStats() const;
+
+    /**
+     * @brief Resets the garbage collector statistics.
+     */
+    void resetGcStats();
+
+    /**
+     * @brief Sets the budget of every following compile, compileString, doFunc and call.
+     * A call that exceeds the budget is aborted with a Lua error and reported as FuncInfoType::TIMEOUT.
+     * Nested calls from registered functions share the budget of the outermost call.
+     * @param limit Instruction and wall clock budget, a default constructed limit removes the budget.
+     */
+    void setExecutionLimit(const LuaExecutionLimit& limit);
+
+    /**
+     * @brief Gets the budget of a single call.
+     * @return The budget set with setExecutionLimit.
+     */
+    const LuaExecutionLimit& getExecutionLimit() const;
+
+    /**
+     * @brief Starts sampling the Lua call stacks of every following compile, compileString, doFunc and call.
+     * By default a timer on the CPU time of the thread requests a sample every `period` and the VM runs
+     * without a hook in between; the SIGPROF handler of the process is replaced. Earlier samples are discarded.
+     * @param config Sampling rate and table sizes.
+     */
+    void startProfiler(const LuaProfilerConfig& config = {});
+
+    /**
+     * @brief Stops sampling. The profile stays readable with getProfiler.
+     */
+    void stopProfiler();
+
+    bool isProfiling() const;
+
+    /**
+     * @brief Gets the profile of the last startProfiler, e.g. to write it as folded stacks.
+     * @return The profiler or nullptr if it was never started.
+     */
+    const LuaProfiler* getProfiler() const;
+
+    /**
+     * @brief Starts or stops recording the call count, error count and latency of every registered function:
+     * lua functions called with doFunc, call and callBatch, and C++ functions called from lua.
+     * Callable from any thread, calls that are running keep their decision.
+     * @param enabled True to record calls.
+     */
+    void setCallStatsEnabled(bool enabled);
+
+    bool isCallStatsEnabled() const;
+
+    /**
+     * @brief Copies the call statistics of every registered function. Callable from any thread while the script runs.
+     * @return One snapshot per registered function in registration order.
+     */
+    std::vector<LuaFunctionStatsSnapshot> getCallStats() const;
+
+    /**
+     * @brief Copies the call statistics of one registered function. Callable from any thread while the script runs.
+     * @param funcName Name of the registered function.
+     * @return The snapshot or std::nullopt if no function with this name is registered.
+     */
+    std::optional<LuaFunctionStatsSnapshot> getCallStats(std::string_view funcName) const;
+
+    /**
+     * @brief Discards all recorded calls. Must only be called while no call is running.
+     */
+    void resetCallStats();
+
     /**
      * @brief Adds a user-defined data pointer.
      * @tparam TYPE Type of the user data.
@@ -213,9 +777,311 @@ private:
     void resolvePushTable(LuaTable &table, long long idx);
     void keyValueTable(LuaTable& table, int idx);
     void indexedTable(LuaTable& table, int idx, unsigned long long tableLen);
+    std::uint32_t flattenTable(LuaFlatTable& table, int idx, int visited, int depth);
+    bool flattenValue(LuaFlatTable& table, int idx, int visited, int depth, LuaFlatValue& value);
+    void initState(std::size_t libs);
+    static void* allocate(void* ud, void* ptr, std::size_t osize, std::size_t nsize);
+    static void gcHook(void* ud, int event, int done);
+    int beginExecution();
+    void endExecution(int gcDepth);
+    void setExecutionHook();
+    static void requestSample(void* owner);
+    static void executionHook(lua_State* state, lua_Debug* ar);
+    FuncInfoType errorType(int status, FuncInfoType fallback) const;
     void openLibs(std::size_t libs);
     void resolveArgs(std::vector<LuaDescValue>& args);
     void resolveRets(std::vector<LuaDescValueR>& retVals);
+    FuncInfo callFunc(FuncDescription& funcDesc, std::string_view funcName, LuaFunctionStats* stats);
+    FuncInfo checkFuncName(std::string_view funcName);
+    std::pair<const std::string, RegisteredFunc>& addFunc(std::string_view funcName, FuncDescription* funcDesc, LuaFunctionKind kind);
+    LuaFunctionStats* measuredStats(LuaFunctionStats* stats) const;
+    void snapshotTable(int table, int tables, int metatables, int upvalues, int pending);
+    void snapshotUpvalues(int func, int tables, int upvalues, int pending);
+    void pendTable(int index, int tables, int pending);
+    void restoreTable(int target, int snapshot);
+
+    template<typename Func>
+    void pushClosure(Func&& func, LuaFunctionStats* stats)
+    {
+        ::lua_pushlightuserdata(L, this);
+        LuaBind::pushCallable(L, std::forward<Func>(func));
+        ::lua_pushlightuserdata(L, stats);
+        ::lua_pushcclosure(L, &invokeClosure<std::decay_t<Func>>, 3);
+    }
+
+    template<typename Closure>
+    struct NativeCall
+    {
+        LuaScript* self = nullptr;
+        Closure* func = nullptr;
+    };
+
+    /**
+     * Lua entry point of a function registered with regFunc(LuaCFunc). The callable runs in a protected call, so
+     * a Lua error it raises unwinds no further than this frame, which only holds trivially destructible locals and
+     * restores L on every path before it raises the error again.
+     */
+    template<typename Closure>
+    static int invokeClosure(lua_State* state)
+    {
+        NativeCall<Closure> call{static_cast<LuaScript*>(::lua_touserdata(state, lua_upvalueindex(1))),
+                                 static_cast<Closure*>(::lua_touserdata(state, lua_upvalueindex(2)))};
+        auto* stats = static_cast<LuaFunctionStats*>(::lua_touserdata(state, lua_upvalueindex(3)));
+        CallTiming timing(stats->isEnabled() ? stats : nullptr);
+        lua_State* caller = call.self->L;
+        call.self->L = state;
+
+        int nargs = ::lua_gettop(state);
+        ::lua_pushcfunction(state, &runClosure<Closure>);
+        ::lua_pushlightuserdata(state, &call);
+        ::lua_rotate(state, 1, 2);
+        int status = ::lua_pcall(state, nargs + 1, LUA_MULTRET, 0);
+
+        call.self->L = caller;
+        timing.finish(LuaTraceCategory::NATIVE, stats->getName(), status != LUA_OK);
+        if(status != LUA_OK)
+        {
+            call.self->mYieldResults = -1;
+            return ::lua_error(state);
+        }
+        if(call.self->mYieldResults >= 0)
+            return ::lua_yield(state, std::exchange(call.self->mYieldResults, -1));
+        return ::lua_gettop(state);
+    }
+
+    /**
+     * Protected body of invokeClosure. Removes the call from below the arguments and turns C++ exceptions into Lua errors.
+     */
+    template<typename Closure>
+    static int runClosure(lua_State* state)
+    {
+        auto* call = static_cast<NativeCall<Closure>*>(::lua_touserdata(state, 1));
+        ::lua_rotate(state, 1, -1);
+        lua_pop(state, 1);
+
+        int ret = 0;
+        bool failed = false;
+        try
+        {
+            ret = (*call->func)(*call->self);
+        }
+        catch(const std::exception& e)
+        {
+            LuaBind::pushError(state, e.what());
+            failed = true;
+        }
+        catch(...)
+        {
+            LuaBind::pushError(state, "Unknown C++ exception in registered function");
+            failed = true;
+        }
+        if(failed)
+            return ::lua_error(state);
+        return ret;
+    }
+
+    /**
+     * Binds a callable like LuaBind::pushFunction with its call statistics as first upvalue.
+     */
+    template<typename Func>
+    void pushMeasuredFunction(Func&& func, LuaFunctionStats* stats)
+    {
+        ::lua_pushlightuserdata(L, stats);
+        LuaBind::pushCallable(L, std::forward<Func>(func));
+        ::lua_pushcclosure(L, &invokeMeasured<std::decay_t<Func>>, 2);
+    }
+
+    /**
+     * Lua entry point of a function registered with regFunc(Func). LuaBind::call raises no Lua error, so L is
+     * restored and the argument and result values are destroyed before the error is raised.
+     */
+    template<typename Closure>
+    static int invokeMeasured(lua_State* state)
+    {
+        auto* stats = static_cast<LuaFunctionStats*>(::lua_touserdata(state, lua_upvalueindex(1)));
+        auto* func = static_cast<Closure*>(::lua_touserdata(state, lua_upvalueindex(2)));
+        auto* self = *static_cast<LuaScript**>(lua_getextraspace(state));
+        CallTiming timing(stats->isEnabled() ? stats : nullptr);
+        lua_State* caller = self->L;
+        self->L = state;
+
+        int badArg = 0;
+        const char* expected = nullptr;
+        int ret = LuaBind::call<Closure>(state, *func, badArg, expected);
+        self->L = caller;
+        bool yield = std::exchange(self->mYieldResults, -1) >= 0;
+        timing.finish(LuaTraceCategory::NATIVE, stats->getName(), badArg != 0 || ret < 0);
+        if(badArg)
+            return ::luaL_typeerror(state, badArg, expected);
+        if(ret < 0)
+            return ::lua_error(state);
+        if(yield)
+            return ::lua_yield(state, ret);
+        return ret;
+    }
+
+    /**
+     * Times a call for its call statistics and the tracer. It is trivially destructible, so it may live in
+     * frames a lua error unwinds.
+     */
+    struct CallTiming
+    {
+        LuaFunctionStats* stats = nullptr; /**< Call statistics the call is recorded in, nullptr if disabled. */
+        bool traced = false; /**< Set if the tracer records the call. */
+        std::chrono::steady_clock::time_point start = {}; /**< Start of the call. */
+
+        explicit CallTiming(LuaFunctionStats* measured)
+        : stats(measured), traced(LuaTracer::isEnabled())
+        {
+            if(stats || traced)
+                start = std::chrono::steady_clock::now();
+        }
+
+        void finish(LuaTraceCategory category, std::string_view name, bool failed) const
+        {
+            if(!stats && !traced)
+                return;
+            auto end = std::chrono::steady_clock::now();
+            if(stats)
+                stats->record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start), failed);
+            if(traced)
+                LuaTracer::record(category, name, start, end, failed);
+        }
+    };
+
+    struct BatchState
+    {
+        std::size_t index = 0;
+        std::size_t size = 0; /**< Number of items. */
+        bool mismatch = false;
+        LuaFunctionStats* stats = nullptr; /**< Call statistics each item is recorded in, nullptr if disabled. */
+        std::chrono::steady_clock::time_point start = {}; /**< Start of the running item. */
+        void (*collect)(lua_State*, BatchState&) = nullptr; /**< Copies the result on top of the stack after each item, nullptr if the items store their results themselves. */
+    };
+
+    template<typename... Args>
+    struct PushedCall
+    {
+        const LuaFunctionRef* funcRef;
+        std::tuple<const Args&...> args;
+    };
+
+    /**
+     * Runs inside a protected call with the PushedCall at index 1 and returns the function followed by the
+     * arguments, so a Lua error raised while pushing them, e.g. for an array of more than INT_MAX values,
+     * is caught. Lua errors unwind this frame, so it must only hold trivially destructible locals.
+     */
+    template<typename... Args>
+    static int pushCall(lua_State* state)
+    {
+        const auto* pushed = static_cast<const PushedCall<Args...>*>(::lua_touserdata(state, 1));
+        constexpr int nargs = (LuaStack::count<Args>() + ... + 0);
+        ::luaL_checkstack(state, nargs + 1, nullptr);
+        pushed->funcRef->push(state);
+        std::apply([state](const auto&... arg)
+        {
+            (LuaStack::push(state, arg), ...);
+        }, pushed->args);
+        return nargs + 1;
+    }
+
+    template<typename Tuple, typename R>
+    struct BatchCall : BatchState
+    {
+        std::span<const Tuple> args;
+        std::conditional_t<std::is_void_v<R>, void*, R*> results;
+    };
+
+    /**
+     * Results that can not be copied without allocating are copied after the protected call of their item,
+     * so a std::bad_alloc never unwinds Lua frames.
+     */
+    template<typename R>
+    static constexpr bool collectsBatch = !std::is_void_v<R> && !std::is_trivially_copyable_v<LuaStack::Value<R>>;
+
+    FuncInfo runBatch(const LuaFunctionRef& funcRef, lua_CFunction invoke, BatchState& batch);
+
+    /**
+     * Runs inside the protected call of runBatch with the batch at index 1 and the function at index 2.
+     * Lua errors unwind this frame, so it must only hold trivially destructible locals. Results collected
+     * by collectBatch are returned one item per call.
+     */
+    template<typename Tuple, typename R>
+    static int invokeBatch(lua_State* state)
+    {
+        auto* batch = static_cast<BatchCall<Tuple, R>*>(static_cast<BatchState*>(::lua_touserdata(state, 1)));
+        ::luaL_checkstack(state, LuaStack::count<Tuple>() + 1, nullptr);
+        for(; batch->index < batch->args.size(); ++batch->index)
+        {
+            // set before the arguments are pushed, so an item failing to push them is not timed from the previous one
+            if(batch->stats)
+                batch->start = std::chrono::steady_clock::now();
+            ::lua_pushvalue(state, 2);
+            std::apply([state](const auto&... arg)
+            {
+                (LuaStack::push(state, arg), ...);
+            }, batch->args[batch->index]);
+
+            if constexpr (collectsBatch<R>)
+            {
+                ::lua_call(state, static_cast<int>(std::tuple_size_v<Tuple>), 1);
+                return 1;
+            }
+            else if constexpr (std::is_void_v<R>)
+            {
+                ::lua_call(state, static_cast<int>(std::tuple_size_v<Tuple>), 0);
+                if(batch->stats)
+                    batch->stats->record(batch->start, false);
+            }
+            else
+            {
+                ::lua_call(state, static_cast<int>(std::tuple_size_v<Tuple>), 1);
+                bool valid = LuaStack::check<R>(state, -1);
+                if(batch->stats)
+                    batch->stats->record(batch->start, !valid);
+                if(!valid)
+                {
+                    batch->mismatch = true;
+                    return 0;
+                }
+                batch->results[batch->index] = LuaStack::read<R>(state, -1);
+                lua_pop(state, 1);
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * Copies the result of the item that just returned from the protected call into the results.
+     */
+    template<typename Tuple, typename R>
+    static void collectBatch(lua_State* state, BatchState& base)
+    {
+        auto& batch = static_cast<BatchCall<Tuple, R>&>(base);
+        LuaStack::Value<R> value{};
+        bool valid = LuaStack::tryRead<R>(state, -1, value);
+        if(batch.stats)
+            batch.stats->record(batch.start, !valid);
+        if(!valid)
+        {
+            batch.mismatch = true;
+            return;
+        }
+        batch.results[batch.index] = std::move(value);
+        ++batch.index;
+    }
+
+    template<typename... R, std::size_t... I>
+    std::tuple<R...> popRets(std::index_sequence<I...>)
+    {
+        constexpr int count = static_cast<int>(sizeof...(R));
+        std::tuple<LuaStack::Value<R>...> values{};
+        bool valid = (LuaStack::tryRead<R>(L, static_cast<int>(I) - count, std::get<I>(values)) && ...);
+        lua_pop(L, count);
+        if(!valid)
+            throw std::invalid_argument("Failed to get return value. Returned values do not match the expected types");
+        return std::tuple<R...>{std::move(std::get<I>(values))...};
+    }
 };
 
 #endif // LUA_SCRIPT_H
\ No newline at end of file
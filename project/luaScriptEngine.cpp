@@ -0,0 +1,247 @@
+#include "luaScriptEngine.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+    int writeChunk(lua_State*, const void* data, std::size_t size, void* userData)
+    {
+        static_cast<std::string*>(userData)->append(static_cast<const char*>(data), size);
+        return 0;
+    }
+}
+
+LuaScriptEngine::LuaScriptEngine(std::size_t libs, const std::filesystem::path& path, InitFunc init, bool pinThreads)
+: mPath(path), mLibs(libs), mInit(std::move(init)), mPinThreads(pinThreads)
+{}
+
+LuaScriptEngine::~LuaScriptEngine()
+{
+    stop();
+}
+
+FuncInfo LuaScriptEngine::start(std::size_t workers)
+{
+    if(mRunning)
+        return FuncInfo(FuncInfoType::OK);
+
+    auto info = compileBytecode();
+    if(!info)
+        return info;
+
+    if(workers == 0)
+        workers = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+    {
+        std::scoped_lock lock(mSleepMutex);
+        mStopping = false;
+        mPending = 0;
+    }
+
+    std::vector<std::promise<FuncInfo>> ready(workers);
+    {
+        std::unique_lock workersLock(mWorkersMutex);
+        mWorkers.clear();
+        for(std::size_t i = 0; i < workers; ++i)
+            mWorkers.push_back(std::make_unique<Worker>());
+        for(std::size_t i = 0; i < workers; ++i)
+        {
+            mWorkers[i]->thread = std::thread(&LuaScriptEngine::run, this, i, std::ref(ready[i]));
+            if(mPinThreads)
+                pinThread(mWorkers[i]->thread, i);
+        }
+    }
+
+    info = FuncInfo(FuncInfoType::OK);
+    for(auto& promise : ready)
+    {
+        auto workerInfo = promise.get_future().get();
+        if(info && !workerInfo)
+            info = workerInfo;
+    }
+
+    mRunning = true;
+    if(!info)
+        stop();
+    return info;
+}
+
+void LuaScriptEngine::stop()
+{
+    // every enqueue that saw the engine running has counted its job, so the workers run it before they exit
+    {
+        std::unique_lock workersLock(mWorkersMutex);
+        mRunning = false;
+        std::scoped_lock lock(mSleepMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+
+    // jobs submitting while the workers drain the queues fail instead of waiting for the lock
+    for(auto& worker : mWorkers)
+    {
+        if(worker->thread.joinable())
+            worker->thread.join();
+    }
+    std::unique_lock workersLock(mWorkersMutex);
+    mWorkers.clear();
+}
+
+std::future<FuncInfo> LuaScriptEngine::doFunc(std::string_view funcName)
+{
+    return submit([name = std::string(funcName)](LuaScript& script)
+    {
+        return script.doFunc(name);
+    });
+}
+
+std::size_t LuaScriptEngine::size() const
+{
+    std::shared_lock workersLock(mWorkersMutex);
+    return mWorkers.size();
+}
+
+bool LuaScriptEngine::isRunning() const
+{
+    return mRunning;
+}
+
+void LuaScriptEngine::enqueue(Job job)
+{
+    std::shared_lock workersLock(mWorkersMutex);
+    if(!mRunning)
+        throw std::runtime_error("Failed to submit job - engine is not running");
+
+    // count the job while its queue is locked, so it is never taken before it is counted nor counted before it can be taken
+    Worker& worker = *mWorkers[mNext.fetch_add(1, std::memory_order_relaxed) % mWorkers.size()];
+    {
+        std::scoped_lock lock(worker.mutex, mSleepMutex);
+        worker.jobs.push_back(std::move(job));
+        ++mPending;
+    }
+    mWake.notify_one();
+}
+
+void LuaScriptEngine::run(std::size_t index, std::promise<FuncInfo>& ready)
+{
+    Worker& worker = *mWorkers[index];
+    LuaTracer::setThreadName("luaCPP worker " + std::to_string(index));
+    FuncInfo info(FuncInfoType::OK);
+    try
+    {
+        worker.script = std::make_unique<LuaScript>(mPath, mLibs);
+        info = initScript(*worker.script);
+    }
+    catch(const std::exception& e)
+    {
+        std::string errmsg;
+        errmsg.append("Failed to create lua state - ").append(e.what());
+        info = FuncInfo(errmsg, FuncInfoType::LOAD);
+    }
+    bool failed = !info;
+    ready.set_value(std::move(info));
+
+    Job job;
+    while(true)
+    {
+        if(!failed && take(index, job))
+        {
+            job(*worker.script);
+            job = nullptr;
+            continue;
+        }
+
+        std::unique_lock lock(mSleepMutex);
+        mWake.wait(lock, [this] { return mStopping || mPending > 0; });
+        if(mStopping && (failed || mPending == 0))
+            break;
+    }
+    worker.script.reset();
+}
+
+bool LuaScriptEngine::take(std::size_t index, Job& job)
+{
+    // own queue from the front, other queues from the back to keep contention on different ends
+    for(std::size_t i = 0; i < mWorkers.size(); ++i)
+    {
+        Worker& worker = *mWorkers[(index + i) % mWorkers.size()];
+        std::scoped_lock lock(worker.mutex);
+        if(worker.jobs.empty())
+            continue;
+
+        if(i == 0)
+        {
+            job = std::move(worker.jobs.front());
+            worker.jobs.pop_front();
+        }
+        else
+        {
+            job = std::move(worker.jobs.back());
+            worker.jobs.pop_back();
+        }
+        std::scoped_lock sleepLock(mSleepMutex);
+        --mPending;
+        return true;
+    }
+    return false;
+}
+
+FuncInfo LuaScriptEngine::initScript(LuaScript& script) const
+{
+    if(mInit)
+    {
+        auto info = mInit(script);
+        if(!info)
+            return info;
+    }
+
+    if(!mBytecode.empty())
+        return script.compileString(mBytecode, "@" + mPath.string());
+    return FuncInfo(FuncInfoType::OK);
+}
+
+FuncInfo LuaScriptEngine::compileBytecode()
+{
+    using enum FuncInfoType;
+    mBytecode.clear();
+    if(mPath.empty())
+        return FuncInfo(OK);
+
+    lua_State* L = ::luaL_newstate();
+    if(L == nullptr)
+        return FuncInfo("Failed to create lua state", LOAD);
+
+    if(::luaL_loadfilex(L, mPath.string().c_str(), "t") != LUA_OK)
+    {
+        std::string errmsg;
+        errmsg.append("Failed to compile lua script with path[").append(mPath.string()).append("] - ").append(LuaStack::errorMessage(L, -1));
+        ::lua_close(L);
+        return FuncInfo(errmsg, COMPILE);
+    }
+
+    ::lua_dump(L, writeChunk, &mBytecode, 0);
+    ::lua_close(L);
+    return FuncInfo(OK);
+}
+
+void LuaScriptEngine::pinThread(std::thread& thread, std::size_t index)
+{
+#ifdef __linux__
+    unsigned int cpus = std::thread::hardware_concurrency();
+    if(cpus == 0)
+        return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<int>(index % cpus), &set);
+    ::pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)index;
+#endif
+}
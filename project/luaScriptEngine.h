@@ -0,0 +1,145 @@
+#ifndef LUA_SCRIPT_ENGINE_H
+#define LUA_SCRIPT_ENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "luaScript.h"
+#include "funcInfo.h"
+
+/**
+ * @class LuaScriptEngine
+ * @brief Runs the same script on a set of worker threads, each owning its own Lua state.
+ *
+ * The script is compiled once to bytecode and loaded into every worker state, after the optional
+ * init callback registered the functions of that state. Jobs are distributed round robin over the
+ * worker queues; an idle worker steals jobs from the back of the other queues. A job always runs
+ * on the LuaScript of the worker that executes it, so jobs must not rely on globals set by other jobs.
+ */
+class LuaScriptEngine
+{
+public:
+    using InitFunc = std::function<FuncInfo(LuaScript&)>;
+    using Job = std::function<void(LuaScript&)>;
+
+private:
+    struct Worker
+    {
+        std::mutex mutex; /**< Guards the job queue. */
+        std::deque<Job> jobs = {}; /**< Jobs queued for this worker. */
+        std::thread thread = {}; /**< Thread that owns the script. */
+        std::unique_ptr<LuaScript> script = nullptr; /**< State of this worker, created on its thread. */
+    };
+
+    std::filesystem::path mPath = ""; /**< Script loaded into every state. Empty for none. */
+    std::size_t mLibs = Lua_lib_all; /**< Bitmask of the libraries opened in every state. */
+    InitFunc mInit = nullptr; /**< Callback run on every state before the script is loaded. */
+    bool mPinThreads = true; /**< Pins worker i to CPU i modulo the CPU count where supported. */
+
+    std::vector<std::unique_ptr<Worker>> mWorkers = {}; /**< Workers with their queues, guarded by mWorkersMutex. */
+    mutable std::shared_mutex mWorkersMutex; /**< Shared by enqueue, exclusive while start and stop change the workers. */
+    std::string mBytecode = ""; /**< Compiled script shared by all states. */
+    std::atomic<std::size_t> mNext = 0; /**< Worker that receives the next job. */
+    std::mutex mSleepMutex; /**< Guards sleeping and waking workers. */
+    std::condition_variable mWake; /**< Signals queued jobs and shutdown. */
+    std::size_t mPending = 0; /**< Number of jobs in the queues, guarded by mSleepMutex. */
+    bool mStopping = false; /**< Set when the workers should exit once the queues are empty. */
+    std::atomic<bool> mRunning = false; /**< Set between start and stop. */
+
+public:
+    /**
+     * @brief Constructor with the libraries to open and the script to load in every state.
+     * @param libs Bitmask to open the lua libraries.
+     * @param path Path to the Lua script file. Empty to load nothing.
+     * @param init Callback run on every state before the script is loaded, e.g. to register functions (optional).
+     * @param pinThreads Pins every worker thread to one CPU where supported.
+     */
+    explicit LuaScriptEngine(std::size_t libs = Lua_lib_all, const std::filesystem::path& path = "",
+                             InitFunc init = nullptr, bool pinThreads = true);
+
+    /**
+     * @brief Destructor. Runs the queued jobs and stops the workers.
+     */
+    ~LuaScriptEngine();
+
+    LuaScriptEngine(const LuaScriptEngine&) = delete;
+    LuaScriptEngine& operator=(const LuaScriptEngine&) = delete;
+
+    /**
+     * @brief Compiles the script and starts the workers. Returns after every state is initialized.
+     * @param workers Number of worker threads. 0 for one per hardware thread.
+     * @return The first error of compiling the script or initializing a state. No worker runs on error.
+     */
+    FuncInfo start(std::size_t workers = 0);
+
+    /**
+     * @brief Runs the queued jobs and stops the workers.
+     */
+    void stop();
+
+    /**
+     * @brief Queues a job for any worker.
+     * @tparam Func Callable with the signature R(LuaScript&).
+     * @param func Job. It runs on the script of the worker that picks it up.
+     * @return Future of the job result. Exceptions thrown by the job are stored in the future.
+     * @throws std::runtime_error if the engine is not running.
+     */
+    template<typename Func>
+        requires std::is_invocable_v<std::decay_t<Func>&, LuaScript&>
+    auto submit(Func&& func) -> std::future<std::invoke_result_t<std::decay_t<Func>&, LuaScript&>>
+    {
+        using Result = std::invoke_result_t<std::decay_t<Func>&, LuaScript&>;
+        auto task = std::make_shared<std::packaged_task<Result(LuaScript&)>>(std::forward<Func>(func));
+        auto future = task->get_future();
+        enqueue([task](LuaScript& script)
+        {
+            (*task)(script);
+        });
+        return future;
+    }
+
+    /**
+     * @brief Queues a call of a registered Lua function.
+     * @param funcName Name of the registered Lua function.
+     * @return Future of the call result.
+     * @throws std::runtime_error if the engine is not running.
+     */
+    std::future<FuncInfo> doFunc(std::string_view funcName);
+
+    /**
+     * @brief Gets the number of workers.
+     * @return Number of running workers.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Checks if the workers are running.
+     * @return True between a successful start and stop.
+     */
+    bool isRunning() const;
+
+private:
+    void enqueue(Job job);
+    void run(std::size_t index, std::promise<FuncInfo>& ready);
+    bool take(std::size_t index, Job& job);
+    FuncInfo initScript(LuaScript& script) const;
+    FuncInfo compileBytecode();
+    static void pinThread(std::thread& thread, std::size_t index);
+};
+
+#endif // LUA_SCRIPT_ENGINE_H
@@ -0,0 +1,295 @@
+#include "luaSharedData.h"
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+LuaSharedData::LuaSharedData(LuaFlatTable&& table)
+: mData(std::make_shared<const LuaFlatTable>(std::move(table)))
+{}
+
+LuaSharedData::LuaSharedData(LuaTable& table)
+{
+    LuaFlatTable flat;
+    convert(flat, table);
+    mData = std::make_shared<const LuaFlatTable>(std::move(flat));
+}
+
+LuaSharedData::LuaSharedData(std::span<const double> values)
+: mData(std::make_shared<const LuaFlatTable>(convertArray(values)))
+{}
+
+LuaSharedData::LuaSharedData(std::span<const long long> values)
+: mData(std::make_shared<const LuaFlatTable>(convertArray(values)))
+{}
+
+const LuaFlatTable* LuaSharedData::get() const
+{
+    return mData.get();
+}
+
+bool LuaSharedData::isValid() const
+{
+    return mData != nullptr;
+}
+
+LuaSharedData::operator bool() const
+{
+    return isValid();
+}
+
+void LuaSharedData::push(lua_State* L, const LuaSharedData& data)
+{
+    if(!data.mData)
+    {
+        ::lua_pushnil(L);
+        return;
+    }
+    pushProxy(L, data.mData, 0);
+}
+
+std::uint32_t LuaSharedData::convert(LuaFlatTable& flat, LuaTable& table)
+{
+    auto size = static_cast<std::uint32_t>(table.size());
+    bool indexed = table.isIndexed();
+    auto id = flat.addTable(indexed ? size : 0, indexed ? 0 : size);
+
+    std::uint32_t count = 0;
+    while(!table.isEnd())
+    {
+        auto [name, value] = table.getNextValue();
+        if(!value.hasValue())
+            continue;
+
+        LuaFlatValue flatValue;
+        if(value.hasType<long long>())
+        {
+            flatValue.type = LuaFlatType::INTEGER;
+            flatValue.integer = value.retrieve<long long>();
+        }
+        else if(value.hasType<double>())
+        {
+            flatValue.type = LuaFlatType::NUMBER;
+            flatValue.number = value.retrieve<double>();
+        }
+        else if(value.hasType<bool>())
+        {
+            flatValue.type = LuaFlatType::BOOLEAN;
+            flatValue.boolean = value.retrieve<bool>();
+        }
+        else if(value.hasType<std::string>())
+        {
+            flatValue.type = LuaFlatType::STRING;
+            flatValue.index = flat.intern(value.retrieve<std::string>());
+        }
+        else if(value.hasType<LuaTable>())
+        {
+            // nested tables are keyed by their own name, like in LuaScript::pushTable
+            auto& nested = value.retrieve<LuaTable>();
+            name = nested.getName();
+            flatValue.type = LuaFlatType::TABLE;
+            flatValue.index = convert(flat, nested);
+        }
+        else
+        {
+            continue;
+        }
+
+        if(indexed)
+        {
+            flat.setArrayValue(id, count++, flatValue);
+        }
+        else
+        {
+            LuaFlatEntry entry;
+            entry.key.type = LuaFlatType::STRING;
+            entry.key.index = flat.intern(name);
+            entry.value = flatValue;
+            flat.setHashEntry(id, count++, entry);
+        }
+    }
+
+    if(!indexed)
+    {
+        flat.shrinkHash(id, count);
+        flat.sortHash(id);
+    }
+    return id;
+}
+
+template<typename T>
+LuaFlatTable LuaSharedData::convertArray(std::span<const T> values)
+{
+    LuaFlatTable flat;
+    flat.reserve(1, values.size(), 0, 0);
+    auto id = flat.addTable(static_cast<std::uint32_t>(values.size()), 0);
+    for(std::size_t i = 0; i < values.size(); i++)
+    {
+        LuaFlatValue value;
+        if constexpr (std::is_same_v<T, double>)
+        {
+            value.type = LuaFlatType::NUMBER;
+            value.number = values[i];
+        }
+        else
+        {
+            value.type = LuaFlatType::INTEGER;
+            value.integer = values[i];
+        }
+        flat.setArrayValue(id, static_cast<std::uint32_t>(i), value);
+    }
+    return flat;
+}
+
+void LuaSharedData::pushProxy(lua_State* L, const std::shared_ptr<const LuaFlatTable>& data, std::uint32_t table)
+{
+    // the metatable exists before the proxy is constructed, so a memory error never leaks the reference
+    if(::luaL_newmetatable(L, sMetaName))
+    {
+        const luaL_Reg metamethods[] = {
+            {"__index", &index},
+            {"__newindex", &newIndex},
+            {"__len", &length},
+            {"__pairs", &pairs},
+            {"__gc", &destroy},
+            {nullptr, nullptr},
+        };
+        ::luaL_setfuncs(L, metamethods, 0);
+    }
+
+    void* mem = ::lua_newuserdatauv(L, sizeof(Proxy), 1);
+    new (mem) Proxy{data, table};
+    lua_insert(L, -2);
+    ::lua_setmetatable(L, -2);
+}
+
+void LuaSharedData::pushValue(lua_State* L, const LuaFlatValue& value)
+{
+    auto* proxy = static_cast<Proxy*>(::lua_touserdata(L, 1));
+    switch(value.type)
+    {
+    case LuaFlatType::INTEGER:
+        ::lua_pushinteger(L, value.integer);
+        break;
+    case LuaFlatType::NUMBER:
+        ::lua_pushnumber(L, value.number);
+        break;
+    case LuaFlatType::BOOLEAN:
+        ::lua_pushboolean(L, value.boolean);
+        break;
+    case LuaFlatType::STRING:
+    {
+        auto str = proxy->data->string(value.index);
+        ::lua_pushlstring(L, str.data(), str.size());
+        break;
+    }
+    case LuaFlatType::TABLE:
+        // nested proxies are cached in the user value of the parent, so repeated lookups do not allocate
+        if(::lua_getiuservalue(L, 1, 1) != LUA_TTABLE)
+        {
+            lua_pop(L, 1);
+            lua_newtable(L);
+            ::lua_pushvalue(L, -1);
+            ::lua_setiuservalue(L, 1, 1);
+        }
+        if(::lua_rawgeti(L, -1, value.index) == LUA_TNIL)
+        {
+            lua_pop(L, 1);
+            pushProxy(L, proxy->data, value.index);
+            ::lua_pushvalue(L, -1);
+            ::lua_rawseti(L, -3, value.index);
+        }
+        lua_remove(L, -2);
+        break;
+    default:
+        ::lua_pushnil(L);
+        break;
+    }
+}
+
+int LuaSharedData::index(lua_State* L)
+{
+    auto* proxy = static_cast<Proxy*>(::luaL_checkudata(L, 1, sMetaName));
+    const LuaFlatValue* value = nullptr;
+    if(::lua_type(L, 2) == LUA_TSTRING)
+    {
+        std::size_t len = 0;
+        const char* key = ::lua_tolstring(L, 2, &len);
+        value = proxy->data->find(std::string_view(key, len), proxy->table);
+    }
+    else if(::lua_type(L, 2) == LUA_TNUMBER)
+    {
+        int isInt = 0;
+        lua_Integer key = ::lua_tointegerx(L, 2, &isInt);
+        if(isInt)
+            value = proxy->data->find(static_cast<long long>(key), proxy->table);
+    }
+
+    if(value == nullptr)
+        ::lua_pushnil(L);
+    else
+        pushValue(L, *value);
+    return 1;
+}
+
+int LuaSharedData::length(lua_State* L)
+{
+    auto* proxy = static_cast<Proxy*>(::luaL_checkudata(L, 1, sMetaName));
+    auto values = proxy->data->array(proxy->table);
+    auto size = values.size();
+    while(size > 0 && values[size - 1].type == LuaFlatType::NIL)
+        size--;
+    ::lua_pushinteger(L, static_cast<lua_Integer>(size));
+    return 1;
+}
+
+int LuaSharedData::newIndex(lua_State* L)
+{
+    return ::luaL_error(L, "attempt to modify shared data");
+}
+
+int LuaSharedData::pairs(lua_State* L)
+{
+    ::luaL_checkudata(L, 1, sMetaName);
+    ::lua_pushinteger(L, 0);
+    ::lua_pushcclosure(L, &next, 1);
+    ::lua_pushvalue(L, 1);
+    ::lua_pushnil(L);
+    return 3;
+}
+
+int LuaSharedData::next(lua_State* L)
+{
+    // the position of the iteration is kept in the upvalue, the control variable is not needed
+    auto* proxy = static_cast<Proxy*>(::luaL_checkudata(L, 1, sMetaName));
+    auto values = proxy->data->array(proxy->table);
+    auto entries = proxy->data->hash(proxy->table);
+    auto pos = static_cast<std::size_t>(::lua_tointeger(L, lua_upvalueindex(1)));
+    while(pos < values.size() && values[pos].type == LuaFlatType::NIL)
+        pos++;
+
+    if(pos < values.size())
+    {
+        ::lua_pushinteger(L, static_cast<lua_Integer>(pos + 1));
+        ::lua_copy(L, -1, lua_upvalueindex(1));
+        pushValue(L, values[pos]);
+        return 2;
+    }
+    if(pos - values.size() < entries.size())
+    {
+        ::lua_pushinteger(L, static_cast<lua_Integer>(pos + 1));
+        lua_replace(L, lua_upvalueindex(1));
+        auto const& entry = entries[pos - values.size()];
+        pushValue(L, entry.key);
+        pushValue(L, entry.value);
+        return 2;
+    }
+    ::lua_pushnil(L);
+    return 1;
+}
+
+int LuaSharedData::destroy(lua_State* L)
+{
+    static_cast<Proxy*>(::lua_touserdata(L, 1))->~Proxy();
+    return 0;
+}
@@ -0,0 +1,98 @@
+#ifndef LUA_SHARED_DATA_H
+#define LUA_SHARED_DATA_H
+
+#include <lua.hpp>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+
+#include "luaFlatTable.h"
+#include "luaTable.h"
+
+/**
+ * @class LuaSharedData
+ * @brief Immutable data set owned by C++ and shared by any number of Lua states.
+ *
+ * The data is converted once into a LuaFlatTable that is never modified afterwards, so states on different
+ * threads read it concurrently without locking. Pushing it into a state creates a small read-only userdata
+ * that references the data instead of copying it into a Lua table. Copies of a LuaSharedData share the
+ * same data, which lives until the last copy and the last userdata referencing it are gone.
+ *
+ * In Lua the userdata supports indexing with string and integer keys, `#`, `pairs` and `ipairs`. Nested
+ * tables are returned as further read-only userdata, cached per state. Assignments raise an error.
+ */
+class LuaSharedData
+{
+private:
+    std::shared_ptr<const LuaFlatTable> mData = nullptr; /**< Shared, immutable data. */
+
+public:
+    /**
+     * @brief Default constructor. Creates an empty handle that is pushed as nil.
+     */
+    LuaSharedData() = default;
+
+    /**
+     * @brief Constructor that takes over a flat table, e.g. filled by LuaScript::getFlatTable.
+     * @param table Flat table with the data. Table 0 is exposed to Lua.
+     */
+    explicit LuaSharedData(LuaFlatTable&& table);
+
+    /**
+     * @brief Constructor that converts a LuaTable with its nested tables.
+     * Like LuaScript::pushTable, the values of the table are consumed by the conversion.
+     * @param table Table with the data.
+     */
+    explicit LuaSharedData(LuaTable& table);
+
+    /**
+     * @brief Constructor with an array of numbers, stored at the keys 1..n.
+     * @param values Values of the array.
+     */
+    explicit LuaSharedData(std::span<const double> values);
+    explicit LuaSharedData(std::span<const long long> values);
+
+    /**
+     * @brief Retrieves the shared data.
+     * @return The flat table or nullptr for an empty handle.
+     */
+    const LuaFlatTable* get() const;
+
+    bool isValid() const;
+    explicit operator bool() const;
+
+    /**
+     * @brief Pushes a read-only userdata referencing the data onto the Lua stack.
+     * @param L Lua state.
+     * @param data Data to push. nil is pushed for an empty handle.
+     */
+    static void push(lua_State* L, const LuaSharedData& data);
+
+private:
+    struct Proxy
+    {
+        std::shared_ptr<const LuaFlatTable> data; /**< Keeps the data alive while the userdata exists. */
+        std::uint32_t table = 0; /**< Table of the data this userdata stands for. */
+    };
+
+    static constexpr const char* sMetaName = "LuaSharedData"; /**< Registry name of the metatable. */
+
+    static std::uint32_t convert(LuaFlatTable& flat, LuaTable& table);
+    template<typename T>
+    static LuaFlatTable convertArray(std::span<const T> values);
+
+    static void pushProxy(lua_State* L, const std::shared_ptr<const LuaFlatTable>& data, std::uint32_t table);
+    /**
+     * Pushes a value of the proxy at index 1, which is the case in every metamethod.
+     */
+    static void pushValue(lua_State* L, const LuaFlatValue& value);
+    static int index(lua_State* L);
+    static int length(lua_State* L);
+    static int newIndex(lua_State* L);
+    static int pairs(lua_State* L);
+    static int next(lua_State* L);
+    static int destroy(lua_State* L);
+};
+
+#endif // LUA_SHARED_DATA_H
@@ -0,0 +1,415 @@
+#ifndef LUA_STACK_H
+#define LUA_STACK_H
+
+#include <lua.hpp>
+#include <algorithm>
+#include <climits>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <vector>
+
+/**
+ * @brief Compile time dispatch of C++ types to Lua stack operations.
+ *
+ * Supported types are integral types, floating point types, bool, std::string, std::string_view and const char*.
+ * On top of that std::optional of these types (nil for no value), std::span and std::vector of numbers
+ * (read as an array table into a std::vector) and std::tuple (pushed as multiple values) are supported.
+ */
+struct LuaStack
+{
+    template<typename T>
+    using Plain = std::remove_cvref_t<T>;
+
+    template<typename T>
+    struct Traits
+    {
+        static constexpr bool isOptional = false;
+        static constexpr bool isArray = false;
+        static constexpr bool isTuple = false;
+        using Value = Plain<T>;
+    };
+
+    template<typename T>
+    struct Traits<std::optional<T>>
+    {
+        static constexpr bool isOptional = true;
+        static constexpr bool isArray = false;
+        static constexpr bool isTuple = false;
+        using Element = T;
+        using Value = std::optional<typename Traits<Plain<T>>::Value>;
+    };
+
+    template<typename T, std::size_t Extent>
+    struct Traits<std::span<T, Extent>>
+    {
+        static constexpr bool isOptional = false;
+        static constexpr bool isArray = true;
+        static constexpr bool isTuple = false;
+        using Element = std::remove_const_t<T>;
+        using Value = std::vector<Element>;
+    };
+
+    template<typename T>
+    struct Traits<std::vector<T>>
+    {
+        static constexpr bool isOptional = false;
+        static constexpr bool isArray = true;
+        static constexpr bool isTuple = false;
+        using Element = T;
+        using Value = std::vector<T>;
+    };
+
+    template<typename... T>
+    struct Traits<std::tuple<T...>>
+    {
+        static constexpr bool isOptional = false;
+        static constexpr bool isArray = false;
+        static constexpr bool isTuple = true;
+        using Value = std::tuple<T...>;
+    };
+
+    /**
+     * @brief Type a Lua value is read into for T. Spans are backed by a std::vector.
+     */
+    template<typename T>
+    using Value = typename Traits<Plain<T>>::Value;
+
+    /**
+     * @brief Number of Lua values pushed for T.
+     */
+    template<typename T>
+    static constexpr int count()
+    {
+        if constexpr (std::is_void_v<T>)
+            return 0;
+        else if constexpr (Traits<Plain<T>>::isTuple)
+            return static_cast<int>(std::tuple_size_v<Plain<T>>);
+        else
+            return 1;
+    }
+
+    template<typename T>
+    static constexpr bool isInteger = std::is_integral_v<Plain<T>> && !std::is_same_v<Plain<T>, bool>;
+
+    template<typename T>
+    static constexpr bool isString = std::is_same_v<Plain<T>, std::string> || std::is_same_v<Plain<T>, std::string_view> ||
+                                     std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*>;
+
+    template<typename T>
+    static constexpr bool isSupported = isInteger<T> || std::is_floating_point_v<Plain<T>> ||
+                                        std::is_same_v<Plain<T>, bool> || isString<T>;
+
+    /**
+     * @brief Checks if a Lua integer fits into the integral type T without being cut.
+     * @tparam T Integral type to check for.
+     * @param value Lua integer to check.
+     * @return True if the value is in the range of T.
+     */
+    template<typename T>
+    static constexpr bool inRange(lua_Integer value)
+    {
+        using Int = Plain<T>;
+        if constexpr (std::is_signed_v<Int>)
+            return value >= static_cast<lua_Integer>(std::numeric_limits<Int>::min()) &&
+                   value <= static_cast<lua_Integer>(std::numeric_limits<Int>::max());
+        else
+            return value >= 0 && static_cast<lua_Unsigned>(value) <= std::numeric_limits<Int>::max();
+    }
+
+    /**
+     * @brief Pushes a C++ value onto the Lua stack. Arrays of more than INT_MAX values raise a Lua error.
+     * @tparam T Type of the value.
+     * @param L Lua state.
+     * @param value Value to push.
+     */
+    template<typename T>
+    static void push(lua_State* L, const T& value)
+    {
+        if constexpr (Traits<Plain<T>>::isOptional)
+        {
+            if(value)
+                push(L, *value);
+            else
+                ::lua_pushnil(L);
+        }
+        else if constexpr (Traits<Plain<T>>::isArray)
+        {
+            using Element = typename Traits<Plain<T>>::Element;
+            if(value.size() > INT_MAX)
+                ::luaL_error(L, "array of %I values is too large for a lua table", static_cast<lua_Integer>(value.size()));
+            ::lua_createtable(L, static_cast<int>(value.size()), 0);
+            if constexpr (std::is_same_v<Element, lua_Number>)
+                ::lua_rawsetnumbers(L, -1, value.data(), static_cast<unsigned int>(value.size()));
+            else if constexpr (std::is_same_v<Element, lua_Integer>)
+                ::lua_rawsetintegers(L, -1, value.data(), static_cast<unsigned int>(value.size()));
+            else
+            {
+                lua_Integer idx = 1;
+                for(const auto& element : value)
+                {
+                    push(L, element);
+                    ::lua_rawseti(L, -2, idx++);
+                }
+            }
+        }
+        else if constexpr (Traits<Plain<T>>::isTuple)
+            std::apply([L](const auto&... elements) { (push(L, elements), ...); }, value);
+        else if constexpr (!isSupported<T>)
+            static_assert(isSupported<T>, "Type can not be pushed onto the lua stack");
+        else if constexpr (std::is_same_v<Plain<T>, bool>)
+            ::lua_pushboolean(L, value);
+        else if constexpr (isInteger<T>)
+            ::lua_pushinteger(L, static_cast<lua_Integer>(value));
+        else if constexpr (std::is_floating_point_v<Plain<T>>)
+            ::lua_pushnumber(L, static_cast<lua_Number>(value));
+        else if constexpr (std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*>)
+            ::lua_pushstring(L, value);
+        else
+            ::lua_pushlstring(L, value.data(), value.size());
+    }
+
+    /**
+     * @brief Checks if the Lua value at the given index can be read as T.
+     * @tparam T Type to check for.
+     * @param L Lua state.
+     * @param index Index of the Lua value on the stack.
+     * @return True if the value can be read as T.
+     */
+    template<typename T>
+    static bool check(lua_State* L, int index)
+    {
+        if constexpr (Traits<Plain<T>>::isOptional)
+            return lua_isnoneornil(L, index) || check<typename Traits<Plain<T>>::Element>(L, index);
+        else if constexpr (Traits<Plain<T>>::isArray)
+        {
+            using Element = typename Traits<Plain<T>>::Element;
+            static_assert(std::is_arithmetic_v<Element>, "Only arrays of numbers can be read from the lua stack");
+            if(!lua_istable(L, index))
+                return false;
+
+            index = ::lua_absindex(L, index);
+            lua_Unsigned len = ::lua_rawlen(L, index);
+            if(len > INT_MAX)
+                return false;
+            for(lua_Integer i = 1; i <= static_cast<lua_Integer>(len); i++)
+            {
+                ::lua_rawgeti(L, index, i);
+                bool valid = check<Element>(L, -1);
+                lua_pop(L, 1);
+                if(!valid)
+                    return false;
+            }
+            return true;
+        }
+        else if constexpr (!isSupported<T>)
+            static_assert(isSupported<T>, "Type can not be read from the lua stack");
+        else if constexpr (std::is_same_v<Plain<T>, bool>)
+            return lua_isboolean(L, index);
+        else if constexpr (isInteger<T>)
+        {
+            int isInt = 0;
+            lua_Integer value = ::lua_tointegerx(L, index, &isInt);
+            return isInt && inRange<T>(value);
+        }
+        else if constexpr (std::is_floating_point_v<Plain<T>>)
+            return ::lua_isnumber(L, index);
+        else
+            return ::lua_type(L, index) == LUA_TSTRING;
+    }
+
+    /**
+     * @brief Checks and reads the Lua value at the given index in one pass, arrays are validated while they are copied.
+     * @tparam T Type to read.
+     * @param L Lua state.
+     * @param index Index of the Lua value on the stack.
+     * @param value Receives the converted value, unspecified if the value can not be read as T.
+     * @return True if the value could be read as T.
+     */
+    template<typename T>
+    static bool tryRead(lua_State* L, int index, Value<T>& value)
+    {
+        if constexpr (Traits<Plain<T>>::isOptional)
+        {
+            if(lua_isnoneornil(L, index))
+            {
+                value = std::nullopt;
+                return true;
+            }
+            using Element = typename Traits<Plain<T>>::Element;
+            Value<Element> element{};
+            if(!tryRead<Element>(L, index, element))
+                return false;
+            value = std::move(element);
+            return true;
+        }
+        else if constexpr (Traits<Plain<T>>::isArray)
+        {
+            using Element = typename Traits<Plain<T>>::Element;
+            static_assert(std::is_arithmetic_v<Element>, "Only arrays of numbers can be read from the lua stack");
+            if(!lua_istable(L, index))
+                return false;
+
+            index = ::lua_absindex(L, index);
+            lua_Unsigned len = ::lua_rawlen(L, index);
+            if(len > INT_MAX)
+                return false;
+            auto count = static_cast<unsigned int>(len);
+            value.resize(count);
+            unsigned int done = 0;
+            if constexpr (std::is_same_v<Element, lua_Number>)
+                done = ::lua_rawgetnumbers(L, index, value.data(), count);
+            else if constexpr (std::is_same_v<Element, lua_Integer>)
+                done = ::lua_rawgetintegers(L, index, value.data(), count);
+            // the bulk read stops at the first element it can not take as is, e.g. a numeric string, the rest is converted one by one
+            for(; done < count; done++)
+            {
+                ::lua_rawgeti(L, index, static_cast<lua_Integer>(done) + 1);
+                Value<Element> element{};
+                bool valid = tryRead<Element>(L, -1, element);
+                lua_pop(L, 1);
+                if(!valid)
+                    return false;
+                value[done] = element;
+            }
+            return true;
+        }
+        else if constexpr (!isSupported<T>)
+            static_assert(isSupported<T>, "Type can not be read from the lua stack");
+        else if constexpr (std::is_same_v<Plain<T>, bool>)
+        {
+            if(!lua_isboolean(L, index))
+                return false;
+            value = ::lua_toboolean(L, index) != 0;
+            return true;
+        }
+        else if constexpr (isInteger<T>)
+        {
+            int isInt = 0;
+            lua_Integer integer = ::lua_tointegerx(L, index, &isInt);
+            if(!isInt || !inRange<T>(integer))
+                return false;
+            value = static_cast<Plain<T>>(integer);
+            return true;
+        }
+        else if constexpr (std::is_floating_point_v<Plain<T>>)
+        {
+            int isNum = 0;
+            lua_Number number = ::lua_tonumberx(L, index, &isNum);
+            if(!isNum)
+                return false;
+            value = static_cast<Plain<T>>(number);
+            return true;
+        }
+        else
+        {
+            if(::lua_type(L, index) != LUA_TSTRING)
+                return false;
+            value = read<T>(L, index);
+            return true;
+        }
+    }
+
+    /**
+     * @brief Reads the Lua value at the given index as T. The value should be checked with check first.
+     * @tparam T Type to read.
+     * @param L Lua state.
+     * @param index Index of the Lua value on the stack.
+     * @return The converted value. Views stay valid as long as the Lua value is reachable.
+     */
+    template<typename T>
+    static Value<T> read(lua_State* L, int index)
+    {
+        if constexpr (Traits<Plain<T>>::isOptional)
+        {
+            if(lua_isnoneornil(L, index))
+                return std::nullopt;
+            return read<typename Traits<Plain<T>>::Element>(L, index);
+        }
+        else if constexpr (Traits<Plain<T>>::isArray)
+        {
+            using Element = typename Traits<Plain<T>>::Element;
+            index = ::lua_absindex(L, index);
+            auto len = static_cast<lua_Integer>(std::min<lua_Unsigned>(::lua_rawlen(L, index), INT_MAX));
+            if constexpr (std::is_same_v<Element, lua_Number> || std::is_same_v<Element, lua_Integer>)
+            {
+                std::vector<Element> values(static_cast<std::size_t>(len));
+                if constexpr (std::is_same_v<Element, lua_Number>)
+                    ::lua_rawgetnumbers(L, index, values.data(), static_cast<unsigned int>(len));
+                else
+                    ::lua_rawgetintegers(L, index, values.data(), static_cast<unsigned int>(len));
+                return values;
+            }
+            else
+            {
+                std::vector<Element> values;
+                values.reserve(static_cast<std::size_t>(len));
+                for(lua_Integer i = 1; i <= len; i++)
+                {
+                    ::lua_rawgeti(L, index, i);
+                    values.push_back(read<Element>(L, -1));
+                    lua_pop(L, 1);
+                }
+                return values;
+            }
+        }
+        else if constexpr (!isSupported<T>)
+            static_assert(isSupported<T>, "Type can not be read from the lua stack");
+        else if constexpr (std::is_same_v<Plain<T>, bool>)
+            return ::lua_toboolean(L, index) != 0;
+        else if constexpr (isInteger<T>)
+            return static_cast<Plain<T>>(::lua_tointeger(L, index));
+        else if constexpr (std::is_floating_point_v<Plain<T>>)
+            return static_cast<Plain<T>>(::lua_tonumber(L, index));
+        else if constexpr (std::is_same_v<std::decay_t<T>, const char*>)
+            return ::lua_tostring(L, index);
+        else
+        {
+            std::size_t len = 0;
+            const char* str = ::lua_tolstring(L, index, &len);
+            return Plain<T>(str, len);
+        }
+    }
+
+    /**
+     * @brief Retrieves the Lua type name expected for T, used in error messages.
+     * @tparam T Type to describe.
+     * @return Name of the expected Lua type.
+     */
+    template<typename T>
+    static constexpr const char* typeName()
+    {
+        if constexpr (Traits<Plain<T>>::isOptional)
+            return typeName<typename Traits<Plain<T>>::Element>();
+        else if constexpr (Traits<Plain<T>>::isArray)
+            return "array of numbers";
+        else if constexpr (std::is_same_v<Plain<T>, bool>)
+            return "boolean";
+        else if constexpr (isInteger<T>)
+            return "integer";
+        else if constexpr (std::is_floating_point_v<Plain<T>>)
+            return "number";
+        else
+            return "string";
+    }
+
+    /**
+     * @brief Reads the error object of a failed call, e.g. raised by error({}), which need not be a string.
+     * @param L Lua state.
+     * @param index Stack index of the error object.
+     * @return The message or the type of the error object if it is neither a string nor a number.
+     */
+    static std::string errorMessage(lua_State* L, int index)
+    {
+        std::size_t len = 0;
+        if(const char* msg = ::lua_tolstring(L, index, &len))
+            return std::string(msg, len);
+        return std::string("(error object is a ").append(luaL_typename(L, index)).append(" value)");
+    }
+};
+
+#endif // LUA_STACK_H
@@ -0,0 +1,174 @@
+#include "luaStatePool.h"
+
+#include <utility>
+
+PooledLuaScript::PooledLuaScript(LuaStatePool* pool, std::unique_ptr<LuaScript> script)
+: mPool(pool), mScript(std::move(script))
+{}
+
+PooledLuaScript::PooledLuaScript(PooledLuaScript&& other) noexcept
+: mPool(std::exchange(other.mPool, nullptr)), mScript(std::move(other.mScript))
+{}
+
+PooledLuaScript& PooledLuaScript::operator=(PooledLuaScript&& other) noexcept
+{
+    if(this != &other)
+    {
+        release();
+        mPool = std::exchange(other.mPool, nullptr);
+        mScript = std::move(other.mScript);
+    }
+    return *this;
+}
+
+PooledLuaScript::~PooledLuaScript()
+{
+    release();
+}
+
+LuaScript* PooledLuaScript::get() const
+{
+    return mScript.get();
+}
+
+LuaScript* PooledLuaScript::operator->() const
+{
+    return mScript.get();
+}
+
+LuaScript& PooledLuaScript::operator*() const
+{
+    return *mScript;
+}
+
+PooledLuaScript::operator bool() const
+{
+    return mScript != nullptr;
+}
+
+void PooledLuaScript::release()
+{
+    if(mPool && mScript)
+        mPool->release(std::move(mScript));
+    mScript.reset();
+    mPool = nullptr;
+}
+
+LuaStatePool::LuaStatePool(std::size_t libs, const std::filesystem::path& path, InitFunc init, std::size_t maxIdle)
+: mPath(path), mLibs(libs), mInit(std::move(init)), mMaxIdle(maxIdle)
+{}
+
+FuncInfo LuaStatePool::prewarm(std::size_t count)
+{
+    while(available() < count)
+    {
+        std::unique_ptr<LuaScript> script;
+        auto info = createScript(script);
+        if(!info)
+            return info;
+
+        std::scoped_lock lock(mMutex);
+        mFree.push_back(std::move(script));
+    }
+    return FuncInfo(FuncInfoType::OK);
+}
+
+FuncInfo LuaStatePool::acquire(PooledLuaScript& script)
+{
+    returnRetired();
+    {
+        std::scoped_lock lock(mMutex);
+        if(!mFree.empty())
+        {
+            script = PooledLuaScript(this, std::move(mFree.back()));
+            mFree.pop_back();
+            return FuncInfo(FuncInfoType::OK);
+        }
+    }
+
+    std::unique_ptr<LuaScript> created;
+    auto info = createScript(created);
+    script = info ? PooledLuaScript(this, std::move(created)) : PooledLuaScript();
+    return info;
+}
+
+PooledLuaScript LuaStatePool::acquire()
+{
+    PooledLuaScript script;
+    acquire(script);
+    return script;
+}
+
+void LuaStatePool::release(std::unique_ptr<LuaScript> script)
+{
+    if(!script)
+        return;
+    if(script->isExecuting())
+    {
+        // the caller is still inside the script, e.g. in a registered function, closing it now would free the running state
+        std::scoped_lock lock(mMutex);
+        mRetired.push_back(Retired{std::move(script), std::this_thread::get_id()});
+        return;
+    }
+    returnRetired();
+    if(!script->resetToSnapshot())
+        return;
+
+    std::scoped_lock lock(mMutex);
+    if(mMaxIdle == 0 || mFree.size() < mMaxIdle)
+        mFree.push_back(std::move(script));
+}
+
+void LuaStatePool::returnRetired()
+{
+    std::vector<std::unique_ptr<LuaScript>> returned;
+    {
+        std::scoped_lock lock(mMutex);
+        auto thread = std::this_thread::get_id();
+        for(auto iter = mRetired.begin(); iter != mRetired.end();)
+        {
+            if(iter->thread == thread && !iter->script->isExecuting())
+            {
+                returned.push_back(std::move(iter->script));
+                iter = mRetired.erase(iter);
+            }
+            else
+                ++iter;
+        }
+    }
+    for(auto& script : returned)
+        release(std::move(script));
+}
+
+std::size_t LuaStatePool::available() const
+{
+    std::scoped_lock lock(mMutex);
+    return mFree.size();
+}
+
+FuncInfo LuaStatePool::createScript(std::unique_ptr<LuaScript>& script) const
+{
+    script = std::make_unique<LuaScript>(mPath, mLibs);
+    if(mInit)
+    {
+        auto info = mInit(*script);
+        if(!info)
+        {
+            script.reset();
+            return info;
+        }
+    }
+
+    if(!mPath.empty())
+    {
+        auto info = script->compile();
+        if(!info)
+        {
+            script.reset();
+            return info;
+        }
+    }
+
+    script->takeSnapshot();
+    return FuncInfo(FuncInfoType::OK);
+}
@@ -0,0 +1,131 @@
+#ifndef LUA_STATE_POOL_H
+#define LUA_STATE_POOL_H
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "luaScript.h"
+#include "funcInfo.h"
+
+class LuaStatePool;
+
+/**
+ * @class PooledLuaScript
+ * @brief A LuaScript checked out of a LuaStatePool. The script is reset and handed back to the pool on destruction.
+ */
+class PooledLuaScript
+{
+private:
+    LuaStatePool* mPool = nullptr; /**< Pool the script is returned to. */
+    std::unique_ptr<LuaScript> mScript = nullptr; /**< Checked out script. */
+
+public:
+    PooledLuaScript() = default;
+    PooledLuaScript(LuaStatePool* pool, std::unique_ptr<LuaScript> script);
+    PooledLuaScript(const PooledLuaScript&) = delete;
+    PooledLuaScript& operator=(const PooledLuaScript&) = delete;
+    PooledLuaScript(PooledLuaScript&& other) noexcept;
+    PooledLuaScript& operator=(PooledLuaScript&& other) noexcept;
+
+    /**
+     * @brief Destructor. Returns the script to its pool.
+     */
+    ~PooledLuaScript();
+
+    LuaScript* get() const;
+    LuaScript* operator->() const;
+    LuaScript& operator*() const;
+    explicit operator bool() const;
+
+    /**
+     * @brief Returns the script to its pool before the handle is destroyed.
+     */
+    void release();
+};
+
+/**
+ * @class LuaStatePool
+ * @brief A thread safe pool of prewarmed LuaScript instances.
+ *
+ * Every state is created with the configured libraries, initialized by the optional init callback
+ * (e.g. to register functions) and then compiled from the configured script. The state at that
+ * point is recorded with LuaScript::takeSnapshot and restored whenever a script returns to the pool.
+ */
+class LuaStatePool
+{
+public:
+    using InitFunc = std::function<FuncInfo(LuaScript&)>;
+
+private:
+    struct Retired
+    {
+        std::unique_ptr<LuaScript> script = nullptr; /**< Script released from inside one of its calls. */
+        std::thread::id thread = {}; /**< Thread running the call, only it may check when the call returned. */
+    };
+
+    mutable std::mutex mMutex; /**< Guards the free and the retired list. */
+    std::vector<std::unique_ptr<LuaScript>> mFree = {}; /**< Scripts that are ready to be checked out. */
+    std::vector<Retired> mRetired = {}; /**< Released scripts whose call is still running. */
+    std::filesystem::path mPath = ""; /**< Script compiled into every state. Empty for none. */
+    std::size_t mLibs = Lua_lib_all; /**< Bitmask of the libraries opened in every state. */
+    InitFunc mInit = nullptr; /**< Callback run on every new state before it is compiled. */
+    std::size_t mMaxIdle = 0; /**< Maximum number of idle scripts kept. 0 for no limit. */
+
+public:
+    /**
+     * @brief Constructor with the libraries to open and the script to compile in every state.
+     * @param libs Bitmask to open the lua libraries.
+     * @param path Path to the Lua script file. Empty to compile nothing.
+     * @param init Callback run on every new state before it is compiled (optional).
+     * @param maxIdle Maximum number of idle scripts kept by the pool. 0 for no limit.
+     */
+    explicit LuaStatePool(std::size_t libs = Lua_lib_all, const std::filesystem::path& path = "",
+                          InitFunc init = nullptr, std::size_t maxIdle = 0);
+
+    LuaStatePool(const LuaStatePool&) = delete;
+    LuaStatePool& operator=(const LuaStatePool&) = delete;
+
+    /**
+     * @brief Creates scripts until at least count scripts are idle.
+     * @param count Number of idle scripts.
+     */
+    FuncInfo prewarm(std::size_t count);
+
+    /**
+     * @brief Checks out a script. A new script is created if no idle script is available.
+     * @param script Receives the checked out script. It is empty if a new script could not be created.
+     * @return The error of the init callback or of the compilation if a new script could not be created.
+     */
+    FuncInfo acquire(PooledLuaScript& script);
+
+    /**
+     * @brief Checks out a script. A new script is created if no idle script is available.
+     * @return The checked out script. The handle is empty if a new script could not be created.
+     */
+    PooledLuaScript acquire();
+
+    /**
+     * @brief Resets the script to its baseline and puts it back into the pool.
+     * A script released from inside one of its calls is kept until the next acquire or release on the same
+     * thread after the call returned, and returned then. A script that can not be reset is closed.
+     * @param script Script previously checked out of this pool.
+     */
+    void release(std::unique_ptr<LuaScript> script);
+
+    /**
+     * @brief Retrieves the number of idle scripts.
+     * @return Number of idle scripts.
+     */
+    std::size_t available() const;
+
+private:
+    FuncInfo createScript(std::unique_ptr<LuaScript>& script) const;
+    void returnRetired();
+};
+
+#endif // LUA_STATE_POOL_H
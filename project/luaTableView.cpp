@@ -0,0 +1,149 @@
+#include "luaTableView.h"
+
+#include <utility>
+
+LuaTableView::LuaTableView(lua_State* state, int index)
+{
+    if(!lua_istable(state, index))
+        return;
+
+    L = state;
+    ::lua_pushvalue(L, index);
+    mRef = ::luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+LuaTableView::LuaTableView(LuaTableView&& other) noexcept
+: L(std::exchange(other.L, nullptr)), mRef(std::exchange(other.mRef, LUA_NOREF))
+{}
+
+LuaTableView& LuaTableView::operator=(LuaTableView&& other) noexcept
+{
+    if(this != &other)
+    {
+        release();
+        L = std::exchange(other.L, nullptr);
+        mRef = std::exchange(other.mRef, LUA_NOREF);
+    }
+    return *this;
+}
+
+LuaTableView::~LuaTableView()
+{
+    release();
+}
+
+LuaTableView LuaTableView::operator[](std::string_view key) const&
+{
+    if(!isValid())
+        return LuaTableView();
+    ::lua_rawgeti(L, LUA_REGISTRYINDEX, mRef);
+    ::lua_pushlstring(L, key.data(), key.size());
+    ::lua_rawget(L, -2);
+    return popTable();
+}
+
+LuaTableView LuaTableView::operator[](std::string_view key) &&
+{
+    if(!isValid())
+        return LuaTableView();
+    ::lua_rawgeti(L, LUA_REGISTRYINDEX, mRef);
+    ::lua_pushlstring(L, key.data(), key.size());
+    ::lua_rawget(L, -2);
+    return moveTable();
+}
+
+LuaTableView LuaTableView::operator[](long long index) const&
+{
+    if(!isValid())
+        return LuaTableView();
+    ::lua_rawgeti(L, LUA_REGISTRYINDEX, mRef);
+    ::lua_rawgeti(L, -1, index);
+    return popTable();
+}
+
+LuaTableView LuaTableView::operator[](long long index) &&
+{
+    if(!isValid())
+        return LuaTableView();
+    ::lua_rawgeti(L, LUA_REGISTRYINDEX, mRef);
+    ::lua_rawgeti(L, -1, index);
+    return moveTable();
+}
+
+int LuaTableView::type(std::string_view key) const
+{
+    if(!isValid())
+        return LUA_TNONE;
+    ::lua_rawgeti(L, LUA_REGISTRYINDEX, mRef);
+    ::lua_pushlstring(L, key.data(), key.size());
+    int type = ::lua_rawget(L, -2);
+    lua_pop(L, 2);
+    return type;
+}
+
+int LuaTableView::type(long long index) const
+{
+    if(!isValid())
+        return LUA_TNONE;
+    ::lua_rawgeti(L, LUA_REGISTRYINDEX, mRef);
+    int type = ::lua_rawgeti(L, -1, index);
+    lua_pop(L, 2);
+    return type;
+}
+
+std::size_t LuaTableView::size() const
+{
+    if(!isValid())
+        return 0;
+    ::lua_rawgeti(L, LUA_REGISTRYINDEX, mRef);
+    auto len = static_cast<std::size_t>(::lua_rawlen(L, -1));
+    lua_pop(L, 1);
+    return len;
+}
+
+bool LuaTableView::isValid() const
+{
+    return L && mRef != LUA_NOREF && mRef != LUA_REFNIL;
+}
+
+LuaTableView::operator bool() const
+{
+    return isValid();
+}
+
+void LuaTableView::push(lua_State* state) const
+{
+    if(isValid())
+        ::lua_rawgeti(state, LUA_REGISTRYINDEX, mRef);
+    else
+        ::lua_pushnil(state);
+}
+
+LuaTableView LuaTableView::popTable() const
+{
+    LuaTableView view(L, -1);
+    lua_pop(L, 2);
+    return view;
+}
+
+LuaTableView LuaTableView::moveTable()
+{
+    // the nested table replaces the parent in its registry slot, so no new reference is taken
+    if(!lua_istable(L, -1))
+    {
+        lua_pop(L, 2);
+        release();
+        return LuaTableView();
+    }
+    ::lua_rawseti(L, LUA_REGISTRYINDEX, mRef);
+    lua_pop(L, 1);
+    return std::move(*this);
+}
+
+void LuaTableView::release()
+{
+    if(L && mRef != LUA_NOREF)
+        ::luaL_unref(L, LUA_REGISTRYINDEX, mRef);
+    L = nullptr;
+    mRef = LUA_NOREF;
+}
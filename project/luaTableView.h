@@ -0,0 +1,144 @@
+#ifndef LUA_TABLE_VIEW_H
+#define LUA_TABLE_VIEW_H
+
+#include <lua.hpp>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "luaStack.h"
+
+/**
+ * @class LuaTableView
+ * @brief A lazy view of a Lua table that reads fields directly from the Lua state.
+ *
+ * The view holds a registry reference to the table, so nothing is copied up front. Fields are resolved on demand
+ * with lua_rawget / lua_rawgeti, nested tables are returned as views themselves. The view must not outlive the
+ * Lua state.
+ */
+class LuaTableView
+{
+private:
+    lua_State* L = nullptr; /**< Lua state the table belongs to. */
+    int mRef = LUA_NOREF; /**< Registry reference of the table. */
+
+public:
+    /**
+     * @brief Default constructor. Creates an invalid view.
+     */
+    LuaTableView() = default;
+
+    /**
+     * @brief Creates a view of the table at the given stack index.
+     * @param state Lua state.
+     * @param index Index of the table on the stack.
+     */
+    LuaTableView(lua_State* state, int index);
+
+    LuaTableView(const LuaTableView&) = delete;
+    LuaTableView& operator=(const LuaTableView&) = delete;
+    LuaTableView(LuaTableView&& other) noexcept;
+    LuaTableView& operator=(LuaTableView&& other) noexcept;
+
+    /**
+     * @brief Destructor. Releases the registry reference.
+     */
+    ~LuaTableView();
+
+    /**
+     * @brief Resolves a nested table by key.
+     * @param key Key of the nested table.
+     * @return View of the nested table. The view is invalid if the field is not a table.
+     */
+    LuaTableView operator[](std::string_view key) const&;
+
+    /**
+     * @brief Resolves a nested table by key, reusing the registry reference of this temporary view.
+     * Chains like view["a"]["b"] only anchor the final table.
+     */
+    LuaTableView operator[](std::string_view key) &&;
+
+    /**
+     * @brief Resolves a nested table by index.
+     * @param index Index of the nested table.
+     * @return View of the nested table. The view is invalid if the field is not a table.
+     */
+    LuaTableView operator[](long long index) const&;
+
+    /**
+     * @brief Resolves a nested table by index, reusing the registry reference of this temporary view.
+     */
+    LuaTableView operator[](long long index) &&;
+
+    /**
+     * @brief Reads a field by key.
+     * @tparam T Type of the field, any type supported by LuaStack. Views of strings stay valid while the table holds them.
+     * @param key Key of the field.
+     * @return The value or std::nullopt if the field is missing or has a different type.
+     */
+    template<typename T>
+    std::optional<LuaStack::Value<T>> get(std::string_view key) const
+    {
+        if(!isValid())
+            return std::nullopt;
+        ::lua_rawgeti(L, LUA_REGISTRYINDEX, mRef);
+        ::lua_pushlstring(L, key.data(), key.size());
+        ::lua_rawget(L, -2);
+        return popValue<T>();
+    }
+
+    /**
+     * @brief Reads a field by index.
+     * @tparam T Type of the field, any type supported by LuaStack.
+     * @param index Index of the field.
+     * @return The value or std::nullopt if the field is missing or has a different type.
+     */
+    template<typename T>
+    std::optional<LuaStack::Value<T>> get(long long index) const
+    {
+        if(!isValid())
+            return std::nullopt;
+        ::lua_rawgeti(L, LUA_REGISTRYINDEX, mRef);
+        ::lua_rawgeti(L, -1, index);
+        return popValue<T>();
+    }
+
+    /**
+     * @brief Retrieves the Lua type of a field, e.g. LUA_TNUMBER. LUA_TNIL for missing fields.
+     */
+    int type(std::string_view key) const;
+    int type(long long index) const;
+
+    /**
+     * @brief Retrieves the length of the array part (lua_rawlen).
+     */
+    std::size_t size() const;
+
+    bool isValid() const;
+    explicit operator bool() const;
+
+    /**
+     * @brief Pushes the viewed table onto the stack, nil if the view is invalid.
+     * @param state Lua state or thread to push onto. Must belong to the Lua state of the view.
+     */
+    void push(lua_State* state) const;
+
+private:
+    LuaTableView popTable() const;
+    LuaTableView moveTable();
+    void release();
+
+    template<typename T>
+    std::optional<LuaStack::Value<T>> popValue() const
+    {
+        std::optional<LuaStack::Value<T>> value;
+        LuaStack::Value<T> read{};
+        if(!lua_isnil(L, -1) && LuaStack::tryRead<T>(L, -1, read))
+            value = std::move(read);
+        lua_pop(L, 2);
+        return value;
+    }
+};
+
+#endif // LUA_TABLE_VIEW_H
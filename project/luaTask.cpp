@@ -0,0 +1,91 @@
+#include "luaTask.h"
+
+#include <utility>
+
+LuaTask::LuaTask(lua_State* state, lua_State* thread, int ref, std::string_view name)
+: L(state), mThread(thread), mRef(ref), mName(name)
+{}
+
+LuaTask::LuaTask(LuaTask&& other) noexcept
+: L(std::exchange(other.L, nullptr)), mThread(std::exchange(other.mThread, nullptr)),
+  mRef(std::exchange(other.mRef, LUA_NOREF)), mName(std::move(other.mName)),
+  mStatus(other.mStatus), mResultCount(std::exchange(other.mResultCount, 0))
+{}
+
+LuaTask& LuaTask::operator=(LuaTask&& other) noexcept
+{
+    if(this != &other)
+    {
+        release();
+        L = std::exchange(other.L, nullptr);
+        mThread = std::exchange(other.mThread, nullptr);
+        mRef = std::exchange(other.mRef, LUA_NOREF);
+        mName = std::move(other.mName);
+        mStatus = other.mStatus;
+        mResultCount = std::exchange(other.mResultCount, 0);
+    }
+    return *this;
+}
+
+LuaTask::~LuaTask()
+{
+    release();
+}
+
+void LuaTask::clearResults()
+{
+    if(mThread && mResultCount > 0)
+        lua_pop(mThread, mResultCount);
+    mResultCount = 0;
+}
+
+void LuaTask::setStatus(LuaTaskStatus status, int resultCount)
+{
+    mStatus = status;
+    mResultCount = resultCount;
+}
+
+lua_State* LuaTask::getThread() const
+{
+    return mThread;
+}
+
+std::string_view LuaTask::getName() const
+{
+    return mName;
+}
+
+LuaTaskStatus LuaTask::getStatus() const
+{
+    return mStatus;
+}
+
+int LuaTask::getResultCount() const
+{
+    return mResultCount;
+}
+
+bool LuaTask::isValid() const
+{
+    return L && mThread && mRef != LUA_NOREF;
+}
+
+bool LuaTask::isResumable() const
+{
+    return isValid() && (mStatus == LuaTaskStatus::READY || mStatus == LuaTaskStatus::YIELDED);
+}
+
+LuaTask::operator bool() const
+{
+    return isValid();
+}
+
+void LuaTask::release()
+{
+    if(L && mRef != LUA_NOREF)
+        ::luaL_unref(L, LUA_REGISTRYINDEX, mRef);
+    L = nullptr;
+    mThread = nullptr;
+    mRef = LUA_NOREF;
+    mResultCount = 0;
+}
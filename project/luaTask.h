@@ -0,0 +1,89 @@
+#ifndef LUA_TASK_H
+#define LUA_TASK_H
+
+#include <lua.hpp>
+#include <string>
+#include <string_view>
+
+/**
+ * @enum LuaTaskStatus
+ * @brief Execution state of a LuaTask.
+ */
+enum class LuaTaskStatus : int
+{
+    READY = 0, /**< Created and not resumed yet. */
+    YIELDED = 1, /**< Suspended by a yield, can be resumed. */
+    DONE = 2, /**< The function returned. */
+    FAILED = 3, /**< The function raised an error. */
+};
+
+/**
+ * @class LuaTask
+ * @brief A Lua function running in its own coroutine.
+ *
+ * The task owns a Lua thread created with lua_newthread and keeps it alive through a registry
+ * reference. It is created and resumed by LuaScript, which leaves the values passed to the last
+ * yield or returned by the function on the stack of the thread. The task must not outlive the
+ * LuaScript it was created from.
+ */
+class LuaTask
+{
+private:
+    lua_State* L = nullptr; /**< Main thread of the Lua state. */
+    lua_State* mThread = nullptr; /**< Thread the function runs in. */
+    int mRef = LUA_NOREF; /**< Registry reference that keeps the thread alive. */
+    std::string mName = ""; /**< Name of the function. */
+    LuaTaskStatus mStatus = LuaTaskStatus::READY; /**< Execution state. */
+    int mResultCount = 0; /**< Values yielded or returned by the last resume. */
+
+public:
+    /**
+     * @brief Default constructor. Creates an invalid task.
+     */
+    LuaTask() = default;
+
+    /**
+     * @brief Constructor with a thread that has the function to run pushed onto its stack.
+     * @param state Main thread of the Lua state.
+     * @param thread Thread the function runs in.
+     * @param ref Registry reference of the thread.
+     * @param name Name of the function.
+     */
+    LuaTask(lua_State* state, lua_State* thread, int ref, std::string_view name);
+
+    LuaTask(const LuaTask&) = delete;
+    LuaTask& operator=(const LuaTask&) = delete;
+    LuaTask(LuaTask&& other) noexcept;
+    LuaTask& operator=(LuaTask&& other) noexcept;
+
+    /**
+     * @brief Destructor. Releases the registry reference of the thread.
+     */
+    ~LuaTask();
+
+    /**
+     * @brief Pops the values of the last resume, so values for the next resume can be pushed.
+     */
+    void clearResults();
+
+    /**
+     * @brief Records the outcome of a resume.
+     * @param status New execution state.
+     * @param resultCount Values yielded or returned, on top of the stack of the thread.
+     */
+    void setStatus(LuaTaskStatus status, int resultCount);
+
+    lua_State* getThread() const;
+    std::string_view getName() const;
+    LuaTaskStatus getStatus() const;
+    int getResultCount() const;
+    bool isValid() const;
+    bool isResumable() const;
+
+    explicit operator bool() const;
+
+private:
+    void release();
+};
+
+#endif // LUA_TASK_H
@@ -0,0 +1,360 @@
+#include "luaTracer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t nameWords = LuaTracer::nameSize / sizeof(std::uint64_t);
+
+    /**
+     * A recorded span. The fields are atomics, so a buffer can be copied while its thread overwrites it.
+     */
+    struct Event
+    {
+        std::atomic<std::uint64_t> start = 0; /**< Start in nanoseconds of the steady clock. */
+        std::atomic<std::uint64_t> duration = 0; /**< Duration in nanoseconds. */
+        std::atomic<std::uint64_t> meta = 0; /**< Category in bits 0-7, error flag in bit 8, name length from bit 16. */
+        std::atomic<std::uint64_t> name[nameWords] = {}; /**< Name bytes. */
+    };
+
+    /**
+     * Ring buffer of one thread. Only its thread writes the events and the counters.
+     */
+    struct ThreadBuffer
+    {
+        std::unique_ptr<Event[]> events = nullptr; /**< Ring of capacity events. */
+        std::size_t capacity = 0; /**< Events in the ring. */
+        std::atomic<std::uint64_t> writing = 0; /**< Events whose write started. */
+        std::atomic<std::uint64_t> written = 0; /**< Events whose write completed. */
+        std::uint64_t generation = 0; /**< Generation of the tracer the buffer belongs to. */
+        std::uint32_t tid = 0; /**< Id of the thread in the trace. */
+        std::string threadName = ""; /**< Name of the thread, guarded by the registry mutex. */
+    };
+
+    /**
+     * Buffers of all threads that recorded since the last start or clear.
+     */
+    struct Registry
+    {
+        std::mutex mutex = {};
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers = {};
+        std::size_t capacity = LuaTracerConfig{}.bufferEvents;
+        std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        std::atomic<std::uint64_t> generation = 1;
+        std::uint32_t nextTid = 1;
+    };
+
+    Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    thread_local std::shared_ptr<ThreadBuffer> threadBuffer = nullptr;
+    thread_local std::uint32_t threadId = 0;
+    thread_local std::string threadName = "";
+
+    /**
+     * Attaches a buffer to the calling thread. Runs inside lua frames, e.g. in the gc hook, where an exception
+     * must not unwind, so nullptr is returned if the buffer can not be allocated and the event is dropped.
+     */
+    ThreadBuffer* attachThread() noexcept
+    {
+        try
+        {
+            Registry& reg = registry();
+            std::lock_guard lock(reg.mutex);
+            auto buffer = std::make_shared<ThreadBuffer>();
+            buffer->capacity = std::max<std::size_t>(reg.capacity, 1);
+            buffer->events.reset(new (std::nothrow) Event[buffer->capacity]);
+            if(!buffer->events)
+                return nullptr;
+            buffer->generation = reg.generation.load(std::memory_order_relaxed);
+            buffer->threadName = threadName;
+            reg.buffers.push_back(buffer);
+            if(threadId == 0)
+                threadId = reg.nextTid++;
+            buffer->tid = threadId;
+            threadBuffer = std::move(buffer);
+            return threadBuffer.get();
+        }
+        catch(const std::exception&)
+        {
+            return nullptr;
+        }
+    }
+
+    /**
+     * Nanoseconds of a time point relative to the clock epoch, clamped to zero.
+     */
+    std::uint64_t toNanoseconds(std::chrono::steady_clock::time_point time)
+    {
+        auto count = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        return static_cast<std::uint64_t>(std::max<std::int64_t>(count, 0));
+    }
+
+    /**
+     * Length of a name cut to the name size without splitting a UTF-8 sequence.
+     */
+    std::size_t cutName(std::string_view name)
+    {
+        if(name.size() <= LuaTracer::nameSize)
+            return name.size();
+        std::size_t length = LuaTracer::nameSize;
+        while(length > 0 && (static_cast<unsigned char>(name[length]) & 0xC0) == 0x80)
+            length--;
+        return length;
+    }
+
+    const char* categoryName(std::uint64_t category)
+    {
+        switch(static_cast<LuaTraceCategory>(category))
+        {
+        case LuaTraceCategory::COMPILE:
+            return "compile";
+        case LuaTraceCategory::SCRIPT:
+            return "script";
+        case LuaTraceCategory::NATIVE:
+            return "native";
+        case LuaTraceCategory::GC:
+            return "gc";
+        default:
+            return "host";
+        }
+    }
+
+    void writeEscaped(std::ostream& out, std::string_view text)
+    {
+        for(char c : text)
+        {
+            if(c == '"' || c == '\\')
+                out << '\\' << c;
+            else if(static_cast<unsigned char>(c) < 0x20)
+            {
+                constexpr char hex[] = "0123456789abcdef";
+                out << "\\u00" << hex[(c >> 4) & 0xF] << hex[c & 0xF];
+            }
+            else
+                out << c;
+        }
+    }
+
+    /**
+     * Writes nanoseconds as microseconds with three decimals, the unit of Chrome trace timestamps.
+     */
+    void writeMicroseconds(std::ostream& out, std::uint64_t nanoseconds)
+    {
+        char text[32];
+        auto end = std::to_chars(text, text + sizeof(text), nanoseconds / 1000).ptr;
+        *end++ = '.';
+        std::uint64_t fraction = nanoseconds % 1000;
+        *end++ = static_cast<char>('0' + fraction / 100);
+        *end++ = static_cast<char>('0' + fraction / 10 % 10);
+        *end++ = static_cast<char>('0' + fraction % 10);
+        out.write(text, end - text);
+    }
+
+    /**
+     * A copied event with its name decoded.
+     */
+    struct EventCopy
+    {
+        std::uint64_t start = 0;
+        std::uint64_t duration = 0;
+        std::uint64_t meta = 0;
+        char name[LuaTracer::nameSize] = {};
+    };
+
+    /**
+     * Copies the events of a buffer that are not overwritten while they are read, oldest first.
+     */
+    std::vector<EventCopy> copyEvents(const ThreadBuffer& buffer)
+    {
+        std::uint64_t written = buffer.written.load(std::memory_order_acquire);
+        std::uint64_t first = written > buffer.capacity ? written - buffer.capacity : 0;
+        std::vector<EventCopy> copies(static_cast<std::size_t>(written - first));
+        for(std::uint64_t i = first; i < written; i++)
+        {
+            const Event& event = buffer.events[i % buffer.capacity];
+            EventCopy& copy = copies[static_cast<std::size_t>(i - first)];
+            copy.start = event.start.load(std::memory_order_relaxed);
+            copy.duration = event.duration.load(std::memory_order_relaxed);
+            copy.meta = event.meta.load(std::memory_order_relaxed);
+            for(std::size_t word = 0; word < nameWords; word++)
+            {
+                std::uint64_t bytes = event.name[word].load(std::memory_order_relaxed);
+                std::memcpy(copy.name + word * sizeof(bytes), &bytes, sizeof(bytes));
+            }
+        }
+
+        // events whose slot was reused by a write that started meanwhile may be torn
+        std::atomic_thread_fence(std::memory_order_acquire);
+        std::uint64_t writing = buffer.writing.load(std::memory_order_relaxed);
+        std::uint64_t valid = writing > buffer.capacity ? writing - buffer.capacity : 0;
+        if(valid > first)
+            copies.erase(copies.begin(), copies.begin() + static_cast<std::ptrdiff_t>(std::min(valid, written) - first));
+        return copies;
+    }
+}
+
+void LuaTracer::start(const LuaTracerConfig& config)
+{
+    Registry& reg = registry();
+    {
+        std::lock_guard lock(reg.mutex);
+        reg.capacity = config.bufferEvents;
+    }
+    clear();
+    sEnabled.store(true, std::memory_order_relaxed);
+}
+
+void LuaTracer::stop()
+{
+    sEnabled.store(false, std::memory_order_relaxed);
+}
+
+void LuaTracer::record(LuaTraceCategory category, std::string_view name, std::chrono::steady_clock::time_point start,
+                       std::chrono::steady_clock::time_point end, bool failed) noexcept
+{
+    ThreadBuffer* buffer = threadBuffer.get();
+    if(buffer == nullptr || buffer->generation != registry().generation.load(std::memory_order_relaxed))
+        buffer = attachThread();
+    if(buffer == nullptr)
+        return;
+
+    std::uint64_t index = buffer->writing.load(std::memory_order_relaxed);
+    buffer->writing.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Event& event = buffer->events[index % buffer->capacity];
+    std::uint64_t startNs = toNanoseconds(start);
+    std::uint64_t endNs = toNanoseconds(end);
+    std::size_t length = cutName(name);
+    char bytes[nameSize] = {};
+    std::memcpy(bytes, name.data(), length);
+    event.start.store(startNs, std::memory_order_relaxed);
+    event.duration.store(endNs > startNs ? endNs - startNs : 0, std::memory_order_relaxed);
+    event.meta.store(static_cast<std::uint64_t>(category) | (failed ? 0x100U : 0U) | (static_cast<std::uint64_t>(length) << 16),
+                     std::memory_order_relaxed);
+    for(std::size_t word = 0; word < nameWords; word++)
+    {
+        std::uint64_t value = 0;
+        std::memcpy(&value, bytes + word * sizeof(value), sizeof(value));
+        event.name[word].store(value, std::memory_order_relaxed);
+    }
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+void LuaTracer::setThreadName(std::string_view name)
+{
+    Registry& reg = registry();
+    std::lock_guard lock(reg.mutex);
+    threadName = name;
+    if(threadBuffer)
+        threadBuffer->threadName = threadName;
+}
+
+void LuaTracer::clear()
+{
+    Registry& reg = registry();
+    std::lock_guard lock(reg.mutex);
+    // threads notice the new generation on their next event and attach a new buffer
+    reg.buffers.clear();
+    reg.generation.fetch_add(1, std::memory_order_relaxed);
+    reg.epoch = std::chrono::steady_clock::now();
+}
+
+std::uint64_t LuaTracer::getDropped()
+{
+    Registry& reg = registry();
+    std::lock_guard lock(reg.mutex);
+    std::uint64_t dropped = 0;
+    for(const auto& buffer : reg.buffers)
+    {
+        std::uint64_t written = buffer->written.load(std::memory_order_relaxed);
+        if(written > buffer->capacity)
+            dropped += written - buffer->capacity;
+    }
+    return dropped;
+}
+
+void LuaTracer::writeChromeTrace(std::ostream& out)
+{
+    Registry& reg = registry();
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::vector<std::string> threadNames;
+    std::uint64_t epoch = 0;
+    {
+        std::lock_guard lock(reg.mutex);
+        buffers = reg.buffers;
+        for(const auto& buffer : buffers)
+            threadNames.push_back(buffer->threadName);
+        epoch = toNanoseconds(reg.epoch);
+    }
+
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&out, &first]()
+    {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+    for(std::size_t i = 0; i < buffers.size(); i++)
+    {
+        const ThreadBuffer& buffer = *buffers[i];
+        if(!threadNames[i].empty())
+        {
+            separator();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.tid << ",\"args\":{\"name\":\"";
+            writeEscaped(out, threadNames[i]);
+            out << "\"}}";
+        }
+
+        for(const EventCopy& event : copyEvents(buffer))
+        {
+            // spans that started before the trace are cut at its start
+            std::uint64_t start = std::max(event.start, epoch);
+            std::uint64_t end = std::max(event.start + event.duration, start);
+            separator();
+            out << "{\"name\":\"";
+            writeEscaped(out, std::string_view(event.name, std::min<std::size_t>(event.meta >> 16, nameSize)));
+            out << "\",\"cat\":\"" << categoryName(event.meta & 0xFF) << "\",\"ph\":\"X\",\"ts\":";
+            writeMicroseconds(out, start - epoch);
+            out << ",\"dur\":";
+            writeMicroseconds(out, end - start);
+            out << ",\"pid\":1,\"tid\":" << buffer.tid;
+            if(event.meta & 0x100)
+                out << ",\"args\":{\"error\":true}";
+            out << '}';
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+std::string LuaTracer::getChromeTrace()
+{
+    std::ostringstream out;
+    writeChromeTrace(out);
+    return out.str();
+}
+
+LuaTraceSpan::LuaTraceSpan(std::string_view name, LuaTraceCategory category)
+: mName(name), mCategory(category), mActive(LuaTracer::isEnabled())
+{
+    if(mActive)
+        mStart = std::chrono::steady_clock::now();
+}
+
+LuaTraceSpan::~LuaTraceSpan()
+{
+    if(mActive)
+        LuaTracer::record(mCategory, mName, mStart, std::chrono::steady_clock::now());
+}
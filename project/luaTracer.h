@@ -0,0 +1,144 @@
+#ifndef LUA_TRACER_H
+#define LUA_TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/**
+ * @enum LuaTraceCategory
+ * @brief What a traced span measures, written as the "cat" field of the trace event.
+ */
+enum class LuaTraceCategory : std::uint8_t
+{
+    COMPILE, /**< compile or compileString, named after the script file. */
+    SCRIPT, /**< A lua function called with doFunc, call or callBatch, or a task resume. */
+    NATIVE, /**< A C++ function registered with regFunc, called from lua. */
+    GC, /**< A step or a full cycle of the garbage collector. */
+    HOST /**< A span of the application, see LuaTraceSpan. */
+};
+
+/**
+ * @struct LuaTracerConfig
+ * @brief Buffer size of the LuaTracer.
+ */
+struct LuaTracerConfig
+{
+    std::size_t bufferEvents = 65536; /**< Events kept per thread, older ones are overwritten. 64 bytes each. */
+};
+
+/**
+ * @class LuaTracer
+ * @brief Process wide recorder of timed spans, written as Chrome trace JSON.
+ *
+ * Every thread records into its own ring buffer, allocated on its first event after start, so recording
+ * takes no lock and the buffer keeps the most recent events. The trace can be written at any time, also
+ * while other threads record; events that are overwritten while they are copied are left out.
+ *
+ * The output loads into chrome://tracing, ui.perfetto.dev and speedscope.
+ */
+class LuaTracer
+{
+public:
+    static constexpr std::size_t nameSize = 40; /**< Bytes of a span name that are kept, longer names are cut. */
+
+private:
+    static inline std::atomic<bool> sEnabled = false; /**< Set between start and stop. */
+
+public:
+    /**
+     * @brief Discards all recorded events and starts recording.
+     * @param config Buffer size.
+     */
+    static void start(const LuaTracerConfig& config = {});
+
+    /**
+     * @brief Stops recording. The recorded events stay readable.
+     */
+    static void stop();
+
+    /**
+     * @brief Checks if spans are recorded. Checked before a span is timed.
+     */
+    static bool isEnabled()
+    {
+        return sEnabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Records a span into the buffer of the calling thread.
+     * Never throws, it is called inside lua frames. The event is dropped if the buffer of the thread can not be
+     * allocated.
+     * @param category What the span measures.
+     * @param name Name of the span, cut to nameSize bytes.
+     * @param start Start of the span.
+     * @param end End of the span.
+     * @param failed Marks the span with an error, e.g. a call that raised a lua error.
+     */
+    static void record(LuaTraceCategory category, std::string_view name, std::chrono::steady_clock::time_point start,
+                       std::chrono::steady_clock::time_point end, bool failed = false) noexcept;
+
+    /**
+     * @brief Names the calling thread in the trace, e.g. "worker 3".
+     * @param name Name of the thread.
+     */
+    static void setThreadName(std::string_view name);
+
+    /**
+     * @brief Discards all recorded events.
+     */
+    static void clear();
+
+    /**
+     * @brief Gets the number of events that were overwritten because a buffer was full.
+     */
+    static std::uint64_t getDropped();
+
+    /**
+     * @brief Writes the recorded events as Chrome trace JSON. Timestamps are relative to start.
+     * @param out Stream written to.
+     */
+    static void writeChromeTrace(std::ostream& out);
+
+    /**
+     * @brief Gets the recorded events as Chrome trace JSON.
+     * @return The document written by writeChromeTrace.
+     */
+    static std::string getChromeTrace();
+};
+
+/**
+ * @class LuaTraceSpan
+ * @brief Records a span from its construction to its destruction, e.g. of application work that should show
+ * up in the same timeline as the scripts.
+ */
+class LuaTraceSpan
+{
+private:
+    std::string_view mName = ""; /**< Name of the span, must outlive the span. */
+    LuaTraceCategory mCategory = LuaTraceCategory::HOST; /**< What the span measures. */
+    std::chrono::steady_clock::time_point mStart = {}; /**< Start of the span. */
+    bool mActive = false; /**< Set if the tracer was enabled at construction. */
+
+public:
+    /**
+     * @brief Constructor. Starts the span if the tracer is enabled.
+     * @param name Name of the span, e.g. a string literal. It must outlive the span.
+     * @param category What the span measures.
+     */
+    explicit LuaTraceSpan(std::string_view name, LuaTraceCategory category = LuaTraceCategory::HOST);
+
+    /**
+     * @brief Destructor. Records the span.
+     */
+    ~LuaTraceSpan();
+
+    LuaTraceSpan(const LuaTraceSpan&) = delete;
+    LuaTraceSpan& operator=(const LuaTraceSpan&) = delete;
+};
+
+#endif // LUA_TRACER_H
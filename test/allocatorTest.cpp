@@ -0,0 +1,42 @@
+#include "test.h"
+
+#include "luaAllocator.h"
+#include "luaScript.h"
+
+#include <cstring>
+#include <memory>
+
+namespace
+{
+    // chunks of this size can not be allocated, so the pool only gets memory from shrunk big blocks
+    constexpr std::size_t UnavailableChunk = std::size_t(1) << 46;
+
+    TestRegistrar shrinkWithoutPoolMemory("allocator/shrinkWithoutPoolMemory", []
+    {
+        LuaPoolAllocator pool(UnavailableChunk);
+        LUA_CHECK(pool.reallocate(nullptr, 0, 64) == nullptr);
+
+        auto* big = static_cast<char*>(pool.reallocate(nullptr, 0, 4096));
+        LUA_CHECK(big != nullptr);
+        std::memset(big, 'x', 4096);
+        auto* small = static_cast<char*>(pool.reallocate(big, 4096, 100));
+        LUA_CHECK(small == big && small[99] == 'x');
+
+        // the remainder of the shrunk block serves further small blocks
+        void* other = pool.reallocate(nullptr, 0, 200);
+        LUA_CHECK(other != nullptr && other != small);
+        pool.reallocate(other, 200, 0);
+        pool.reallocate(small, 100, 0);
+        pool.reset();
+    });
+
+    TestRegistrar poolServesScript("allocator/poolServesScript", []
+    {
+        auto pool = std::make_shared<LuaPoolAllocator>(1024);
+        LuaScript lua(pool);
+        LUA_CHECK(lua.compileString("local t = {}\n"
+                                    "for i = 1, 10000 do t[i] = ('x'):rep(i % 700) end\n"
+                                    "for i = 1, 10000 do t[i] = nil end\n"
+                                    "collectgarbage()\n"));
+    });
+}
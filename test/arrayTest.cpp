@@ -0,0 +1,36 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+#include <climits>
+#include <vector>
+
+namespace
+{
+    TestRegistrar oversizedArrayRejected("array/oversizedArrayRejected", []
+    {
+        LuaScript lua(Lua_lib_all);
+        lua_State* L = lua.getLuaState();
+        std::vector<double> values = {1.0, 2.0};
+        // only the size of the span is read before the array is rejected
+        std::span<const double> oversized(values.data(), static_cast<std::size_t>(INT_MAX) + 1);
+        LUA_CHECK(!lua.pushArray("big", oversized));
+        LUA_CHECK(!lua.pushArray(oversized));
+        LUA_CHECK(::lua_gettop(L) == 0);
+        LUA_CHECK(::lua_getglobal(L, "big") == LUA_TNIL);
+        lua_pop(L, 1);
+
+        LUA_CHECK(lua.pushArray("small", std::span<const double>(values)));
+        std::vector<double> read(4);
+        LUA_CHECK(lua.readArray("small", read) == 2 && read[1] == 2.0);
+    });
+
+    TestRegistrar oversizedBoundResult("array/oversizedBoundResult", []
+    {
+        LuaScript lua(Lua_lib_all);
+        std::vector<double> values = {1.0};
+        LUA_CHECK(lua.regFunc([&values]() { return std::span<const double>(values.data(), static_cast<std::size_t>(INT_MAX) + 1); }, "huge"));
+        LUA_CHECK(lua.compileString("local ok, err = pcall(huge)\n"
+                                    "assert(not ok and err:find('too large'))\n"));
+    });
+}
@@ -0,0 +1,75 @@
+#include "test.h"
+
+#include "luaAsync.h"
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace
+{
+    /** Coroutine that starts right away and is destroyed when it returns. */
+    struct Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    Detached awaitSum(LuaAsync& async, long long value, std::optional<long long>& result)
+    {
+        auto [sum] = co_await async.call<long long>("sum", value);
+        result = sum;
+    }
+
+    Detached awaitError(LuaAsync& async, std::string_view funcName, std::string& message)
+    {
+        try
+        {
+            co_await async.call<>(funcName);
+        }
+        catch(const std::runtime_error& e)
+        {
+            message = e.what();
+        }
+    }
+
+    TestRegistrar completesLater("async/completesLater", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LuaAsync async(lua);
+        LuaAsyncCompletion pending;
+        LUA_CHECK(async.regAsync([&pending](LuaScript&, LuaAsyncCompletion done) { pending = std::move(done); }, "fetch"));
+        LUA_CHECK(async.regAsync([](LuaScript& script, LuaAsyncCompletion done) { done.complete(script.toInteger(1) + 1); }, "plusOne"));
+        LUA_CHECK(lua.compileString("function sum(v) coroutine.yield() return fetch() + plusOne(v) end"));
+
+        // the plain yield continues right away, fetch suspends the coroutine until it is completed
+        std::optional<long long> result;
+        awaitSum(async, 20, result);
+        LUA_CHECK(!result && pending);
+        pending.complete(21);
+        LUA_CHECK(!pending && result == 42);
+        LUA_CHECK(lua.compileString("assert(not pcall(fetch))"));
+    });
+
+    TestRegistrar errorsThrow("async/errorsThrow", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LuaAsync async(lua);
+        LUA_CHECK(lua.compileString("function fail() error({}) end"));
+
+        std::string message;
+        awaitError(async, "fail", message);
+        LUA_CHECK(message.find("(error object is a table value)") != std::string::npos);
+        awaitError(async, "missing", message);
+        LUA_CHECK(message == "Failed to run function[missing] - global is not a function");
+    });
+}
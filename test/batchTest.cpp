@@ -0,0 +1,59 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+    TestRegistrar stringResultsBeforeError("batch/stringResultsBeforeError", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.regFunc("name"));
+        LUA_CHECK(lua.compileString("function name(i) if i == 3 then error('bad item') end return 'item ' .. i end"));
+        auto name = lua.prepare("name");
+
+        std::vector<std::tuple<int>> args = {{1}, {2}, {3}, {4}};
+        std::vector<std::string> results(args.size());
+        auto info = lua.callBatch(name, std::span(args), std::span(results));
+        LUA_CHECK(!info && info.getDesc().find("item 2: ") != std::string_view::npos);
+        LUA_CHECK(results[0] == "item 1" && results[1] == "item 2" && results[2].empty());
+        LUA_CHECK(lua_gettop(lua.getLuaState()) == 0);
+    });
+
+    TestRegistrar stringResultMismatch("batch/stringResultMismatch", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.regFunc("name"));
+        LUA_CHECK(lua.compileString("function name(i) if i == 2 then return {} end return 'item ' .. i end"));
+        auto name = lua.prepare("name");
+
+        std::vector<std::tuple<int>> args = {{1}, {2}, {3}};
+        std::vector<std::string> results(args.size());
+        auto info = lua.callBatch(name, std::span(args), std::span(results));
+        LUA_CHECK(!info && info.getDesc().find("item 1: returned value") != std::string_view::npos);
+        LUA_CHECK(results[0] == "item 1" && results[2].empty());
+
+        std::vector<std::tuple<int>> numbers = {{1}, {3}};
+        LUA_CHECK(lua.callBatch(name, std::span(numbers), std::span(results)));
+        LUA_CHECK(results[0] == "item 1" && results[1] == "item 3");
+        LUA_CHECK(lua_gettop(lua.getLuaState()) == 0);
+    });
+
+    TestRegistrar nonStringError("batch/nonStringError", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.regFunc("half"));
+        LUA_CHECK(lua.compileString("function half(i) if i == 2 then error({}) end return i / 2 end"));
+        auto half = lua.prepare("half");
+
+        std::vector<std::tuple<int>> args = {{4}, {2}};
+        std::vector<double> results(args.size());
+        auto info = lua.callBatch(half, std::span(args), std::span(results));
+        LUA_CHECK(!info && info.getDesc().find("item 1: (error object is a table value)") != std::string_view::npos);
+        LUA_CHECK(results[0] == 2.0);
+        LUA_CHECK(lua_gettop(lua.getLuaState()) == 0);
+    });
+}
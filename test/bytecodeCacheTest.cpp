@@ -0,0 +1,104 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace
+{
+    std::string readAll(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void writeAll(const std::filesystem::path& path, const std::string& content)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << content;
+    }
+
+    std::string dump(std::string_view source, const std::string& chunkName)
+    {
+        std::string bytecode;
+        lua_State* L = ::luaL_newstate();
+        if(::luaL_loadbufferx(L, source.data(), source.size(), chunkName.c_str(), "t") == LUA_OK)
+        {
+            ::lua_dump(L, [](lua_State*, const void* data, std::size_t size, void* userData)
+            {
+                static_cast<std::string*>(userData)->append(static_cast<const char*>(data), size);
+                return 0;
+            }, &bytecode, 0);
+        }
+        ::lua_close(L);
+        return bytecode;
+    }
+
+    long long valueOf(const std::filesystem::path& script, const std::filesystem::path& cacheDir)
+    {
+        LuaScript lua(script, Lua_lib_all);
+        lua.setBytecodeCache(cacheDir);
+        if(!lua.compile())
+            return -1;
+        return lua_getglobal(lua.getLuaState(), "value") == LUA_TNUMBER ? ::lua_tointeger(lua.getLuaState(), -1) : -1;
+    }
+
+    TestRegistrar storesAndLoads("bytecodeCache/storesAndLoads", []
+    {
+        auto dir = std::filesystem::temp_directory_path() / "luacpp_bytecode_cache_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        auto script = dir / "script.lua";
+        writeAll(script, "value = 1");
+        BytecodeCache cache(dir / "cache");
+        auto cachePath = cache.getCachePath(script);
+
+        LUA_CHECK(valueOf(script, cache.getCacheDir()) == 1);
+        LUA_CHECK(std::filesystem::exists(cachePath));
+
+        // an entry that matches the script is loaded instead of the source: replace its chunk by one of the same size
+        std::string entry = readAll(cachePath);
+        std::string chunkName = "@" + script.string();
+        std::string original = dump("value = 1", chunkName);
+        std::string replaced = dump("value = 2", chunkName);
+        LUA_CHECK(!original.empty() && original.size() == replaced.size() && entry.size() > original.size());
+        LUA_CHECK(entry.compare(entry.size() - original.size(), original.size(), original) == 0);
+        writeAll(cachePath, entry.substr(0, entry.size() - original.size()) + replaced);
+        LUA_CHECK(valueOf(script, cache.getCacheDir()) == 2);
+
+        // a truncated entry falls back to the source and is refreshed
+        writeAll(cachePath, entry.substr(0, entry.size() / 2));
+        LUA_CHECK(valueOf(script, cache.getCacheDir()) == 1);
+        LUA_CHECK(readAll(cachePath) == entry);
+
+        // changed content invalidates the entry
+        writeAll(script, "value = 3");
+        LUA_CHECK(valueOf(script, cache.getCacheDir()) == 3);
+        LUA_CHECK(readAll(cachePath) != entry);
+
+        std::filesystem::remove_all(dir);
+    });
+
+    TestRegistrar compileErrorNotStored("bytecodeCache/compileErrorNotStored", []
+    {
+        auto dir = std::filesystem::temp_directory_path() / "luacpp_bytecode_cache_error_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        auto script = dir / "broken.lua";
+        writeAll(script, "value = ");
+        BytecodeCache cache(dir / "cache");
+
+        lua_State* L = ::luaL_newstate();
+        FuncInfo info = cache.load(L, script);
+        LUA_CHECK(!info && info.getType() == FuncInfoType::COMPILE && ::lua_gettop(L) == 0);
+        LUA_CHECK(!std::filesystem::exists(cache.getCachePath(script)));
+        info = cache.load(L, dir / "missing.lua");
+        LUA_CHECK(!info && info.getType() == FuncInfoType::LOAD);
+        ::lua_close(L);
+
+        std::filesystem::remove_all(dir);
+    });
+}
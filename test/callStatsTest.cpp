@@ -0,0 +1,63 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+    TestRegistrar recordsCalls("callStats/recordsCalls", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.regFunc("update"));
+        LUA_CHECK(lua.regFunc([](int value) { return value + 1; }, "increment"));
+        LUA_CHECK(lua.compileString("function update(fail) if fail then error('failed') end return increment(1) end"));
+        auto update = lua.prepare("update");
+
+        // disabled, calls are not recorded
+        lua.call<>(update, false);
+        LUA_CHECK(lua.getCallStats("update")->calls == 0);
+
+        lua.setCallStatsEnabled(true);
+        for(int i = 0; i < 3; i++)
+            lua.call<>(update, false);
+        try
+        {
+            lua.call<>(update, true);
+        }
+        catch(const std::runtime_error&)
+        {
+        }
+
+        auto script = lua.getCallStats("update");
+        LUA_CHECK(script && script->kind == LuaFunctionKind::SCRIPT);
+        LUA_CHECK(script->calls == 4 && script->errors == 1 && script->latency.getCount() == 4);
+        LUA_CHECK(script->min <= script->mean() && script->mean() <= script->max && script->max > std::chrono::nanoseconds(0));
+        auto native = lua.getCallStats("increment");
+        LUA_CHECK(native && native->kind == LuaFunctionKind::NATIVE && native->calls == 3 && native->errors == 0);
+        LUA_CHECK(!lua.getCallStats("missing"));
+
+        lua.resetCallStats();
+        LUA_CHECK(lua.getCallStats("update")->calls == 0 && lua.getCallStats("update")->latency.getCount() == 0);
+    });
+
+    TestRegistrar histogramPercentiles("callStats/histogramPercentiles", []
+    {
+        for(std::uint64_t n : {0ull, 1ull, 31ull, 32ull, 1000ull, 123456789ull, 1ull << 40})
+            LUA_CHECK(LuaLatencyHistogram::bucketLow(LuaLatencyHistogram::bucketOf(n)) <= n);
+
+        LuaLatencyHistogram histogram;
+        LUA_CHECK(histogram.percentile(50) == std::chrono::nanoseconds(0));
+        histogram.record(std::chrono::nanoseconds(1000), 99);
+        histogram.record(std::chrono::nanoseconds(1000000), 1);
+        LUA_CHECK(histogram.getCount() == 100);
+
+        // buckets are accurate to about 3%
+        auto median = histogram.percentile(50).count();
+        auto tail = histogram.percentile(99.9).count();
+        LUA_CHECK(median >= 1000 && median <= 1031);
+        LUA_CHECK(tail >= 1000000 && tail <= 1031250);
+    });
+}
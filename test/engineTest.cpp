@@ -0,0 +1,63 @@
+#include "test.h"
+
+#include "luaScriptEngine.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+    std::filesystem::path writeScript(const char* name, const char* code)
+    {
+        auto path = std::filesystem::temp_directory_path() / name;
+        std::ofstream(path) << code;
+        return path;
+    }
+
+    TestRegistrar chunkNamedAfterScript("engine/chunkNamedAfterScript", []
+    {
+        auto path = writeScript("luaCPP_engine_chunk.lua", "function fail() error('boom') end\n");
+        LuaScriptEngine engine(Lua_lib_all, path, [](LuaScript& lua) { return lua.regFunc("fail"); }, false);
+        LUA_CHECK(engine.start(1));
+        auto info = engine.doFunc("fail").get();
+        LUA_CHECK(!info && info.getDesc().find("luaCPP_engine_chunk.lua:1: boom") != std::string_view::npos);
+        engine.stop();
+        std::filesystem::remove(path);
+    });
+
+    TestRegistrar submitDuringStop("engine/submitDuringStop", []
+    {
+        for(int round = 0; round < 20; round++)
+        {
+            LuaScriptEngine engine(Lua_lib_all, "", nullptr, false);
+            LUA_CHECK(engine.start(2));
+            std::thread producer([&engine]
+            {
+                try
+                {
+                    while(true)
+                        engine.submit([](LuaScript&) { return 0; });
+                }
+                catch(const std::runtime_error&)
+                {
+                }
+            });
+            std::this_thread::yield();
+            engine.stop();
+            producer.join();
+            LUA_CHECK(engine.size() == 0);
+            bool threw = false;
+            try
+            {
+                engine.submit([](LuaScript&) { return 0; });
+            }
+            catch(const std::runtime_error&)
+            {
+                threw = true;
+            }
+            LUA_CHECK(threw);
+        }
+    });
+}
@@ -0,0 +1,32 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+namespace
+{
+    TestRegistrar deepTableRejected("flatTable/deepTableRejected", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.compileString("deep = {}\n"
+                                    "local t = deep\n"
+                                    "for i = 1, 100000 do t.next = {} t = t.next end\n"
+                                    "shallow = {1, 2, {x = 'y'}}\n"
+                                    "shallow[4] = shallow\n"));
+        LuaFlatTable table;
+        auto info = lua.getFlatTable("deep", table);
+        LUA_CHECK(!info && info.getDesc().find("nested deeper") != std::string_view::npos);
+        LUA_CHECK(::lua_gettop(lua.getLuaState()) == 0);
+        LUA_CHECK(lua.getFlatTable("shallow", table));
+    });
+
+    TestRegistrar deepArrayRejected("flatTable/deepArrayRejected", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.compileString("deep = {}\n"
+                                    "local t = deep\n"
+                                    "for i = 1, 300 do t[1] = {} t = t[1] end\n"));
+        LuaFlatTable table;
+        LUA_CHECK(!lua.getFlatTable("deep", table));
+        LUA_CHECK(::lua_gettop(lua.getLuaState()) == 0);
+    });
+}
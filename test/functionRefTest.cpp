@@ -0,0 +1,77 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace
+{
+    TestRegistrar preparedInCoroutine("functionRef/preparedInCoroutine", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LuaFunctionRef ref;
+        LUA_CHECK(lua.regFunc("target"));
+        LUA_CHECK(lua.regFunc([&ref](LuaScript& script)
+        {
+            ref = script.prepare("target");
+            return 0;
+        }, "grab"));
+        LUA_CHECK(lua.compileString("function target() end\n"
+                                    "coroutine.wrap(function() grab() end)()\n"
+                                    "collectgarbage()\n"));
+
+        // the coroutine the handle was prepared in is collected, the handle must still call and release
+        LUA_CHECK(ref && ref.getName() == "target");
+        LUA_CHECK(lua.doFunc(ref));
+        ref = LuaFunctionRef();
+        LUA_CHECK(lua.compileString("collectgarbage()"));
+    });
+
+    TestRegistrar nonStringError("functionRef/nonStringError", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.regFunc("fail"));
+        LUA_CHECK(lua.compileString("function fail() error({}) end"));
+
+        std::string message;
+        try
+        {
+            lua.call<>(lua.prepare("fail"));
+        }
+        catch(const std::runtime_error& e)
+        {
+            message = e.what();
+        }
+        LUA_CHECK(message.find("(error object is a table value)") != std::string::npos);
+
+        FuncInfo info = lua.doFunc("fail");
+        LUA_CHECK(!info && std::string(info.getDesc()).find("(error object is a table value)") != std::string::npos);
+        LUA_CHECK(::lua_gettop(lua.getLuaState()) == 0);
+    });
+
+    template<std::size_t... I>
+    long long sumOf(LuaScript& lua, const LuaFunctionRef& ref, std::index_sequence<I...>)
+    {
+        return std::get<0>(lua.call<long long>(ref, static_cast<long long>(I + 1)...));
+    }
+
+    TestRegistrar manyArguments("functionRef/manyArguments", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.regFunc("sum"));
+        LUA_CHECK(lua.regFunc([]
+        {
+            return std::tuple<int, int, int, int, int, int, int, int, int, int, int, int, int, int, int,
+                              int, int, int, int, int, int, int, int, int, int, int, int, int, int, int>{};
+        }, "zeros"));
+        LUA_CHECK(lua.compileString("function sum(...) local s = 0 for _, v in ipairs({...}) do s = s + v end return s end\n"
+                                    "assert(select('#', zeros()) == 30)"));
+
+        // more arguments than the LUA_MINSTACK slots the stack is guaranteed to have
+        LUA_CHECK(sumOf(lua, lua.prepare("sum"), std::make_index_sequence<120>{}) == 120 * 121 / 2);
+        LUA_CHECK(::lua_gettop(lua.getLuaState()) == 0);
+    });
+}
@@ -0,0 +1,27 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+namespace
+{
+    TestRegistrar statsSurviveFailedCalls("gc/statsSurviveFailedCalls", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LuaExecutionLimit limit;
+        limit.instructions = 20000;
+        limit.checkInterval = 100;
+        lua.setExecutionLimit(limit);
+
+        // finalizers that fail while the collector runs them, then a loop running out of budget
+        auto info = lua.compileString("for i = 1, 200 do setmetatable({}, {__gc = function() error('in finalizer') end}) end\n"
+                                      "local t = {}\n"
+                                      "for i = 1, 100000 do t[i % 100] = {i} end\n");
+        LUA_CHECK(!info && info.getType() == FuncInfoType::TIMEOUT);
+
+        lua.resetGcStats();
+        LUA_CHECK(lua.compileString("collectgarbage()"));
+        LUA_CHECK(lua.getGcStats().fullCollections == 1);
+        LUA_CHECK(lua.compileString("local t = {} for i = 1, 1000 do t[i] = {} end"));
+        LUA_CHECK(lua.getGcStats().steps > 0);
+    });
+}
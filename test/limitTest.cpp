@@ -0,0 +1,30 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+namespace
+{
+    TestRegistrar coroutineCreatedBefore("limit/coroutineCreatedBefore", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.compileString("co = coroutine.create(function() while true do end end)"));
+
+        LuaExecutionLimit limit;
+        limit.instructions = 100000;
+        lua.setExecutionLimit(limit);
+        auto info = lua.compileString("assert(not coroutine.resume(co))");
+        LUA_CHECK(info.getType() == FuncInfoType::TIMEOUT);
+    });
+
+    TestRegistrar hookLeavesCoroutine("limit/hookLeavesCoroutine", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LuaExecutionLimit limit;
+        limit.instructions = 100000;
+        lua.setExecutionLimit(limit);
+        LUA_CHECK(lua.compileString("co = coroutine.wrap(function() while true do coroutine.yield(debug.gethook()) end end)"));
+
+        lua.setExecutionLimit({});
+        LUA_CHECK(lua.compileString("assert(co() == nil)"));
+    });
+}
@@ -0,0 +1,52 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    TestRegistrar hostPushesNotRefused("memory/hostPushesNotRefused", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.regFunc("len"));
+        LUA_CHECK(lua.regFunc("grow"));
+        LUA_CHECK(lua.compileString("function len(s) return #s end\n"
+                                    "function grow(s) return s .. s end\n"));
+        lua.setMemoryLimit(lua.getMemoryStats().current + 64 * 1024);
+        std::string big(256 * 1024, 'x');
+
+        // pushed outside of a call, over the limit but without a memory error
+        auto len = lua.prepare("len");
+        LUA_CHECK(std::get<0>(lua.call<long long>(len, big)) == static_cast<long long>(big.size()));
+        std::vector<double> values(32 * 1024, 1.0);
+        LUA_CHECK(lua.pushArray("values", std::span<const double>(values)));
+
+        // the next allocation of a call fails
+        auto info = lua.compileString("local copy = {table.unpack(values)}");
+        LUA_CHECK(!info && info.getType() == FuncInfoType::MEMORY);
+        bool thrown = false;
+        try
+        {
+            lua.call<std::string>(lua.prepare("grow"), big);
+        }
+        catch(const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        LUA_CHECK(thrown);
+    });
+
+    TestRegistrar parsingIsLimited("memory/parsingIsLimited", []
+    {
+        LuaScript lua(Lua_lib_all);
+        lua.setMemoryLimit(lua.getMemoryStats().current + 16 * 1024);
+        std::string code = "local t = {";
+        for(int i = 0; i < 20000; i++)
+            code.append("'s").append(std::to_string(i)).append("',");
+        code.append("}");
+        auto info = lua.compileString(code);
+        LUA_CHECK(!info && info.getType() == FuncInfoType::MEMORY);
+    });
+}
@@ -0,0 +1,70 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    TestRegistrar luaErrorRestoresState("native/luaErrorRestoresState", []
+    {
+        LuaScript lua(Lua_lib_all);
+        lua_State* main = lua.getLuaState();
+        LUA_CHECK(lua.regFunc([](LuaScript& script) { return ::luaL_error(script.getLuaState(), "native failure"); }, "fail"));
+        LUA_CHECK(lua.regFunc([main](LuaScript& script)
+        {
+            ::lua_pushboolean(script.getLuaState(), script.getLuaState() != main);
+            return 1;
+        }, "inThread"));
+        LUA_CHECK(lua.compileString("local co = coroutine.wrap(function()\n"
+                                    "  local ok, err = pcall(fail)\n"
+                                    "  assert(not ok and err:find('native failure'))\n"
+                                    "  assert(inThread())\n"
+                                    "end)\n"
+                                    "co()\n"
+                                    "assert(not inThread())\n"));
+        LUA_CHECK(lua.getLuaState() == main);
+        LUA_CHECK(::lua_gettop(main) == 0);
+    });
+
+    TestRegistrar exceptionBecomesError("native/exceptionBecomesError", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.regFunc([](LuaScript&) -> int { throw std::runtime_error("thrown"); }, "throws"));
+        LUA_CHECK(lua.compileString("local ok, err = pcall(throws)\n"
+                                    "assert(not ok and err == 'thrown')\n"));
+        auto info = lua.compileString("throws()");
+        LUA_CHECK(!info && info.getDesc().find("thrown") != std::string_view::npos);
+    });
+
+    TestRegistrar boundResultOutOfMemory("native/boundResultOutOfMemory", []
+    {
+        LuaScript lua(Lua_lib_all);
+        lua_State* main = lua.getLuaState();
+        LUA_CHECK(lua.regFunc([](std::string prefix) { return prefix + std::string(1 << 20, 'x'); }, "big"));
+        lua.setMemoryLimit(lua.getMemoryStats().current + 256 * 1024);
+        auto info = lua.compileString("local ok, err = pcall(big, 'prefix')\n"
+                                      "assert(not ok and err == 'not enough memory')\n"
+                                      "return coroutine.wrap(function() return big('x') end)()\n");
+        LUA_CHECK(!info && info.getType() == FuncInfoType::MEMORY);
+        LUA_CHECK(lua.getLuaState() == main);
+    });
+
+    TestRegistrar boundFunctionYields("native/boundFunctionYields", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.regFunc([&lua](int value) { lua.yield(); return value * 2; }, "pause"));
+        LUA_CHECK(lua.regFunc([](LuaScript& script) -> int { script.yield(); throw std::runtime_error("failed"); }, "broken"));
+        LUA_CHECK(lua.regFunc([](int value) { return value * 2; }, "twice"));
+        LUA_CHECK(lua.compileString("local co = coroutine.create(function(v) local r = pause(v) return r + 1 end)\n"
+                                    "local ok, yielded = coroutine.resume(co, 4)\n"
+                                    "assert(ok and yielded == 8 and coroutine.status(co) == 'suspended')\n"
+                                    "local ok2, result = coroutine.resume(co, 10)\n"
+                                    "assert(ok2 and result == 11)\n"
+                                    "co = coroutine.wrap(function() pcall(broken) return pause(1) end)\n"
+                                    "assert(co() == 2)\n"));
+        lua.yield(1);
+        LUA_CHECK(lua.compileString("assert(twice(3) == 6)"));
+    });
+}
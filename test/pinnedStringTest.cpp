@@ -0,0 +1,36 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+namespace
+{
+    TestRegistrar pinnedInCoroutine("pinnedString/pinnedInCoroutine", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LuaPinnedString pinned;
+        LUA_CHECK(lua.regFunc([&pinned](LuaScript& script)
+        {
+            pinned = script.pinString(1);
+            return 0;
+        }, "pin"));
+        LUA_CHECK(lua.compileString("coroutine.wrap(function() pin(string.rep('pinned', 8, ' ')) end)()\n"
+                                    "collectgarbage()\n"));
+
+        // the string outlives the collected coroutine it was pinned in
+        LUA_CHECK(pinned && pinned.view().size() == 55 && pinned.view().substr(0, 13) == "pinned pinned");
+        pinned = LuaPinnedString();
+        LUA_CHECK(lua.compileString("collectgarbage()"));
+    });
+
+    TestRegistrar embeddedZeros("pinnedString/embeddedZeros", []
+    {
+        LuaScript lua(Lua_lib_all);
+        lua_State* L = lua.getLuaState();
+        lua.pushString(std::string_view("a\0b", 3));
+        ::lua_pushinteger(L, 1);
+        auto pinned = lua.pinString(-2);
+        LUA_CHECK(pinned.view().size() == 3 && pinned.view()[1] == '\0');
+        LUA_CHECK(!lua.pinString(-1));
+        lua_pop(L, 2);
+    });
+}
@@ -0,0 +1,138 @@
+#include "test.h"
+
+#include "luaStatePool.h"
+
+namespace
+{
+    LuaStatePool::InitFunc counterScript()
+    {
+        return [](LuaScript& lua)
+        {
+            auto info = lua.regFunc("tick");
+            if(!info)
+                return info;
+            return lua.compileString("local count = 0\n"
+                                     "function tick() count = count + 1 return count end\n"
+                                     "config = {mode = 'default'}\n");
+        };
+    }
+
+    long long tick(LuaScript& lua)
+    {
+        auto ref = lua.prepare("tick");
+        return std::get<0>(lua.call<long long>(ref));
+    }
+
+    TestRegistrar resetRegistersAgain("pool/resetRegistersAgain", []
+    {
+        LuaStatePool pool(Lua_lib_all, "", counterScript(), 1);
+        for(int checkout = 0; checkout < 3; checkout++)
+        {
+            PooledLuaScript lua = pool.acquire();
+            LUA_CHECK(lua);
+            LUA_CHECK(lua->regFunc([](int a) { return a * 2; }, "double"));
+            LUA_CHECK(lua->compileString("assert(double(4) == 8)"));
+        }
+        LUA_CHECK(pool.available() == 1);
+    });
+
+    TestRegistrar resetRestoresUpvaluesAndMetatables("pool/resetRestoresUpvaluesAndMetatables", []
+    {
+        LuaStatePool pool(Lua_lib_all, "", counterScript(), 1);
+        for(int checkout = 0; checkout < 2; checkout++)
+        {
+            PooledLuaScript lua = pool.acquire();
+            LUA_CHECK(tick(*lua) == 1);
+            LUA_CHECK(tick(*lua) == 2);
+            LUA_CHECK(lua->compileString("assert(getmetatable(_G) == nil and getmetatable(config) == nil)\n"
+                                         "assert(config.mode == 'default')\n"
+                                         "setmetatable(_G, {__index = function() return 1 end})\n"
+                                         "setmetatable(config, {})\n"
+                                         "config.mode = 'changed'\n"
+                                         "getmetatable('').__index.upper = nil"));
+        }
+    });
+
+    TestRegistrar resetRestoresNestedTables("pool/resetRestoresNestedTables", []
+    {
+        LuaStatePool pool(Lua_lib_all, "", [](LuaScript& lua)
+        {
+            return lua.compileString("cfg = {inner = {v = 1, deeper = {w = 2}}, list = {1, 2, 3}}\n"
+                                     "local hidden = {n = 5}\n"
+                                     "function hiddenN() return hidden.n end");
+        }, 1);
+        for(int checkout = 0; checkout < 2; checkout++)
+        {
+            PooledLuaScript lua = pool.acquire();
+            LUA_CHECK(lua->compileString("assert(cfg.inner.v == 1 and cfg.inner.deeper.w == 2 and #cfg.list == 3)\n"
+                                         "assert(hiddenN() == 5 and package.loaded.evil == nil)\n"
+                                         "cfg.inner.v = 99\n"
+                                         "cfg.inner.deeper.w = nil\n"
+                                         "cfg.list[4] = 4\n"
+                                         "select(2, debug.getupvalue(hiddenN, 1)).n = 6\n"
+                                         "package.loaded.evil = true"));
+        }
+    });
+
+    TestRegistrar resetRestoresSettings("pool/resetRestoresSettings", []
+    {
+        LuaStatePool pool(Lua_lib_all, "", counterScript(), 1);
+        {
+            PooledLuaScript lua = pool.acquire();
+            lua->setMemoryLimit(1 << 20);
+            LuaExecutionLimit limit;
+            limit.instructions = 1000;
+            lua->setExecutionLimit(limit);
+            LuaGcConfig gc;
+            gc.mode = LuaGcMode::GENERATIONAL;
+            gc.stepBudget = 4;
+            lua->setGcConfig(gc);
+            lua->setCallStatsEnabled(true);
+            lua->startProfiler();
+            tick(*lua);
+        }
+        PooledLuaScript lua = pool.acquire();
+        LUA_CHECK(lua->getMemoryStats().limit == 0);
+        LUA_CHECK(!lua->getExecutionLimit().isLimited());
+        LUA_CHECK(lua->getGcConfig().mode == LuaGcMode::INCREMENTAL);
+        LUA_CHECK(lua->getGcConfig().stepBudget == 0);
+        LUA_CHECK(!lua->isCallStatsEnabled());
+        LUA_CHECK(lua->getCallStats("tick")->calls == 0);
+        LUA_CHECK(!lua->isProfiling());
+        LUA_CHECK(lua->getProfiler() == nullptr);
+        LUA_CHECK(lua->compileString("string.upper('a')"));
+    });
+
+    TestRegistrar acquireReportsError("pool/acquireReportsError", []
+    {
+        LuaStatePool pool(Lua_lib_all, "", [](LuaScript& lua) { return lua.compileString("error('init failed')"); });
+        PooledLuaScript lua;
+        auto info = pool.acquire(lua);
+        LUA_CHECK(!info);
+        LUA_CHECK(info.getType() == FuncInfoType::COMPILE);
+        LUA_CHECK(info.getDesc().find("init failed") != std::string_view::npos);
+        LUA_CHECK(!lua);
+        LUA_CHECK(!pool.acquire());
+    });
+
+    TestRegistrar releaseDuringCallDefers("pool/releaseDuringCallDefers", []
+    {
+        LuaScript lua;
+        LUA_CHECK(lua.regFunc([&lua](LuaScript&) { return lua.resetToSnapshot() ? 1 : 0; }, "reset"));
+        lua.takeSnapshot();
+        LUA_CHECK(lua.compileString("assert(reset() == nil)"));
+        LUA_CHECK(lua.resetToSnapshot());
+
+        // a native dropping its own handle, the state must outlive the call that is still running
+        LuaStatePool pool(Lua_lib_all, "", [](LuaScript& script) { return script.compileString("x = 1"); }, 1);
+        PooledLuaScript handle = pool.acquire();
+        LuaScript* script = handle.get();
+        LUA_CHECK(script->regFunc([&handle]() { handle.release(); return 42; }, "drop"));
+        LUA_CHECK(script->compileString("assert(drop() == 42) x = 2"));
+        LUA_CHECK(!handle && pool.available() == 0);
+
+        PooledLuaScript next = pool.acquire();
+        LUA_CHECK(next.get() == script);
+        LUA_CHECK(next->compileString("assert(x == 1 and drop == nil)"));
+    });
+}
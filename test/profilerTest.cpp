@@ -0,0 +1,25 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+namespace
+{
+    TestRegistrar taskSampled("profiler/taskSampled", []
+    {
+#ifdef __linux__
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.compileString("function spin() local x = 0 for i = 1, 20000000 do x = x + i end return x end"));
+
+        LuaProfilerConfig config;
+        config.period = std::chrono::microseconds(500);
+        lua.startProfiler(config);
+        auto task = lua.createTask("spin");
+        LUA_CHECK(lua.resumeTask(task, 0));
+        lua.stopProfiler();
+
+        // the timer armed the task thread, a sample armed on the main thread would only be taken after the resume
+        LUA_CHECK(lua.getProfiler()->getSamples() > 1);
+        LUA_CHECK(lua.getProfiler()->getFolded().find("spin") != std::string::npos);
+#endif
+    });
+}
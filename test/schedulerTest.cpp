@@ -0,0 +1,66 @@
+#include "test.h"
+
+#include "luaScheduler.h"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    TestRegistrar taskYieldsAndReturns("scheduler/taskYieldsAndReturns", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.compileString("function count(n) for i = 1, n - 1 do coroutine.yield(i) end return n * 10 end"));
+        LuaTask task = lua.createTask("count");
+        LUA_CHECK(task && task.getStatus() == LuaTaskStatus::READY);
+
+        LUA_CHECK(lua.resume(task, 3));
+        LUA_CHECK(task.getStatus() == LuaTaskStatus::YIELDED && task.getResultCount() == 1);
+        LUA_CHECK(::lua_tointeger(task.getThread(), -1) == 1);
+        LUA_CHECK(lua.resume(task));
+        LUA_CHECK(::lua_tointeger(task.getThread(), -1) == 2);
+        LUA_CHECK(lua.resume(task));
+        LUA_CHECK(task.getStatus() == LuaTaskStatus::DONE && ::lua_tointeger(task.getThread(), -1) == 30);
+        LUA_CHECK(!task.isResumable());
+    });
+
+    TestRegistrar nonStringError("scheduler/nonStringError", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.compileString("function fail() coroutine.yield() error({}) end"));
+        LuaTask task = lua.createTask("fail");
+        LUA_CHECK(lua.resume(task));
+
+        FuncInfo info = lua.resume(task);
+        LUA_CHECK(!info && task.getStatus() == LuaTaskStatus::FAILED);
+        LUA_CHECK(info.getDesc().find("Failed to run task[fail] - (error object is a table value)") != std::string_view::npos);
+    });
+
+    TestRegistrar suspendAndWake("scheduler/suspendAndWake", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LuaScheduler scheduler(lua);
+        LUA_CHECK(lua.regFunc([&scheduler](LuaScript&) { return scheduler.suspend(); }, "waitValue"));
+        LUA_CHECK(scheduler.registerSleep());
+        LUA_CHECK(lua.compileString("order = {}\n"
+                                    "function waiter() local v = waitValue() order[#order + 1] = 'waiter' return v * 2 end\n"
+                                    "function sleeper() sleep(0) order[#order + 1] = 'sleeper' return 1 end"));
+
+        std::vector<long long> results;
+        scheduler.setCompletionHandler([&results](LuaTaskId, LuaTask& task, const FuncInfo& info)
+        {
+            LUA_CHECK(info && task.getStatus() == LuaTaskStatus::DONE);
+            results.push_back(::lua_tointeger(task.getThread(), -1));
+        });
+        LuaTaskId waiter = scheduler.spawn("waiter");
+        LUA_CHECK(waiter != 0 && scheduler.spawn("sleeper") != 0 && scheduler.spawn("missing") == 0);
+
+        // the sleeper finishes, the waiter stays suspended until it is woken
+        scheduler.run();
+        LUA_CHECK(scheduler.size() == 1 && results == std::vector<long long>{1});
+        LUA_CHECK(!scheduler.cancel(42) && scheduler.wake(waiter, 21) && !scheduler.wake(waiter, 1));
+        scheduler.run();
+        LUA_CHECK(scheduler.size() == 0 && results == std::vector<long long>{1, 42});
+        LUA_CHECK(lua.compileString("assert(order[1] == 'sleeper' and order[2] == 'waiter')"));
+    });
+}
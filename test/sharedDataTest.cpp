@@ -0,0 +1,53 @@
+#include "test.h"
+
+#include "luaScript.h"
+
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    TestRegistrar readAcrossStates("sharedData/readAcrossStates", []
+    {
+        LuaScript source(Lua_lib_all);
+        LUA_CHECK(source.compileString("config = {name = 'shop', prices = {apple = 1.25, pear = 0.75}, ids = {10, 20, 30}}"));
+        LuaFlatTable flat;
+        LUA_CHECK(source.getFlatTable("config", flat));
+        LuaSharedData shared(std::move(flat));
+        LUA_CHECK(shared && shared.get() != nullptr);
+
+        LuaScript first(Lua_lib_all);
+        LuaScript second(Lua_lib_all);
+        first.pushSharedData("config", shared);
+        second.pushSharedData("config", shared);
+        for(LuaScript* lua : {&first, &second})
+        {
+            LUA_CHECK(lua->compileString("assert(config.name == 'shop' and config.prices.apple == 1.25 and config.missing == nil)\n"
+                                         "assert(config.prices == config.prices)\n"
+                                         "assert(#config.ids == 3 and config.ids[2] == 20 and config.ids[4] == nil)\n"
+                                         "local sum = 0 for _, v in ipairs(config.ids) do sum = sum + v end assert(sum == 60)\n"
+                                         "local count = 0 for k, v in pairs(config.prices) do count = count + 1 end assert(count == 2)\n"
+                                         "local ok, err = pcall(function() config.name = 'changed' end)\n"
+                                         "assert(not ok and err:find('attempt to modify shared data'))\n"
+                                         "ok = pcall(function() config.prices.kiwi = 1 end)\n"
+                                         "assert(not ok and config.prices.kiwi == nil)"));
+        }
+    });
+
+    TestRegistrar outlivesOwner("sharedData/outlivesOwner", []
+    {
+        LuaScript lua(Lua_lib_all);
+        {
+            std::vector<double> values = {0.5, 1.5, 2.5};
+            LuaSharedData shared{std::span<const double>(values)};
+            lua.pushSharedData("values", shared);
+        }
+        // the userdata keeps the data alive after the last LuaSharedData is gone
+        LUA_CHECK(lua.compileString("collectgarbage()\n"
+                                    "assert(#values == 3 and values[1] == 0.5 and values[3] == 2.5)"));
+
+        LuaSharedData empty;
+        LUA_CHECK(!empty && empty.get() == nullptr);
+    });
+}
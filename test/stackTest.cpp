@@ -0,0 +1,43 @@
+#include "test.h"
+
+#include "luaStack.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+    struct State
+    {
+        State() : L(::luaL_newstate()) {}
+        ~State() { ::lua_close(L); }
+        lua_State* L;
+    };
+
+    TestRegistrar integerOutOfRange("stack/integerOutOfRange", []
+    {
+        State state;
+        ::lua_pushinteger(state.L, 300);
+        LUA_CHECK(!LuaStack::check<std::uint8_t>(state.L, -1));
+        LUA_CHECK(LuaStack::check<std::int16_t>(state.L, -1));
+        ::lua_pushinteger(state.L, -1);
+        std::uint32_t value = 0;
+        LUA_CHECK(!LuaStack::tryRead<std::uint32_t>(state.L, -1, value));
+        LUA_CHECK(LuaStack::check<int>(state.L, -1));
+    });
+
+    TestRegistrar arrayOnePass("stack/arrayOnePass", []
+    {
+        State state;
+        LUA_CHECK(luaL_dostring(state.L, "return {1, 2.5, '3', 4}") == LUA_OK);
+        std::vector<double> numbers;
+        LUA_CHECK(LuaStack::tryRead<std::vector<double>>(state.L, -1, numbers));
+        LUA_CHECK(numbers == std::vector<double>{1, 2.5, 3, 4});
+        std::vector<lua_Integer> integers;
+        LUA_CHECK(!LuaStack::tryRead<std::vector<lua_Integer>>(state.L, -1, integers));
+
+        LUA_CHECK(luaL_dostring(state.L, "return {1, 2, 3.0, 'x'}") == LUA_OK);
+        LUA_CHECK(!LuaStack::tryRead<std::vector<lua_Integer>>(state.L, -1, integers));
+        LUA_CHECK(::lua_gettop(state.L) == 2);
+    });
+}
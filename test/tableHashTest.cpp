@@ -0,0 +1,151 @@
+#include "test.h"
+
+#include <lua.hpp>
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    /**
+     * Integer, float and pointer keys are placed in node (key % m) with the odd modulus m = (2^lsizenode - 1) | 1.
+     * Keys with distinct slots never collide, so lua_next returns them in slot order. A table filled with such keys
+     * shows whether the divide free remainder in ltable.c places every key where '%' would.
+     */
+    struct State
+    {
+        State() : L(::luaL_newstate()) {}
+        ~State() { ::lua_close(L); }
+        lua_State* L;
+    };
+
+    /** Same as l_hashfloat in ltable.c. */
+    std::uint64_t hashFloat(lua_Number n)
+    {
+        int i = 0;
+        n = std::frexp(n, &i) * -static_cast<lua_Number>(INT_MIN);
+        lua_Integer ni = 0;
+        if(!lua_numbertointeger(n, &ni))
+            return 0;
+        unsigned int u = static_cast<unsigned int>(i) + static_cast<unsigned int>(ni);
+        return u <= static_cast<unsigned int>(INT_MAX) ? u : ~u;
+    }
+
+    enum class KeyType { INTEGER, FLOAT, POINTER };
+
+    struct Key
+    {
+        std::uint64_t slot;
+        std::uint64_t bits;
+    };
+
+    void pushKey(lua_State* L, KeyType type, std::uint64_t bits)
+    {
+        if(type == KeyType::INTEGER)
+            ::lua_pushinteger(L, static_cast<lua_Integer>(bits));
+        else if(type == KeyType::FLOAT)
+            ::lua_pushnumber(L, std::bit_cast<lua_Number>(bits));
+        else
+            ::lua_pushlightuserdata(L, reinterpret_cast<void*>(static_cast<std::uintptr_t>(bits)));
+    }
+
+    /** Keys with distinct slots, integers cover all slots, the others fill half of them. */
+    std::vector<Key> makeKeys(KeyType type, std::uint64_t m, std::mt19937_64& random)
+    {
+        std::vector<Key> keys;
+        std::vector<bool> used(m, false);
+        if(type == KeyType::INTEGER)
+        {
+            for(std::uint64_t slot = 0; slot < m; slot++)
+            {
+                std::uint64_t base = random() / m * m;
+                if(base > UINT64_MAX - slot)
+                    base -= m;
+                keys.push_back({slot, base + slot});
+            }
+            return keys;
+        }
+
+        std::uniform_real_distribution<lua_Number> range(-1e12, 1e12);
+        while(keys.size() < (m + 1) / 2)
+        {
+            std::uint64_t bits = random();
+            std::uint64_t hash = 0;
+            if(type == KeyType::FLOAT)
+            {
+                lua_Number n = std::floor(range(random)) + 0.5;
+                bits = std::bit_cast<std::uint64_t>(n);
+                hash = hashFloat(n);
+            }
+            else
+            {
+                if(static_cast<std::uintptr_t>(bits) != bits)
+                    bits &= UINT32_MAX;
+                hash = bits & UINT_MAX;
+            }
+            std::uint64_t slot = hash % m;
+            if(used[slot])
+                continue;
+            used[slot] = true;
+            keys.push_back({slot, bits});
+        }
+        return keys;
+    }
+
+    bool slotsMatchRemainder(KeyType type)
+    {
+        std::mt19937_64 random(1234);
+        for(int lsizenode = 0; lsizenode <= 18; lsizenode++)
+        {
+            State state;
+            std::uint64_t size = std::uint64_t(1) << lsizenode;
+            std::uint64_t m = (size - 1) | 1;
+            std::vector<Key> keys = makeKeys(type, m, random);
+            ::lua_createtable(state.L, 0, static_cast<int>(size));
+            for(const Key& key : keys)
+            {
+                pushKey(state.L, type, key.bits);
+                ::lua_pushboolean(state.L, 1);
+                ::lua_rawset(state.L, 1);
+            }
+
+            std::sort(keys.begin(), keys.end(), [](const Key& a, const Key& b) { return a.slot < b.slot; });
+            std::size_t index = 0;
+            ::lua_pushnil(state.L);
+            while(::lua_next(state.L, 1) != 0)
+            {
+                lua_pop(state.L, 1);
+                if(index >= keys.size())
+                    return false;
+                pushKey(state.L, type, keys[index++].bits);
+                bool same = ::lua_rawequal(state.L, -1, -2);
+                lua_pop(state.L, 1);
+                if(!same)
+                    return false;
+            }
+            if(index != keys.size())
+                return false;
+        }
+        return true;
+    }
+
+    TestRegistrar integerSlots("tableHash/integerSlots", []
+    {
+        LUA_CHECK(slotsMatchRemainder(KeyType::INTEGER));
+    });
+
+    TestRegistrar floatSlots("tableHash/floatSlots", []
+    {
+        LUA_CHECK(slotsMatchRemainder(KeyType::FLOAT));
+    });
+
+    TestRegistrar pointerSlots("tableHash/pointerSlots", []
+    {
+        LUA_CHECK(slotsMatchRemainder(KeyType::POINTER));
+    });
+}
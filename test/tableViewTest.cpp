@@ -0,0 +1,64 @@
+#include "test.h"
+
+#include "luaScript.h"
+#include "luaTableView.h"
+
+namespace
+{
+    int registrySize(lua_State* L)
+    {
+        return static_cast<int>(::lua_rawlen(L, LUA_REGISTRYINDEX));
+    }
+
+    TestRegistrar chainAnchorsFinalTable("tableView/chainAnchorsFinalTable", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.compileString("settings = {window = {size = {w = 1280}}, levels = {{name = 'intro'}}}"));
+        lua_State* L = lua.getLuaState();
+        LuaTableView settings = lua.getTableView("settings");
+        int before = registrySize(L);
+        {
+            LuaTableView size = settings["window"]["size"];
+            LUA_CHECK(size.get<long long>("w") == 1280);
+            LUA_CHECK(registrySize(L) <= before + 1);
+            LUA_CHECK(settings["levels"][1].get<std::string>("name") == "intro");
+            LUA_CHECK(!settings["window"]["missing"]["deeper"]);
+        }
+        LUA_CHECK(settings.get<long long>("missing") == std::nullopt);
+        LUA_CHECK(::lua_gettop(L) == 0);
+    });
+
+    TestRegistrar pushInvalidView("tableView/pushInvalidView", []
+    {
+        LuaScript lua(Lua_lib_all);
+        lua_State* L = lua.getLuaState();
+        LuaTableView invalid;
+        invalid.push(L);
+        LUA_CHECK(lua_isnil(L, -1));
+        lua_pop(L, 1);
+        LUA_CHECK(lua.compileString("t = {1}"));
+        lua.getTableView("t").push(L);
+        LUA_CHECK(lua_istable(L, -1));
+        lua_pop(L, 1);
+    });
+
+    TestRegistrar viewFromCoroutine("tableView/viewFromCoroutine", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LuaTableView view;
+        LUA_CHECK(lua.regFunc([&view](LuaScript& script)
+        {
+            view = script.getTableView("config");
+            return 0;
+        }, "grab"));
+        LUA_CHECK(lua.compileString("config = {inner = {v = 7}}\n"
+                                    "coroutine.wrap(function() grab() end)()\n"
+                                    "collectgarbage()\n"));
+
+        // the coroutine the view was taken in is collected, reading and releasing go through the main thread
+        LUA_CHECK(view["inner"].get<long long>("v") == 7);
+        view = LuaTableView();
+        LUA_CHECK(lua.compileString("collectgarbage()"));
+        LUA_CHECK(::lua_gettop(lua.getLuaState()) == 0);
+    });
+}
@@ -0,0 +1,100 @@
+#include "test.h"
+
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    /**
+     * Thrown by a failed check, so the remaining checks of the test are skipped.
+     */
+    struct TestFailure : std::runtime_error
+    {
+        using std::runtime_error::runtime_error;
+    };
+}
+
+TestRegistry& TestRegistry::instance()
+{
+    static TestRegistry registry;
+    return registry;
+}
+
+void TestRegistry::add(std::string_view name, TestFunc func)
+{
+    mCases.push_back(TestCase{std::string(name), std::move(func)});
+}
+
+int TestRegistry::run(std::string_view filter, bool list) const
+{
+    std::size_t run = 0;
+    std::size_t failed = 0;
+    for(const auto& testCase : mCases)
+    {
+        if(std::string_view(testCase.name).substr(0, filter.size()) != filter)
+            continue;
+        run++;
+        if(list)
+        {
+            std::printf("%s\n", testCase.name.c_str());
+            continue;
+        }
+
+        try
+        {
+            testCase.func();
+            std::printf("[ OK ] %s\n", testCase.name.c_str());
+        }
+        catch(const TestFailure& e)
+        {
+            failed++;
+            std::printf("[FAIL] %s\n       %s\n", testCase.name.c_str(), e.what());
+        }
+        catch(const std::exception& e)
+        {
+            failed++;
+            std::printf("[FAIL] %s\n       unexpected exception: %s\n", testCase.name.c_str(), e.what());
+        }
+    }
+
+    if(run == 0)
+    {
+        std::printf("No test matches the filter \"%.*s\"\n", static_cast<int>(filter.size()), filter.data());
+        return 1;
+    }
+    if(!list)
+        std::printf("%zu of %zu tests passed\n", run - failed, run);
+    return failed == 0 ? 0 : 1;
+}
+
+TestRegistrar::TestRegistrar(std::string_view name, TestFunc func)
+{
+    TestRegistry::instance().add(name, std::move(func));
+}
+
+void testFail(const char* file, int line, const char* expression)
+{
+    throw TestFailure(std::string(file).append(":").append(std::to_string(line)).append(": check failed: ").append(expression));
+}
+
+int main(int argc, char** argv)
+{
+    std::string_view filter;
+    bool list = false;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        if(arg.substr(0, 9) == "--filter=")
+            filter = arg.substr(9);
+        else if(arg == "--list")
+            list = true;
+        else
+        {
+            std::printf("Usage: %s [--filter=<prefix>] [--list]\n", argv[0]);
+            return 2;
+        }
+    }
+    return TestRegistry::instance().run(filter, list);
+}
@@ -0,0 +1,58 @@
+#ifndef LUA_TEST_H
+#define LUA_TEST_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using TestFunc = std::function<void()>;
+
+/**
+ * @brief A registered test.
+ */
+struct TestCase
+{
+    std::string name = ""; /**< Name, e.g. "pool/resetRestoresLimits". The part before the slash names the ctest entry. */
+    TestFunc func = nullptr; /**< Test body, fails by throwing. */
+};
+
+/**
+ * @class TestRegistry
+ * @brief Collects the tests of all translation units and runs them.
+ */
+class TestRegistry
+{
+private:
+    std::vector<TestCase> mCases = {}; /**< Registered tests. */
+
+public:
+    static TestRegistry& instance();
+
+    void add(std::string_view name, TestFunc func);
+
+    /**
+     * @brief Runs the tests whose name starts with the filter and prints the failures.
+     * @param filter Prefix of the test names, empty for all.
+     * @param list Only prints the test names.
+     * @return 0 if all tests passed, 1 if a test failed or none matched.
+     */
+    int run(std::string_view filter, bool list) const;
+};
+
+/**
+ * @brief Registers a test from a static initializer.
+ */
+struct TestRegistrar
+{
+    TestRegistrar(std::string_view name, TestFunc func);
+};
+
+/**
+ * @brief Fails the running test. Used by LUA_CHECK.
+ */
+[[noreturn]] void testFail(const char* file, int line, const char* expression);
+
+#define LUA_CHECK(...) do { if(!(__VA_ARGS__)) ::testFail(__FILE__, __LINE__, #__VA_ARGS__); } while(0)
+
+#endif // LUA_TEST_H
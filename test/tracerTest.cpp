@@ -0,0 +1,64 @@
+#include "test.h"
+
+#include "luaScript.h"
+#include "luaTracer.h"
+
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace
+{
+    TestRegistrar recordsSpans("tracer/recordsSpans", []
+    {
+        LuaScript lua(Lua_lib_all);
+        LUA_CHECK(lua.regFunc("update"));
+        LUA_CHECK(lua.regFunc("fail"));
+        LUA_CHECK(lua.regFunc([](int value) { return value + 1; }, "increment"));
+
+        LuaTracer::start();
+        LuaTracer::setThreadName("test \"main\"");
+        LUA_CHECK(lua.compileString("function update() return increment(1) end\n"
+                                    "function fail() error('failed') end"));
+        {
+            LuaTraceSpan span("frame");
+            LUA_CHECK(lua.doFunc("update"));
+            LUA_CHECK(!lua.doFunc("fail"));
+        }
+        LuaTracer::stop();
+        LUA_CHECK(lua.doFunc("update"));
+
+        std::string trace = LuaTracer::getChromeTrace();
+        LUA_CHECK(trace.find("\"args\":{\"name\":\"test \\\"main\\\"\"}") != std::string::npos);
+        LUA_CHECK(trace.find("{\"name\":\"compileString\",\"cat\":\"compile\"") != std::string::npos);
+        LUA_CHECK(trace.find("{\"name\":\"frame\",\"cat\":\"host\"") != std::string::npos);
+        LUA_CHECK(trace.find("{\"name\":\"increment\",\"cat\":\"native\"") != std::string::npos);
+        std::size_t update = trace.find("{\"name\":\"update\",\"cat\":\"script\"");
+        LUA_CHECK(update != std::string::npos && trace.find("{\"name\":\"update\"", update + 1) == std::string::npos);
+        std::size_t fail = trace.find("{\"name\":\"fail\",\"cat\":\"script\"");
+        LUA_CHECK(fail != std::string::npos && trace.find("\"args\":{\"error\":true}", fail) != std::string::npos);
+        LUA_CHECK(LuaTracer::getDropped() == 0);
+        LuaTracer::clear();
+    });
+
+    TestRegistrar unallocatableBufferDrops("tracer/unallocatableBufferDrops", []
+    {
+        // a buffer this large can not be allocated, the events of the thread are dropped without throwing
+        LuaTracer::start(LuaTracerConfig{SIZE_MAX / 2});
+        std::thread worker([]
+        {
+            LuaScript lua(Lua_lib_all);
+            LUA_CHECK(lua.compileString("local t = {} for i = 1, 10000 do t[i] = {} end collectgarbage()"));
+            LuaTracer::record(LuaTraceCategory::HOST, "dropped", std::chrono::steady_clock::now(), std::chrono::steady_clock::now());
+        });
+        worker.join();
+        LuaTracer::stop();
+        LUA_CHECK(LuaTracer::getChromeTrace().find("\"ph\":\"X\"") == std::string::npos);
+
+        LuaTracer::start(LuaTracerConfig{16});
+        LuaTracer::record(LuaTraceCategory::HOST, "kept", std::chrono::steady_clock::now(), std::chrono::steady_clock::now());
+        LuaTracer::stop();
+        LUA_CHECK(LuaTracer::getChromeTrace().find("{\"name\":\"kept\"") != std::string::npos);
+        LuaTracer::clear();
+    });
+}